@@ -0,0 +1,54 @@
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdlib>
+
+#include "allocation_counter.hpp"
+
+using std::size_t;
+
+static std::atomic<u64> allocation_count { 0 };
+
+static auto count_allocation() -> void {
+	allocation_count.fetch_add(1, std::memory_order_relaxed);
+}
+
+// glibc's own allocator entry points, bench_nn's definitions below take the
+// place of the C library's for the whole program
+extern "C" {
+auto __libc_malloc(size_t size) -> void*;
+auto __libc_calloc(size_t count, size_t size) -> void*;
+auto __libc_realloc(void* pointer, size_t size) -> void*;
+auto __libc_memalign(size_t alignment, size_t size) -> void*;
+
+auto malloc(size_t size) noexcept -> void* {
+	count_allocation();
+	return __libc_malloc(size);
+}
+
+auto calloc(size_t count, size_t size) noexcept -> void* {
+	count_allocation();
+	return __libc_calloc(count, size);
+}
+
+auto realloc(void* pointer, size_t size) noexcept -> void* {
+	count_allocation();
+	return __libc_realloc(pointer, size);
+}
+
+auto aligned_alloc(size_t alignment, size_t size) noexcept -> void* {
+	count_allocation();
+	return __libc_memalign(alignment, size);
+}
+
+auto posix_memalign(void** pointer, size_t alignment, size_t size) noexcept -> int {
+	count_allocation();
+	*pointer = __libc_memalign(alignment, size);
+
+	return *pointer == nullptr ? ENOMEM : 0;
+}
+}
+
+auto heap_allocation_count() -> u64 {
+	return allocation_count.load(std::memory_order_relaxed);
+}
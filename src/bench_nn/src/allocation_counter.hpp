@@ -0,0 +1,7 @@
+#pragma once
+
+#include "short_types.hpp"
+
+// Heap allocations made by every thread since the program started, counted
+// by wrapping the C allocator that operator new and Eigen both end up in
+auto heap_allocation_count() -> u64;
@@ -0,0 +1,205 @@
+#include <algorithm>
+#include <cstddef>
+#include <filesystem>
+#include <functional>
+#include <numeric>
+#include <random>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <Eigen/Eigen>
+#include <fmt/format.h>
+
+#include "activation.hpp"
+#include "average_cost_of_neural_net.hpp"
+#include "bench_nn.hpp"
+#include "load_mnist_digits.hpp"
+#include "mnist_dataset.hpp"
+#include "network.hpp"
+#include "network_from_file.hpp"
+#include "network_to_file.hpp"
+#include "synthetic_dataset.hpp"
+#include "thread_pool.hpp"
+
+using std::size_t;
+
+// Values per apply_activation call, about a batch of hidden layer outputs
+constexpr size_t activation_bench_size { 4096 };
+
+// Keeps the compiler from dropping the datasets the loading benchmarks read
+static volatile u8 label_sink {};
+
+// Adds the result of a benchmark to results, unless the filter skips it
+auto add_benchmark(std::vector<benchmark_result>& results, const bench_suite_options& options, std::string name,
+                   std::string unit, double items_per_run, const std::function<void()>& run) -> benchmark_result* {
+	if (!benchmark_selected(name, options.benchmark)) {
+		return nullptr;
+	}
+
+	return &results.emplace_back(run_benchmark(std::move(name), std::move(unit), items_per_run, options.benchmark, run));
+}
+
+template<typename Scalar>
+auto bench_network(std::vector<benchmark_result>& results, const bench_suite_options& options,
+                   const std::vector<u64>& topology, const mnist_dataset& digits, thread_pool& pool) -> void {
+	std::mt19937 rand_gen { static_cast<std::mt19937::result_type>(options.seed) };
+
+	basic_network<Scalar> neural_net { topology };
+	randomize_neural_network_value(neural_net, rand_gen);
+
+	std::string suffix { fmt::format("/{}", fmt::join(topology, ",")) };
+
+	// Keeps the compiler from dropping results nobody looks at
+	volatile Scalar sink {};
+
+	// Weights and biases plus the activations of a whole prediction batch
+	auto parameter_bytes { static_cast<double>(neural_net.parameters().size_bytes()) };
+	auto activation_bytes { static_cast<double>(prediction_batch_size * sizeof(Scalar)
+		                                        * std::accumulate(topology.begin(), topology.end(), u64 { 0 })) };
+
+	// Networks that don't take digits get random pixels of their own
+	pixel_matrix pixels {};
+	if (topology.front() == digits.pixels_per_image()) {
+		pixels = digits.pixels();
+	} else {
+		pixels.resize(static_cast<Eigen::Index>(digits.size()), static_cast<Eigen::Index>(topology.front()));
+
+		std::uniform_int_distribution<u32> rand_pixel { 0, 255 };
+		for (auto& pixel : std::span(pixels.data(), pixels.size())) {
+			pixel = static_cast<u8>(rand_pixel(rand_gen));
+		}
+	}
+
+	{
+		Eigen::Index row { 0 };
+		typename basic_network<Scalar>::prediction_workspace workspace {};
+
+		auto* result { add_benchmark(results, options, "get_prediction" + suffix, "digits", 1, [&] {
+			std::span<const u8> digit { pixels.row(row).data(), static_cast<size_t>(pixels.cols()) };
+			sink = neural_net.get_prediction(digit, workspace)[0];
+			row = (row + 1) % pixels.rows();
+		}) };
+
+		if (result != nullptr) {
+			result->extra = {
+				{ "parameter_bytes", parameter_bytes },
+				{ "memory_bytes", parameter_bytes + activation_bytes },
+			};
+		}
+	}
+
+	{
+		Eigen::Index first { 0 };
+		auto batch_size { std::min<Eigen::Index>(prediction_batch_size, pixels.rows()) };
+		typename basic_network<Scalar>::prediction_workspace workspace {};
+
+		add_benchmark(results, options, "predict_batch" + suffix, "digits", static_cast<double>(batch_size), [&] {
+			sink = neural_net.predict_batch(pixels.middleRows(first, batch_size), workspace)(0, 0);
+			first = first + 2 * batch_size <= pixels.rows() ? first + batch_size : 0;
+		});
+	}
+
+	if (topology.front() == digits.pixels_per_image()) {
+		add_benchmark(results, options, "average_cost_of_neural_net" + suffix, "digits",
+		              static_cast<double>(digits.size()),
+		              [&] { sink = static_cast<Scalar>(average_cost_of_neural_net(neural_net, digits)); });
+
+		add_benchmark(results, options, "average_cost_of_neural_net_pool" + suffix, "digits",
+		              static_cast<double>(digits.size()),
+		              [&] { sink = static_cast<Scalar>(average_cost_of_neural_net(neural_net, digits, pool)); });
+	}
+
+	{
+		basic_network<Scalar> nudged { neural_net };
+
+		add_benchmark(results, options, "nudge_neural_network_values" + suffix, "parameters",
+		              static_cast<double>(neural_net.parameters().size()),
+		              [&] { nudge_neural_network_values(nudged, rand_gen); });
+	}
+
+	auto network_path { (std::filesystem::temp_directory_path() / fmt::format("bench_nn_{}.nn", options.seed)).string() };
+	save_network_to_file(neural_net, network_path);
+	auto file_size { static_cast<double>(std::filesystem::file_size(network_path)) };
+
+	add_benchmark(results, options, "save_network_to_file" + suffix, "bytes", file_size,
+	              [&] { save_network_to_file(neural_net, network_path); });
+
+	add_benchmark(results, options, "load_network_from_file" + suffix, "bytes", file_size, [&] {
+		basic_network<Scalar> loaded {};
+		load_network_from_file(loaded, network_path);
+		sink = loaded.layer_bias[0][0];
+	});
+
+	// Loading maps the file, the first pass over the weights is where it gets read
+	add_benchmark(results, options, "load_network_from_file_and_read" + suffix, "bytes", file_size, [&] {
+		basic_network<Scalar> loaded {};
+		load_network_from_file(loaded, network_path);
+
+		Scalar sum { 0 };
+		for (const auto& weights : loaded.layer_weights) {
+			sum += weights.sum();
+		}
+		sink = sum;
+	});
+
+	std::filesystem::remove(network_path);
+}
+
+template<typename Scalar>
+auto bench_activations(std::vector<benchmark_result>& results, const bench_suite_options& options) -> void {
+	std::mt19937 rand_gen { static_cast<std::mt19937::result_type>(options.seed) };
+	std::uniform_real_distribution<Scalar> rand_value { -6, 6 };
+
+	std::vector<Scalar> inputs(activation_bench_size);
+	std::vector<Scalar> bias(activation_bench_size);
+	for (size_t i { 0 }; i < activation_bench_size; ++i) {
+		inputs[i] = rand_value(rand_gen);
+		bias[i] = rand_value(rand_gen);
+	}
+
+	std::vector<Scalar> values(activation_bench_size);
+
+	for (auto function : { activation_function::sigmoid, activation_function::fast_sigmoid, activation_function::relu,
+	                       activation_function::softmax }) {
+		// The copy resetting the inputs is part of every run, it's small next to the activation
+		add_benchmark(results, options, fmt::format("apply_activation/{}", activation_function_name(function)),
+		              "values", activation_bench_size, [&] {
+			              std::copy(inputs.begin(), inputs.end(), values.begin());
+			              apply_activation<Scalar>(values, bias, function);
+		              });
+	}
+}
+
+template<typename Scalar>
+auto bench_nn(const bench_suite_options& options) -> std::vector<benchmark_result> {
+	std::vector<benchmark_result> results {};
+
+	std::mt19937 rand_gen { static_cast<std::mt19937::result_type>(options.seed) };
+	synthetic_dataset dataset { options.digit_count, rand_gen };
+	thread_pool pool { options.thread_count };
+
+	add_benchmark(results, options, "digits_from_path", "digits", static_cast<double>(options.digit_count), [&] {
+		auto digits { digits_from_path(dataset.images_path(), dataset.labels_path()) };
+		label_sink = digits.back().label;
+	});
+
+	add_benchmark(results, options, "mnist_dataset", "digits", static_cast<double>(options.digit_count), [&] {
+		mnist_dataset digits { dataset.images_path(), dataset.labels_path() };
+		label_sink = digits.label(digits.size() - 1);
+	});
+
+	mnist_dataset digits { dataset.images_path(), dataset.labels_path() };
+
+	for (const auto& topology : options.topologies) {
+		bench_network<Scalar>(results, options, topology, digits, pool);
+	}
+
+	bench_activations<Scalar>(results, options);
+
+	return results;
+}
+
+template auto bench_nn<double>(const bench_suite_options& options) -> std::vector<benchmark_result>;
+template auto bench_nn<float>(const bench_suite_options& options) -> std::vector<benchmark_result>;
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <vector>
+
+#include "benchmark.hpp"
+#include "short_types.hpp"
+
+struct bench_suite_options {
+	std::vector<std::vector<u64>> topologies;
+	u64 digit_count;
+	u64 seed;
+	u64 thread_count;
+	benchmark_options benchmark;
+};
+
+// Runs every benchmark on random networks and synthetic digits, MNIST isn't needed
+template<typename Scalar>
+auto bench_nn(const bench_suite_options& options) -> std::vector<benchmark_result>;
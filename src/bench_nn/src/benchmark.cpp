@@ -0,0 +1,95 @@
+#include <algorithm>
+#include <chrono>
+#include <numeric>
+
+#include <fmt/format.h>
+
+#include "allocation_counter.hpp"
+#include "benchmark.hpp"
+
+auto benchmark_result::percentile_nanoseconds(double fraction) const -> double {
+	std::vector<double> sorted { run_nanoseconds };
+	std::sort(sorted.begin(), sorted.end());
+
+	auto index { static_cast<std::size_t>(fraction * static_cast<double>(sorted.size() - 1) + 0.5) };
+	return sorted[index];
+}
+
+auto benchmark_result::items_per_second() const -> double {
+	return items_per_run / (percentile_nanoseconds(0.5) * 1e-9);
+}
+
+auto benchmark_selected(const std::string& name, const benchmark_options& options) -> bool {
+	return name.find(options.filter) != std::string::npos;
+}
+
+auto run_benchmark(std::string name, std::string unit, double items_per_run, const benchmark_options& options,
+                   const std::function<void()>& run) -> benchmark_result {
+	using clock = std::chrono::steady_clock;
+
+	benchmark_result result {
+		.name = std::move(name),
+		.unit = std::move(unit),
+		.items_per_run = items_per_run,
+		.run_nanoseconds = {},
+		.allocations_per_run = 0,
+	};
+
+	run();
+
+	auto start_allocations { heap_allocation_count() };
+	auto start { clock::now() };
+	auto elapsed_seconds = [&] {
+		return std::chrono::duration<double> { clock::now() - start }.count();
+	};
+
+	while (result.run_nanoseconds.size() < options.max_runs
+	       && (result.run_nanoseconds.size() < options.min_runs || elapsed_seconds() < options.min_seconds)) {
+		auto run_start { clock::now() };
+		run();
+		result.run_nanoseconds.push_back(std::chrono::duration<double, std::nano> { clock::now() - run_start }.count());
+	}
+
+	// Recording the timings allocates too, a few times over all runs
+	result.allocations_per_run = static_cast<double>(heap_allocation_count() - start_allocations)
+	                             / static_cast<double>(result.run_nanoseconds.size());
+
+	fmt::print(stderr, "{:<48} {:>8} runs  median {:>12.0f} ns  p99 {:>12.0f} ns  {:>14.0f} {}/s  {:>8.2f} allocs\n",
+	           result.name, result.run_nanoseconds.size(), result.percentile_nanoseconds(0.5),
+	           result.percentile_nanoseconds(0.99), result.items_per_second(), result.unit, result.allocations_per_run);
+
+	return result;
+}
+
+auto write_benchmark_json(std::FILE* output, const std::vector<std::pair<std::string, std::string>>& metadata,
+                          std::span<const benchmark_result> results) -> void {
+	fmt::print(output, "{{\n");
+
+	for (const auto& [key, value] : metadata) {
+		fmt::print(output, "  \"{}\": {},\n", key, value);
+	}
+
+	fmt::print(output, "  \"benchmarks\": [\n");
+
+	for (std::size_t i { 0 }; i < results.size(); ++i) {
+		const auto& result { results[i] };
+		auto total { std::accumulate(result.run_nanoseconds.begin(), result.run_nanoseconds.end(), 0.0) };
+
+		fmt::print(output,
+		           "    {{\"name\": \"{}\", \"unit\": \"{}\", \"items_per_run\": {}, \"runs\": {}, "
+		           "\"median_ns\": {:.1f}, \"p99_ns\": {:.1f}, \"mean_ns\": {:.1f}, \"min_ns\": {:.1f}, "
+		           "\"items_per_second\": {:.1f}, \"allocations_per_run\": {:.3f}",
+		           result.name, result.unit, result.items_per_run, result.run_nanoseconds.size(),
+		           result.percentile_nanoseconds(0.5), result.percentile_nanoseconds(0.99),
+		           total / static_cast<double>(result.run_nanoseconds.size()), result.percentile_nanoseconds(0.0),
+		           result.items_per_second(), result.allocations_per_run);
+
+		for (const auto& [key, value] : result.extra) {
+			fmt::print(output, ", \"{}\": {}", key, value);
+		}
+
+		fmt::print(output, "}}{}\n", i + 1 < results.size() ? "," : "");
+	}
+
+	fmt::print(output, "  ]\n}}\n");
+}
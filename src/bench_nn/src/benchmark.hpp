@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdio>
+#include <functional>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "short_types.hpp"
+
+struct benchmark_options {
+	// Runs stop once both limits are reached, or at max_runs
+	double min_seconds;
+	u64 min_runs;
+	u64 max_runs;
+
+	// Only benchmarks with names containing filter run
+	std::string filter;
+};
+
+struct benchmark_result {
+	std::string name;
+	std::string unit;  // what one item processed by a run is, e.g. "digits"
+	double items_per_run;
+	std::vector<double> run_nanoseconds;
+	double allocations_per_run;
+
+	// Extra numbers written alongside the timings, e.g. memory use
+	std::vector<std::pair<std::string, double>> extra {};
+
+	auto percentile_nanoseconds(double fraction) const -> double;
+	auto items_per_second() const -> double;
+};
+
+// Whether a benchmark called name passes options.filter
+auto benchmark_selected(const std::string& name, const benchmark_options& options) -> bool;
+
+// Times run after one untimed warm up call, every call is one run
+auto run_benchmark(std::string name, std::string unit, double items_per_run, const benchmark_options& options,
+                   const std::function<void()>& run) -> benchmark_result;
+
+// Writes the results as one JSON document, metadata holds already quoted or
+// numeric JSON values keyed by name
+auto write_benchmark_json(std::FILE* output, const std::vector<std::pair<std::string, std::string>>& metadata,
+                          std::span<const benchmark_result> results) -> void;
@@ -0,0 +1,119 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <cxxopts.hpp>
+#include <fmt/format.h>
+
+#include "activation_kernels.hpp"
+#include "bench_nn.hpp"
+#include "benchmark.hpp"
+#include "network.hpp"
+#include "short_types.hpp"
+
+auto main(i32 argc, char* argv[]) -> i32 {
+	cxxopts::Options opts {
+		"NN Benchmark",
+		"Benchmarks inference, cost evaluation and loading on synthetic digits, writing the results as JSON",
+	};
+
+	opts.add_options()
+		("o,output", "Path to write the JSON results to, - for stdout", cxxopts::value<std::string>()->default_value("-"))
+		("f,filter", "Only run benchmarks whose name contains this", cxxopts::value<std::string>()->default_value(""))
+		("topologies", "Space separated topologies to benchmark", cxxopts::value<std::string>()->default_value("784,16,16,10 784,128,64,10"))
+		("n,digits", "Number of synthetic digits to generate", cxxopts::value<u64>()->default_value("10000"))
+		("min-time", "Minimum seconds to spend running each benchmark", cxxopts::value<double>()->default_value("0.5"))
+		("min-runs", "Minimum runs of each benchmark", cxxopts::value<u64>()->default_value("5"))
+		("max-runs", "Maximum runs of each benchmark", cxxopts::value<u64>()->default_value("1000000"))
+		("t,threads", "Number of threads for the pooled benchmarks", cxxopts::value<u64>()->default_value("0"))
+		("s,seed", "Seed for the random networks and digits", cxxopts::value<u64>()->default_value("1"))
+		("p,precision", "Precision of the networks (f64, f32)", cxxopts::value<std::string>()->default_value("f64"));
+
+	// FIXME: catch exceptions thrown by cxxopts::Options::parse on errors
+	auto results = opts.parse(argc, argv);
+
+	bench_suite_options options {
+		.topologies = {},
+		.digit_count = results["digits"].as<u64>(),
+		.seed = results["seed"].as<u64>(),
+		.thread_count = results["threads"].as<u64>(),
+		.benchmark = {
+			.min_seconds = results["min-time"].as<double>(),
+			.min_runs = results["min-runs"].as<u64>(),
+			.max_runs = results["max-runs"].as<u64>(),
+			.filter = results["filter"].as<std::string>(),
+		},
+	};
+
+	{
+		std::istringstream topologies_stream { results["topologies"].as<std::string>() };
+
+		for (std::string topology_text {}; topologies_stream >> topology_text;) {
+			auto topology { parse_network_topology(topology_text) };
+			if (!topology) {
+				fmt::print("Invalid topology \"{}\", expected at least two comma separated non-zero layer sizes\n",
+				           topology_text);
+				std::exit(1);
+			}
+
+			options.topologies.push_back(std::move(*topology));
+		}
+	}
+
+	if (options.digit_count == 0) {
+		fmt::print("Need at least one digit to benchmark\n");
+		std::exit(1);
+	}
+
+	if (options.benchmark.min_runs == 0 || options.benchmark.max_runs < options.benchmark.min_runs) {
+		fmt::print("Need at least one run per benchmark and max-runs no lower than min-runs\n");
+		std::exit(1);
+	}
+
+	if (options.thread_count == 0) {
+		options.thread_count = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	std::string precision { results["precision"].as<std::string>() };
+	std::vector<benchmark_result> benchmark_results {};
+	std::string kernel_isa {};
+
+	if (precision == "f32") {
+		benchmark_results = bench_nn<float>(options);
+		kernel_isa = active_activation_kernels<float>().isa;
+	} else if (precision == "f64") {
+		benchmark_results = bench_nn<double>(options);
+		kernel_isa = active_activation_kernels<double>().isa;
+	} else {
+		fmt::print("Unknown precision \"{}\", expected f64 or f32\n", precision);
+		std::exit(1);
+	}
+
+	std::vector<std::pair<std::string, std::string>> metadata {
+		{ "precision", fmt::format("\"{}\"", precision) },
+		{ "activation_isa", fmt::format("\"{}\"", kernel_isa) },
+		{ "digits", fmt::format("{}", options.digit_count) },
+		{ "threads", fmt::format("{}", options.thread_count) },
+		{ "seed", fmt::format("{}", options.seed) },
+	};
+
+	std::string output_path { results["output"].as<std::string>() };
+	if (output_path == "-") {
+		write_benchmark_json(stdout, metadata, benchmark_results);
+		return 0;
+	}
+
+	std::FILE* output { std::fopen(output_path.c_str(), "w") };
+	if (output == nullptr) {
+		fmt::print("Failed to open \"{}\" to write the results to\n", output_path);
+		std::exit(1);
+	}
+
+	write_benchmark_json(output, metadata, benchmark_results);
+	std::fclose(output);
+}
@@ -0,0 +1,78 @@
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <fmt/format.h>
+#include <unistd.h>
+
+#include "synthetic_dataset.hpp"
+
+auto write_be_u32(std::ofstream& file, u32 value) -> void {
+	const char bytes[] {
+		static_cast<char>(value >> 24),
+		static_cast<char>(value >> 16),
+		static_cast<char>(value >> 8),
+		static_cast<char>(value),
+	};
+
+	file.write(bytes, sizeof bytes);
+}
+
+auto open_output(const std::filesystem::path& path) -> std::ofstream {
+	std::ofstream file { path, std::ios::binary };
+
+	if (!file.is_open()) {
+		fmt::print("Failed to create synthetic dataset file {}\n", path.string());
+		std::exit(1);
+	}
+
+	return file;
+}
+
+synthetic_dataset::synthetic_dataset(u64 digit_count, std::mt19937& rand_gen)
+    : directory { std::filesystem::temp_directory_path() / fmt::format("bench_nn_{}", getpid()) } {
+	std::filesystem::create_directories(directory);
+
+	// Most MNIST pixels are background, keep about the same share of zeros
+	std::bernoulli_distribution rand_ink { 0.2 };
+	std::uniform_int_distribution<u32> rand_pixel { 1, 255 };
+	std::uniform_int_distribution<u32> rand_label { 0, 9 };
+
+	auto images { open_output(images_path()) };
+	write_be_u32(images, 0x803);
+	write_be_u32(images, static_cast<u32>(digit_count));
+	write_be_u32(images, rows);
+	write_be_u32(images, columns);
+
+	std::vector<char> pixels(rows * columns);
+	for (u64 i { 0 }; i < digit_count; ++i) {
+		for (auto& pixel : pixels) {
+			pixel = static_cast<char>(rand_ink(rand_gen) ? rand_pixel(rand_gen) : 0);
+		}
+
+		images.write(pixels.data(), static_cast<std::streamsize>(pixels.size()));
+	}
+
+	auto labels { open_output(labels_path()) };
+	write_be_u32(labels, 0x801);
+	write_be_u32(labels, static_cast<u32>(digit_count));
+
+	for (u64 i { 0 }; i < digit_count; ++i) {
+		labels.put(static_cast<char>(rand_label(rand_gen)));
+	}
+}
+
+synthetic_dataset::~synthetic_dataset() {
+	std::error_code error {};
+	std::filesystem::remove_all(directory, error);
+}
+
+auto synthetic_dataset::images_path() const -> std::string {
+	return (directory / "images").string();
+}
+
+auto synthetic_dataset::labels_path() const -> std::string {
+	return (directory / "labels").string();
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <filesystem>
+#include <random>
+
+#include "short_types.hpp"
+
+// MNIST shaped IDX files of random digits in a temporary directory, removed
+// again when destroyed
+class synthetic_dataset {
+public:
+	synthetic_dataset(u64 digit_count, std::mt19937& rand_gen);
+	~synthetic_dataset();
+
+	synthetic_dataset(const synthetic_dataset&) = delete;
+	auto operator=(const synthetic_dataset&) -> synthetic_dataset& = delete;
+
+	auto images_path() const -> std::string;
+	auto labels_path() const -> std::string;
+
+	static constexpr u32 rows { 28 };
+	static constexpr u32 columns { 28 };
+
+private:
+	std::filesystem::path directory;
+};
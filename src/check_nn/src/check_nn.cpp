@@ -1,21 +1,22 @@
 #include <algorithm>
-#include <array>
 #include <cstdio>
 #include <iterator>
+#include <optional>
+#include <span>
 #include <utility>
+#include <vector>
 
 #include <SFML/Graphics.hpp>
 #include <fmt/format.h>
 
+#include "check_network_fits_dataset.hpp"
 #include "check_nn.hpp"
 #include "constrained_integral.hpp"
-#include "load_mnist_digits.hpp"
+#include "mnist_dataset.hpp"
 #include "short_types.hpp"
 
-auto image_from_digit(const digit& in_digit) -> sf::Image {
-	const auto& digit_pixels = in_digit.pixels;
-
-	std::array<u8, 28 * 28 * 4> pixels {};
+static auto rgba_from_digit(std::span<const u8> digit_pixels, std::vector<u8>& pixels) -> void {
+	pixels.resize(digit_pixels.size() * 4);
 
 	for (size_t i = 0; i < digit_pixels.size(); ++i) {
 		pixels[i * 4 + 0] = digit_pixels[i];
@@ -23,26 +24,62 @@ auto image_from_digit(const digit& in_digit) -> sf::Image {
 		pixels[i * 4 + 2] = digit_pixels[i];
 		pixels[i * 4 + 3] = 255;
 	}
-
-	sf::Image image {};
-	image.create(28, 28, pixels.data());
-
-	return image;
 }
 
-auto check_nn(const network& net) -> void {
-	auto digits = digits_from_path("data/mnist_training_images", "data/mnist_training_labels");
+auto check_nn(const model_handle& model, const mnist_dataset& digits, std::span<const misclassified_digit> mistakes)
+    -> void {
+	check_network_fits_dataset(*model.get(), digits);
+
+	u32 columns { static_cast<u32>(digits.image_columns()) };
+	u32 rows { static_cast<u32>(digits.image_rows()) };
 
 	std::pair<u32, u32> scale_factor { 30, 30 };
 	sf::RenderWindow window {
-		{ 28 * scale_factor.first, 28 * scale_factor.second },
+		{ columns * scale_factor.first, rows * scale_factor.second },
 		"window title",
 		sf::Style::None,
 	};
 
 	window.setFramerateLimit(60);
 
-	constrained_integral<size_t> current_digit_index { 0, { 0, digits.size() - 1 } };
+	// Position among the digits stepped through, the mistakes or all of them
+	size_t shown_count { mistakes.empty() ? digits.size() : mistakes.size() };
+	constrained_integral<size_t> current_position { 0, { 0, shown_count - 1 } };
+
+	auto digit_index = [&](size_t position) -> size_t {
+		return mistakes.empty() ? position : mistakes[position].index;
+	};
+
+	// The digit stays in one texture, uploaded again only when another one is shown
+	sf::Texture texture {};
+	texture.create(columns, rows);
+	std::vector<u8> rgba_pixels {};
+
+	sf::Sprite sprite { texture };
+	sprite.setScale(scale_factor.first, scale_factor.second);
+
+	std::optional<size_t> shown_digit_index {};
+
+	network::prediction_workspace workspace {};
+	u64 predicted_version { 0 };
+
+	auto print_prediction = [&] {
+		predicted_version = model.version();
+
+		size_t index { digit_index(current_position) };
+
+		auto net { model.get() };
+		const auto& prediction = net->get_prediction(digits.sample(index), workspace);
+		size_t predicted_digit = std::distance(
+		    prediction.data(), std::max_element(prediction.data(), prediction.data() + prediction.size()));
+
+		fmt::print(" {} | {}", predicted_digit, digits.label(index));
+		if (!mistakes.empty()) {
+			fmt::print(" | digit {:6d}, mistake {} / {}", index, size_t { current_position } + 1, shown_count);
+		}
+		fmt::print("\r");
+		std::fflush(stdout);
+	};
 
 	fmt::print("Opening digit viewer. Press 'q' in window to quit\n");
 	while (window.isOpen()) {
@@ -58,30 +95,27 @@ auto check_nn(const network& net) -> void {
 				}
 
 				if (event.key.code == sf::Keyboard::Key::Right) {
-					current_digit_index += 1;
+					current_position += 1;
 				}
 
 				if (event.key.code == sf::Keyboard::Key::Left) {
-					current_digit_index -= 1;
+					current_position -= 1;
 				}
 
-				auto prediction = net.get_prediction(digits[current_digit_index].pixels);
-				size_t predicted_digit = std::distance(
-				    prediction.data(), std::max_element(prediction.data(), prediction.data() + prediction.size()));
-
-				fmt::print(" {} | {}\r", predicted_digit, digits[current_digit_index].label);
-				std::fflush(stdout);
+				print_prediction();
 			}
 		}
 
-		sf::Image image { image_from_digit(digits[current_digit_index]) };
-
-		sf::Texture texture {};
-		texture.loadFromImage(image);
+		// The shown digit gets predicted again by a network saved since
+		if (predicted_version != 0 && predicted_version != model.version()) {
+			print_prediction();
+		}
 
-		sf::Sprite sprite {};
-		sprite.setTexture(texture);
-		sprite.setScale(scale_factor.first, scale_factor.second);
+		if (size_t index { digit_index(current_position) }; shown_digit_index != index) {
+			rgba_from_digit(digits.sample(index), rgba_pixels);
+			texture.update(rgba_pixels.data());
+			shown_digit_index = index;
+		}
 
 		window.draw(sprite);
 		window.display();
@@ -1,3 +1,10 @@
-#include "network.hpp"
+#include <span>
 
-auto check_nn(const network& net) -> void;
+#include "evaluation_report.hpp"
+#include "mnist_dataset.hpp"
+#include "model_handle.hpp"
+
+// Predicts with the latest version of the network, new ones show up as
+// they're saved. Steps through only the mistakes if there are any, every digit otherwise
+auto check_nn(const model_handle& model, const mnist_dataset& digits, std::span<const misclassified_digit> mistakes)
+    -> void;
@@ -1,14 +1,18 @@
 #include <cstdlib>
 #include <filesystem>
+#include <optional>
 #include <string>
+#include <vector>
 
 #include <cxxopts.hpp>
 #include <fmt/format.h>
 
 #include "check_nn.hpp"
-#include "network.hpp"
-#include "network_from_file.hpp"
+#include "mistakes_file.hpp"
+#include "mnist_dataset.hpp"
+#include "model_handle.hpp"
 #include "short_types.hpp"
+#include "trace.hpp"
 
 auto main(i32 argc, char* argv[]) -> i32 {
 	cxxopts::Options opts {
@@ -18,7 +22,10 @@ auto main(i32 argc, char* argv[]) -> i32 {
 
 	opts.add_options()
 		("d,data-dir", "Path to mnist data directory", cxxopts::value<std::string>()->default_value("data"))
-		("i,input", "Path to network binary", cxxopts::value<std::string>()->default_value("neural_network.nn"));
+		("i,input", "Path to network binary", cxxopts::value<std::string>()->default_value("neural_network.nn"))
+		("s,split", "Dataset split to check, training or testing", cxxopts::value<std::string>()->default_value("training"))
+		("m,mistakes", "Mistakes file written by test_nn, to step through only the digits of the split it lists", cxxopts::value<std::string>())
+		("trace", "Path to write a Chrome trace event file of the run to, needs a build with NN_TRACING", cxxopts::value<std::string>());
 
 	opts.parse_positional("input");
 
@@ -40,9 +47,42 @@ auto main(i32 argc, char* argv[]) -> i32 {
 		std::exit(1);
 	}
 
-	network neural_net { 28 * 28, 16, 16, 10 };
-	load_network_from_file(neural_net, network_filepath);
+	std::string split { results["split"].as<std::string>() };
+	if (split != "training" && split != "testing") {
+		fmt::print("Unknown split \"{}\", it's either training or testing\n", split);
+		std::exit(1);
+	}
+
+	mnist_dataset digits { data_dir + "/mnist_" + split + "_images", data_dir + "/mnist_" + split + "_labels" };
+
+	std::vector<misclassified_digit> mistakes {};
+	if (results.count("mistakes") != 0) {
+		std::string mistakes_filepath { results["mistakes"].as<std::string>() };
+		mistakes = load_mistakes_file(mistakes_filepath, split);
+
+		if (mistakes.empty()) {
+			fmt::print("Mistakes file \"{}\" lists no {} digits\n", mistakes_filepath, split);
+			std::exit(1);
+		}
+
+		for (const auto& mistake : mistakes) {
+			if (mistake.index >= digits.size()) {
+				fmt::print("Mistakes file \"{}\" lists {} digit {}, there are only {}\n", mistakes_filepath, split,
+				           mistake.index, digits.size());
+				std::exit(1);
+			}
+		}
+
+		fmt::print("Stepping through the {} misclassified {} digits\n", mistakes.size(), split);
+	}
+
+	std::optional<trace_session> trace {};
+	if (results.count("trace") != 0) {
+		trace.emplace(results["trace"].as<std::string>());
+	}
+
+	model_handle model { network_filepath };
 
-	check_nn(neural_net);
+	check_nn(model, digits, mistakes);
 }
 
@@ -0,0 +1,51 @@
+#include <cstddef>
+#include <functional>
+
+#include <Eigen/Eigen>
+
+#include "accuracy_of_neural_net.hpp"
+
+// Correct predictions among the digits [first, last), evaluated as one batch
+template<typename Scalar>
+auto correct_predictions_of_digits(const basic_network<Scalar>& neural_net, const mnist_dataset& digits, size_t first,
+                                   size_t last) -> size_t {
+	// One per thread, chunks of the same thread reuse its buffers
+	thread_local typename basic_network<Scalar>::prediction_workspace workspace {};
+	auto predictions { neural_net.predict_batch(digits.pixels(first, last - first), workspace) };
+
+	size_t total_correct { 0 };
+	for (size_t i { first }; i < last; ++i) {
+		if (predicted_digit(predictions.row(static_cast<Eigen::Index>(i - first))) == digits.label(i)) {
+			total_correct += 1;
+		}
+	}
+
+	return total_correct;
+}
+
+template<typename Scalar>
+auto correct_predictions_of_neural_net(const basic_network<Scalar>& neural_net, const mnist_dataset& digits)
+    -> size_t {
+	return reduce_chunks(
+	    digits.size(), prediction_batch_size, size_t { 0 },
+	    [&](size_t first, size_t last) { return correct_predictions_of_digits(neural_net, digits, first, last); },
+	    std::plus {});
+}
+
+template<typename Scalar>
+auto correct_predictions_of_neural_net(const basic_network<Scalar>& neural_net, const mnist_dataset& digits,
+                                       thread_pool& pool) -> size_t {
+	return pool.parallel_reduce(
+	    digits.size(), prediction_batch_size, size_t { 0 },
+	    [&](size_t first, size_t last) { return correct_predictions_of_digits(neural_net, digits, first, last); },
+	    std::plus {});
+}
+
+template auto correct_predictions_of_neural_net(const network& neural_net, const mnist_dataset& digits) -> size_t;
+template auto correct_predictions_of_neural_net(const network_f32& neural_net, const mnist_dataset& digits)
+    -> size_t;
+
+template auto correct_predictions_of_neural_net(const network& neural_net, const mnist_dataset& digits,
+                                                thread_pool& pool) -> size_t;
+template auto correct_predictions_of_neural_net(const network_f32& neural_net, const mnist_dataset& digits,
+                                                thread_pool& pool) -> size_t;
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+
+#include <Eigen/Eigen>
+
+#include "mnist_dataset.hpp"
+#include "network.hpp"
+#include "thread_pool.hpp"
+
+template<typename Derived>
+auto predicted_digit(const Eigen::MatrixBase<Derived>& prediction) -> size_t {
+	Eigen::Index max_index { 0 };
+	prediction.maxCoeff(&max_index);
+
+	return static_cast<size_t>(max_index);
+}
+
+// Returns how many of the digits the network predicts the correct label for
+template<typename Scalar>
+auto correct_predictions_of_neural_net(const basic_network<Scalar>& neural_net, const mnist_dataset& digits)
+    -> size_t;
+
+template<typename Scalar>
+auto correct_predictions_of_neural_net(const basic_network<Scalar>& neural_net, const mnist_dataset& digits,
+                                       thread_pool& pool) -> size_t;
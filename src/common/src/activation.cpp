@@ -0,0 +1,75 @@
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <utility>
+
+#include "activation.hpp"
+#include "activation_kernels.hpp"
+
+using std::size_t;
+
+constexpr std::array activation_function_names {
+	std::pair { activation_function::sigmoid, std::string_view { "sigmoid" } },
+	std::pair { activation_function::fast_sigmoid, std::string_view { "fast-sigmoid" } },
+	std::pair { activation_function::relu, std::string_view { "relu" } },
+	std::pair { activation_function::softmax, std::string_view { "softmax" } },
+};
+
+auto activation_function_name(activation_function function) -> std::string_view {
+	for (const auto& [known_function, name] : activation_function_names) {
+		if (known_function == function) {
+			return name;
+		}
+	}
+
+	return "unknown";
+}
+
+auto activation_function_from_name(std::string_view name) -> std::optional<activation_function> {
+	for (const auto& [function, known_name] : activation_function_names) {
+		if (known_name == name) {
+			return function;
+		}
+	}
+
+	return std::nullopt;
+}
+
+template<typename Scalar>
+auto apply_activation(std::span<Scalar> values, std::span<const Scalar> bias, activation_function function) -> void {
+	const auto& kernels = active_activation_kernels<Scalar>();
+
+	switch (function) {
+		case activation_function::sigmoid:
+			kernels.sigmoid(values.data(), bias.data(), values.size());
+			break;
+
+		case activation_function::fast_sigmoid:
+			kernels.fast_sigmoid(values.data(), bias.data(), values.size());
+			break;
+
+		case activation_function::relu:
+			kernels.relu(values.data(), bias.data(), values.size());
+			break;
+
+		case activation_function::softmax: {
+			// Shift by the largest sum so exp can't overflow
+			Scalar shift { values[0] + bias[0] };
+			for (size_t i { 1 }; i < values.size(); ++i) {
+				shift = std::max(shift, values[i] + bias[i]);
+			}
+
+			const Scalar sum { kernels.shifted_exp(values.data(), bias.data(), shift, values.size()) };
+			for (auto& value : values) {
+				value /= sum;
+			}
+			break;
+		}
+	}
+}
+
+template auto apply_activation(std::span<double> values, std::span<const double> bias, activation_function function) -> void;
+template auto apply_activation(std::span<float> values, std::span<const float> bias, activation_function function) -> void;
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <optional>
+#include <span>
+#include <string_view>
+
+#include "short_types.hpp"
+
+// Stored as a byte per layer in network files, don't reorder
+enum class activation_function : u8 {
+	sigmoid = 0,
+	fast_sigmoid = 1,  // 0.5 * (1 + x / (1 + |x|)), sigmoid shaped without exp
+	relu = 2,
+	softmax = 3,
+};
+
+auto activation_function_name(activation_function function) -> std::string_view;
+auto activation_function_from_name(std::string_view name) -> std::optional<activation_function>;
+
+// Adds bias to values and applies function to the sums in a single pass,
+// using the widest SIMD kernels the cpu supports
+template<typename Scalar>
+auto apply_activation(std::span<Scalar> values, std::span<const Scalar> bias, activation_function function) -> void;
@@ -0,0 +1,446 @@
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+#include <immintrin.h>
+
+#include "activation_kernels.hpp"
+
+using std::size_t;
+
+// Portable fallback, also handles the tails the simd kernels leave over
+
+template<typename Scalar>
+auto scalar_sigmoid(Scalar* values, const Scalar* bias, size_t count) -> void {
+	for (size_t i { 0 }; i < count; ++i) {
+		values[i] = Scalar { 1 } / (Scalar { 1 } + std::exp(-(values[i] + bias[i])));
+	}
+}
+
+template<typename Scalar>
+auto scalar_fast_sigmoid(Scalar* values, const Scalar* bias, size_t count) -> void {
+	for (size_t i { 0 }; i < count; ++i) {
+		const Scalar x { values[i] + bias[i] };
+		values[i] = Scalar { 0.5 } * (Scalar { 1 } + x / (Scalar { 1 } + std::abs(x)));
+	}
+}
+
+template<typename Scalar>
+auto scalar_relu(Scalar* values, const Scalar* bias, size_t count) -> void {
+	for (size_t i { 0 }; i < count; ++i) {
+		values[i] = std::max(values[i] + bias[i], Scalar { 0 });
+	}
+}
+
+template<typename Scalar>
+auto scalar_shifted_exp(Scalar* values, const Scalar* bias, Scalar shift, size_t count) -> Scalar {
+	Scalar sum { 0 };
+
+	for (size_t i { 0 }; i < count; ++i) {
+		values[i] = std::exp(values[i] + bias[i] - shift);
+		sum += values[i];
+	}
+
+	return sum;
+}
+
+// exp(x) = 2^n * exp(r) with n = round(x / ln 2) and |r| <= ln 2 / 2, exp(r) is
+// a taylor polynomial, long enough to stay within a couple ulp of std::exp.
+// Inputs are clamped so 2^n stays a normal number, sigmoid saturates long before that
+
+inline constexpr float exp_min_f32 { -87.0f };
+inline constexpr float exp_max_f32 { 88.0f };
+inline constexpr double exp_min_f64 { -708.0 };
+inline constexpr double exp_max_f64 { 709.0 };
+
+inline constexpr double ln2_hi { 0.693145751953125 };
+inline constexpr double ln2_lo { 1.42860682030941723212e-6 };
+inline constexpr double log2e { 1.44269504088896340736 };
+
+__attribute__((target("avx2,fma"))) inline auto avx2_exp(__m256 x) -> __m256 {
+	x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(exp_min_f32)), _mm256_set1_ps(exp_max_f32));
+
+	const __m256 n { _mm256_round_ps(_mm256_mul_ps(x, _mm256_set1_ps(log2e)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC) };
+	__m256 r { _mm256_fnmadd_ps(n, _mm256_set1_ps(ln2_hi), x) };
+	r = _mm256_fnmadd_ps(n, _mm256_set1_ps(ln2_lo), r);
+
+	__m256 p { _mm256_set1_ps(1.0f / 720) };
+	p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(1.0f / 120));
+	p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(1.0f / 24));
+	p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(1.0f / 6));
+	p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(0.5f));
+	p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(1.0f));
+	p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(1.0f));
+
+	const __m256i exponent { _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(127)), 23) };
+	return _mm256_mul_ps(p, _mm256_castsi256_ps(exponent));
+}
+
+__attribute__((target("avx2,fma"))) inline auto avx2_exp(__m256d x) -> __m256d {
+	x = _mm256_min_pd(_mm256_max_pd(x, _mm256_set1_pd(exp_min_f64)), _mm256_set1_pd(exp_max_f64));
+
+	const __m256d n { _mm256_round_pd(_mm256_mul_pd(x, _mm256_set1_pd(log2e)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC) };
+	__m256d r { _mm256_fnmadd_pd(n, _mm256_set1_pd(ln2_hi), x) };
+	r = _mm256_fnmadd_pd(n, _mm256_set1_pd(ln2_lo), r);
+
+	__m256d p { _mm256_set1_pd(1.0 / 39916800) };
+	p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0 / 3628800));
+	p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0 / 362880));
+	p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0 / 40320));
+	p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0 / 5040));
+	p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0 / 720));
+	p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0 / 120));
+	p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0 / 24));
+	p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0 / 6));
+	p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(0.5));
+	p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0));
+	p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0));
+
+	// avx2 has no double to int64 conversion, adding 1.5 * 2^52 leaves n in the low mantissa bits
+	const __m256i n_bits { _mm256_castpd_si256(_mm256_add_pd(n, _mm256_set1_pd(6755399441055744.0))) };
+	const __m256i exponent { _mm256_slli_epi64(_mm256_add_epi64(n_bits, _mm256_set1_epi64x(1023)), 52) };
+	return _mm256_mul_pd(p, _mm256_castsi256_pd(exponent));
+}
+
+__attribute__((target("avx512f"))) inline auto avx512_exp(__m512 x) -> __m512 {
+	x = _mm512_min_ps(_mm512_max_ps(x, _mm512_set1_ps(exp_min_f32)), _mm512_set1_ps(exp_max_f32));
+
+	const __m512 n { _mm512_roundscale_ps(_mm512_mul_ps(x, _mm512_set1_ps(log2e)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC) };
+	__m512 r { _mm512_fnmadd_ps(n, _mm512_set1_ps(ln2_hi), x) };
+	r = _mm512_fnmadd_ps(n, _mm512_set1_ps(ln2_lo), r);
+
+	__m512 p { _mm512_set1_ps(1.0f / 720) };
+	p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(1.0f / 120));
+	p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(1.0f / 24));
+	p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(1.0f / 6));
+	p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(0.5f));
+	p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(1.0f));
+	p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(1.0f));
+
+	return _mm512_scalef_ps(p, n);
+}
+
+__attribute__((target("avx512f"))) inline auto avx512_exp(__m512d x) -> __m512d {
+	x = _mm512_min_pd(_mm512_max_pd(x, _mm512_set1_pd(exp_min_f64)), _mm512_set1_pd(exp_max_f64));
+
+	const __m512d n { _mm512_roundscale_pd(_mm512_mul_pd(x, _mm512_set1_pd(log2e)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC) };
+	__m512d r { _mm512_fnmadd_pd(n, _mm512_set1_pd(ln2_hi), x) };
+	r = _mm512_fnmadd_pd(n, _mm512_set1_pd(ln2_lo), r);
+
+	__m512d p { _mm512_set1_pd(1.0 / 39916800) };
+	p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(1.0 / 3628800));
+	p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(1.0 / 362880));
+	p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(1.0 / 40320));
+	p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(1.0 / 5040));
+	p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(1.0 / 720));
+	p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(1.0 / 120));
+	p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(1.0 / 24));
+	p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(1.0 / 6));
+	p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(0.5));
+	p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(1.0));
+	p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(1.0));
+
+	return _mm512_scalef_pd(p, n);
+}
+
+// avx2 kernels, 8 floats or 4 doubles per step with the tail done by the scalar kernel
+
+__attribute__((target("avx2,fma"))) auto avx2_sigmoid(float* values, const float* bias, size_t count) -> void {
+	const __m256 one { _mm256_set1_ps(1.0f) };
+	const __m256 sign { _mm256_set1_ps(-0.0f) };
+
+	size_t i { 0 };
+	for (; i + 8 <= count; i += 8) {
+		const __m256 x { _mm256_add_ps(_mm256_loadu_ps(values + i), _mm256_loadu_ps(bias + i)) };
+		const __m256 e { avx2_exp(_mm256_xor_ps(x, sign)) };
+		_mm256_storeu_ps(values + i, _mm256_div_ps(one, _mm256_add_ps(one, e)));
+	}
+
+	scalar_sigmoid(values + i, bias + i, count - i);
+}
+
+__attribute__((target("avx2,fma"))) auto avx2_sigmoid(double* values, const double* bias, size_t count) -> void {
+	const __m256d one { _mm256_set1_pd(1.0) };
+	const __m256d sign { _mm256_set1_pd(-0.0) };
+
+	size_t i { 0 };
+	for (; i + 4 <= count; i += 4) {
+		const __m256d x { _mm256_add_pd(_mm256_loadu_pd(values + i), _mm256_loadu_pd(bias + i)) };
+		const __m256d e { avx2_exp(_mm256_xor_pd(x, sign)) };
+		_mm256_storeu_pd(values + i, _mm256_div_pd(one, _mm256_add_pd(one, e)));
+	}
+
+	scalar_sigmoid(values + i, bias + i, count - i);
+}
+
+__attribute__((target("avx2,fma"))) auto avx2_fast_sigmoid(float* values, const float* bias, size_t count) -> void {
+	const __m256 one { _mm256_set1_ps(1.0f) };
+	const __m256 half { _mm256_set1_ps(0.5f) };
+	const __m256 sign { _mm256_set1_ps(-0.0f) };
+
+	size_t i { 0 };
+	for (; i + 8 <= count; i += 8) {
+		const __m256 x { _mm256_add_ps(_mm256_loadu_ps(values + i), _mm256_loadu_ps(bias + i)) };
+		const __m256 denominator { _mm256_add_ps(one, _mm256_andnot_ps(sign, x)) };
+		_mm256_storeu_ps(values + i, _mm256_fmadd_ps(half, _mm256_div_ps(x, denominator), half));
+	}
+
+	scalar_fast_sigmoid(values + i, bias + i, count - i);
+}
+
+__attribute__((target("avx2,fma"))) auto avx2_fast_sigmoid(double* values, const double* bias, size_t count) -> void {
+	const __m256d one { _mm256_set1_pd(1.0) };
+	const __m256d half { _mm256_set1_pd(0.5) };
+	const __m256d sign { _mm256_set1_pd(-0.0) };
+
+	size_t i { 0 };
+	for (; i + 4 <= count; i += 4) {
+		const __m256d x { _mm256_add_pd(_mm256_loadu_pd(values + i), _mm256_loadu_pd(bias + i)) };
+		const __m256d denominator { _mm256_add_pd(one, _mm256_andnot_pd(sign, x)) };
+		_mm256_storeu_pd(values + i, _mm256_fmadd_pd(half, _mm256_div_pd(x, denominator), half));
+	}
+
+	scalar_fast_sigmoid(values + i, bias + i, count - i);
+}
+
+__attribute__((target("avx2,fma"))) auto avx2_relu(float* values, const float* bias, size_t count) -> void {
+	const __m256 zero { _mm256_setzero_ps() };
+
+	size_t i { 0 };
+	for (; i + 8 <= count; i += 8) {
+		const __m256 x { _mm256_add_ps(_mm256_loadu_ps(values + i), _mm256_loadu_ps(bias + i)) };
+		_mm256_storeu_ps(values + i, _mm256_max_ps(x, zero));
+	}
+
+	scalar_relu(values + i, bias + i, count - i);
+}
+
+__attribute__((target("avx2,fma"))) auto avx2_relu(double* values, const double* bias, size_t count) -> void {
+	const __m256d zero { _mm256_setzero_pd() };
+
+	size_t i { 0 };
+	for (; i + 4 <= count; i += 4) {
+		const __m256d x { _mm256_add_pd(_mm256_loadu_pd(values + i), _mm256_loadu_pd(bias + i)) };
+		_mm256_storeu_pd(values + i, _mm256_max_pd(x, zero));
+	}
+
+	scalar_relu(values + i, bias + i, count - i);
+}
+
+__attribute__((target("avx2,fma"))) auto avx2_shifted_exp(float* values, const float* bias, float shift, size_t count) -> float {
+	const __m256 shift_vector { _mm256_set1_ps(shift) };
+	__m256 sum { _mm256_setzero_ps() };
+
+	size_t i { 0 };
+	for (; i + 8 <= count; i += 8) {
+		const __m256 x { _mm256_add_ps(_mm256_loadu_ps(values + i), _mm256_loadu_ps(bias + i)) };
+		const __m256 e { avx2_exp(_mm256_sub_ps(x, shift_vector)) };
+		_mm256_storeu_ps(values + i, e);
+		sum = _mm256_add_ps(sum, e);
+	}
+
+	alignas(32) float lanes[8];
+	_mm256_store_ps(lanes, sum);
+
+	float total { scalar_shifted_exp(values + i, bias + i, shift, count - i) };
+	for (const auto lane : lanes) {
+		total += lane;
+	}
+
+	return total;
+}
+
+__attribute__((target("avx2,fma"))) auto avx2_shifted_exp(double* values, const double* bias, double shift, size_t count) -> double {
+	const __m256d shift_vector { _mm256_set1_pd(shift) };
+	__m256d sum { _mm256_setzero_pd() };
+
+	size_t i { 0 };
+	for (; i + 4 <= count; i += 4) {
+		const __m256d x { _mm256_add_pd(_mm256_loadu_pd(values + i), _mm256_loadu_pd(bias + i)) };
+		const __m256d e { avx2_exp(_mm256_sub_pd(x, shift_vector)) };
+		_mm256_storeu_pd(values + i, e);
+		sum = _mm256_add_pd(sum, e);
+	}
+
+	alignas(32) double lanes[4];
+	_mm256_store_pd(lanes, sum);
+
+	double total { scalar_shifted_exp(values + i, bias + i, shift, count - i) };
+	for (const auto lane : lanes) {
+		total += lane;
+	}
+
+	return total;
+}
+
+// avx512 kernels, the tail is a masked step so there's no scalar loop
+
+__attribute__((target("avx512f"))) inline auto tail_mask_16(size_t remaining) -> __mmask16 {
+	return remaining >= 16 ? __mmask16 { 0xffff } : static_cast<__mmask16>((1u << remaining) - 1);
+}
+
+__attribute__((target("avx512f"))) inline auto tail_mask_8(size_t remaining) -> __mmask8 {
+	return remaining >= 8 ? __mmask8 { 0xff } : static_cast<__mmask8>((1u << remaining) - 1);
+}
+
+__attribute__((target("avx512f"))) auto avx512_sigmoid(float* values, const float* bias, size_t count) -> void {
+	const __m512 one { _mm512_set1_ps(1.0f) };
+
+	for (size_t i { 0 }; i < count; i += 16) {
+		const __mmask16 mask { tail_mask_16(count - i) };
+		const __m512 x { _mm512_add_ps(_mm512_maskz_loadu_ps(mask, values + i), _mm512_maskz_loadu_ps(mask, bias + i)) };
+		const __m512 e { avx512_exp(_mm512_sub_ps(_mm512_setzero_ps(), x)) };
+		_mm512_mask_storeu_ps(values + i, mask, _mm512_div_ps(one, _mm512_add_ps(one, e)));
+	}
+}
+
+__attribute__((target("avx512f"))) auto avx512_sigmoid(double* values, const double* bias, size_t count) -> void {
+	const __m512d one { _mm512_set1_pd(1.0) };
+
+	for (size_t i { 0 }; i < count; i += 8) {
+		const __mmask8 mask { tail_mask_8(count - i) };
+		const __m512d x { _mm512_add_pd(_mm512_maskz_loadu_pd(mask, values + i), _mm512_maskz_loadu_pd(mask, bias + i)) };
+		const __m512d e { avx512_exp(_mm512_sub_pd(_mm512_setzero_pd(), x)) };
+		_mm512_mask_storeu_pd(values + i, mask, _mm512_div_pd(one, _mm512_add_pd(one, e)));
+	}
+}
+
+__attribute__((target("avx512f"))) auto avx512_fast_sigmoid(float* values, const float* bias, size_t count) -> void {
+	const __m512 one { _mm512_set1_ps(1.0f) };
+	const __m512 half { _mm512_set1_ps(0.5f) };
+
+	for (size_t i { 0 }; i < count; i += 16) {
+		const __mmask16 mask { tail_mask_16(count - i) };
+		const __m512 x { _mm512_add_ps(_mm512_maskz_loadu_ps(mask, values + i), _mm512_maskz_loadu_ps(mask, bias + i)) };
+		const __m512 denominator { _mm512_add_ps(one, _mm512_abs_ps(x)) };
+		_mm512_mask_storeu_ps(values + i, mask, _mm512_fmadd_ps(half, _mm512_div_ps(x, denominator), half));
+	}
+}
+
+__attribute__((target("avx512f"))) auto avx512_fast_sigmoid(double* values, const double* bias, size_t count) -> void {
+	const __m512d one { _mm512_set1_pd(1.0) };
+	const __m512d half { _mm512_set1_pd(0.5) };
+
+	for (size_t i { 0 }; i < count; i += 8) {
+		const __mmask8 mask { tail_mask_8(count - i) };
+		const __m512d x { _mm512_add_pd(_mm512_maskz_loadu_pd(mask, values + i), _mm512_maskz_loadu_pd(mask, bias + i)) };
+		const __m512d denominator { _mm512_add_pd(one, _mm512_abs_pd(x)) };
+		_mm512_mask_storeu_pd(values + i, mask, _mm512_fmadd_pd(half, _mm512_div_pd(x, denominator), half));
+	}
+}
+
+__attribute__((target("avx512f"))) auto avx512_relu(float* values, const float* bias, size_t count) -> void {
+	for (size_t i { 0 }; i < count; i += 16) {
+		const __mmask16 mask { tail_mask_16(count - i) };
+		const __m512 x { _mm512_add_ps(_mm512_maskz_loadu_ps(mask, values + i), _mm512_maskz_loadu_ps(mask, bias + i)) };
+		_mm512_mask_storeu_ps(values + i, mask, _mm512_max_ps(x, _mm512_setzero_ps()));
+	}
+}
+
+__attribute__((target("avx512f"))) auto avx512_relu(double* values, const double* bias, size_t count) -> void {
+	for (size_t i { 0 }; i < count; i += 8) {
+		const __mmask8 mask { tail_mask_8(count - i) };
+		const __m512d x { _mm512_add_pd(_mm512_maskz_loadu_pd(mask, values + i), _mm512_maskz_loadu_pd(mask, bias + i)) };
+		_mm512_mask_storeu_pd(values + i, mask, _mm512_max_pd(x, _mm512_setzero_pd()));
+	}
+}
+
+__attribute__((target("avx512f"))) auto avx512_shifted_exp(float* values, const float* bias, float shift, size_t count) -> float {
+	const __m512 shift_vector { _mm512_set1_ps(shift) };
+	__m512 sum { _mm512_setzero_ps() };
+
+	for (size_t i { 0 }; i < count; i += 16) {
+		const __mmask16 mask { tail_mask_16(count - i) };
+		const __m512 x { _mm512_add_ps(_mm512_maskz_loadu_ps(mask, values + i), _mm512_maskz_loadu_ps(mask, bias + i)) };
+		const __m512 e { avx512_exp(_mm512_sub_ps(x, shift_vector)) };
+		_mm512_mask_storeu_ps(values + i, mask, e);
+		sum = _mm512_mask_add_ps(sum, mask, sum, e);
+	}
+
+	return _mm512_reduce_add_ps(sum);
+}
+
+__attribute__((target("avx512f"))) auto avx512_shifted_exp(double* values, const double* bias, double shift, size_t count) -> double {
+	const __m512d shift_vector { _mm512_set1_pd(shift) };
+	__m512d sum { _mm512_setzero_pd() };
+
+	for (size_t i { 0 }; i < count; i += 8) {
+		const __mmask8 mask { tail_mask_8(count - i) };
+		const __m512d x { _mm512_add_pd(_mm512_maskz_loadu_pd(mask, values + i), _mm512_maskz_loadu_pd(mask, bias + i)) };
+		const __m512d e { avx512_exp(_mm512_sub_pd(x, shift_vector)) };
+		_mm512_mask_storeu_pd(values + i, mask, e);
+		sum = _mm512_mask_add_pd(sum, mask, sum, e);
+	}
+
+	return _mm512_reduce_add_pd(sum);
+}
+
+template<typename Scalar>
+const activation_kernels<Scalar> scalar_kernels {
+	"scalar",
+	scalar_sigmoid<Scalar>,
+	scalar_fast_sigmoid<Scalar>,
+	scalar_relu<Scalar>,
+	scalar_shifted_exp<Scalar>,
+};
+
+template<typename Scalar>
+const activation_kernels<Scalar> avx2_kernels {
+	"avx2",
+	avx2_sigmoid,
+	avx2_fast_sigmoid,
+	avx2_relu,
+	avx2_shifted_exp,
+};
+
+template<typename Scalar>
+const activation_kernels<Scalar> avx512_kernels {
+	"avx512",
+	avx512_sigmoid,
+	avx512_fast_sigmoid,
+	avx512_relu,
+	avx512_shifted_exp,
+};
+
+template<typename Scalar>
+auto activation_kernels_for(kernel_isa isa) -> const activation_kernels<Scalar>* {
+	switch (isa) {
+		case kernel_isa::scalar:
+			return &scalar_kernels<Scalar>;
+
+		case kernel_isa::avx2:
+			if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+				return &avx2_kernels<Scalar>;
+			}
+			return nullptr;
+
+		case kernel_isa::avx512:
+			if (__builtin_cpu_supports("avx512f")) {
+				return &avx512_kernels<Scalar>;
+			}
+			return nullptr;
+	}
+
+	return nullptr;
+}
+
+template<typename Scalar>
+auto active_activation_kernels() -> const activation_kernels<Scalar>& {
+	static const activation_kernels<Scalar>& kernels = []() -> const activation_kernels<Scalar>& {
+		for (const auto isa : { kernel_isa::avx512, kernel_isa::avx2 }) {
+			if (const auto* kernels = activation_kernels_for<Scalar>(isa)) {
+				return *kernels;
+			}
+		}
+
+		return scalar_kernels<Scalar>;
+	}();
+
+	return kernels;
+}
+
+template auto activation_kernels_for<double>(kernel_isa isa) -> const activation_kernels<double>*;
+template auto activation_kernels_for<float>(kernel_isa isa) -> const activation_kernels<float>*;
+
+template auto active_activation_kernels<double>() -> const activation_kernels<double>&;
+template auto active_activation_kernels<float>() -> const activation_kernels<float>&;
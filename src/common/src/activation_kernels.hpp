@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+// Fused bias + activation kernels, every function computes
+// values[i] = f(values[i] + bias[i]) for i in [0, count)
+template<typename Scalar>
+struct activation_kernels {
+	using kernel = void (*)(Scalar* values, const Scalar* bias, std::size_t count);
+
+	std::string_view isa;
+
+	kernel sigmoid;
+	kernel fast_sigmoid;
+	kernel relu;
+
+	// values[i] = exp(values[i] + bias[i] - shift), returns the sum of the results
+	Scalar (*shifted_exp)(Scalar* values, const Scalar* bias, Scalar shift, std::size_t count);
+};
+
+enum class kernel_isa {
+	scalar,
+	avx2,
+	avx512,
+};
+
+// Kernels for the best isa the cpu supports, picked once on first use
+template<typename Scalar>
+auto active_activation_kernels() -> const activation_kernels<Scalar>&;
+
+// Kernels for a specific isa, returns nullptr when the cpu doesn't support it
+template<typename Scalar>
+auto activation_kernels_for(kernel_isa isa) -> const activation_kernels<Scalar>*;
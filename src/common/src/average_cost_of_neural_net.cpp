@@ -1,13 +1,13 @@
 #include <cstdlib>
+#include <functional>
 #include <span>
-#include <vector>
 
 #include <fmt/format.h>
 
 #include "average_cost_of_neural_net.hpp"
+#include "trace.hpp"
 
-auto average_cost_of_neural_net(const network& neural_net, const std::vector<digit>& digits, size_t train_count)
-    -> double {
+auto checked_train_count(const mnist_dataset& digits, size_t train_count) -> size_t {
 	if (train_count > digits.size()) {
 		fmt::print("train_count can't be larger then the avaliable digits\n");
 		std::exit(1);
@@ -15,21 +15,97 @@ auto average_cost_of_neural_net(const network& neural_net, const std::vector<dig
 		train_count = digits.size();
 	}
 
-	double total_cost { 0 };
-	for (size_t i { 0 }; i < train_count; ++i) {
-		const auto& digit = digits[i];
+	return train_count;
+}
 
-		auto predictions = neural_net.get_prediction(digit.pixels);
-		predictions[digit.label] -= 1.0;
+// Summed cost of the digits [first, last), evaluated as one batch
+template<typename Scalar>
+auto total_cost_of_digits(const basic_network<Scalar>& neural_net, const Eigen::Ref<const pixel_matrix>& pixels,
+                          std::span<const u8> labels, size_t first, size_t last) -> double {
+	// One per thread, chunks of the same thread reuse its buffers
+	thread_local typename basic_network<Scalar>::prediction_workspace workspace {};
+	auto predictions { neural_net.predict_batch(
+	    pixels.middleRows(static_cast<Eigen::Index>(first), static_cast<Eigen::Index>(last - first)), workspace) };
 
-		double cost { 0.0 };
-		for (auto& p : std::span(predictions.data(), predictions.size())) {
-			cost += p * p;
-		}
+	double total_cost { 0 };
+	for (size_t i { first }; i < last; ++i) {
+		auto prediction { predictions.row(static_cast<Eigen::Index>(i - first)) };
+		prediction[labels[i]] -= Scalar { 1 };
 
-		total_cost += cost;
+		total_cost += static_cast<double>(prediction.squaredNorm());
 	}
-	double average_cost = total_cost / digits.size();
+
+	return total_cost;
+}
+
+template<typename Scalar>
+auto average_cost_of_neural_net(const basic_network<Scalar>& neural_net, const mnist_dataset& digits,
+                                size_t train_count) -> double {
+	TRACE_ZONE("average_cost_of_neural_net");
+
+	train_count = checked_train_count(digits, train_count);
+
+	double total_cost { reduce_chunks(
+		train_count, prediction_batch_size, 0.0,
+		[&](size_t first, size_t last) {
+			return total_cost_of_digits(neural_net, digits.pixels(), digits.labels(), first, last);
+		},
+		std::plus {}) };
+	double average_cost = total_cost / train_count;
+
+	return average_cost;
+}
+
+template<typename Scalar>
+auto average_cost_of_neural_net(const basic_network<Scalar>& neural_net, const mnist_dataset& digits,
+                                thread_pool& pool, size_t train_count) -> double {
+	TRACE_ZONE("average_cost_of_neural_net");
+
+	train_count = checked_train_count(digits, train_count);
+
+	double total_cost { pool.parallel_reduce(
+		train_count, prediction_batch_size, 0.0,
+		[&](size_t first, size_t last) {
+			return total_cost_of_digits(neural_net, digits.pixels(), digits.labels(), first, last);
+		},
+		std::plus {}) };
+	double average_cost = total_cost / train_count;
 
 	return average_cost;
 }
+
+template<typename Scalar>
+auto average_cost_of_neural_net(const basic_network<Scalar>& neural_net, idx_stream& digits, thread_pool& pool)
+    -> double {
+	TRACE_ZONE("average_cost_of_neural_net");
+
+	// Carrying the sum across chunks keeps the order of the additions the
+	// same as summing the mapped dataset in one go
+	double total_cost { 0 };
+
+	digits.rewind();
+	while (const auto* chunk { digits.next() }) {
+		total_cost = pool.parallel_reduce(
+		    chunk->size(), prediction_batch_size, total_cost,
+		    [&](size_t first, size_t last) {
+			    return total_cost_of_digits(neural_net, chunk->pixels, chunk->labels, first, last);
+		    },
+		    std::plus {});
+	}
+
+	return total_cost / static_cast<double>(digits.size());
+}
+
+template auto average_cost_of_neural_net(const network& neural_net, const mnist_dataset& digits, size_t train_count)
+    -> double;
+template auto average_cost_of_neural_net(const network_f32& neural_net, const mnist_dataset& digits,
+                                         size_t train_count) -> double;
+
+template auto average_cost_of_neural_net(const network& neural_net, const mnist_dataset& digits, thread_pool& pool,
+                                         size_t train_count) -> double;
+template auto average_cost_of_neural_net(const network_f32& neural_net, const mnist_dataset& digits,
+                                         thread_pool& pool, size_t train_count) -> double;
+
+template auto average_cost_of_neural_net(const network& neural_net, idx_stream& digits, thread_pool& pool) -> double;
+template auto average_cost_of_neural_net(const network_f32& neural_net, idx_stream& digits, thread_pool& pool)
+    -> double;
@@ -1,10 +1,25 @@
 #pragma once
 
 #include <cstddef>
-#include <vector>
 
-#include "digit.hpp"
+#include "idx_stream.hpp"
+#include "mnist_dataset.hpp"
 #include "network.hpp"
+#include "thread_pool.hpp"
 
-auto average_cost_of_neural_net(const network& neural_net, const std::vector<digit>& digits, size_t train_count = 0)
+template<typename Scalar>
+auto average_cost_of_neural_net(const basic_network<Scalar>& neural_net, const mnist_dataset& digits,
+                                size_t train_count = 0) -> double;
+
+// Splits the digits over the pool, the result is bit identical to the serial
+// overload no matter how many threads the pool has
+template<typename Scalar>
+auto average_cost_of_neural_net(const basic_network<Scalar>& neural_net, const mnist_dataset& digits,
+                                thread_pool& pool, size_t train_count = 0) -> double;
+
+// Reads the stream from its start a chunk at a time, splitting every chunk
+// over the pool. Bit identical to the overloads above when the chunk size is
+// a multiple of prediction_batch_size
+template<typename Scalar>
+auto average_cost_of_neural_net(const basic_network<Scalar>& neural_net, idx_stream& digits, thread_pool& pool)
     -> double;
@@ -0,0 +1,40 @@
+#include <cstdlib>
+
+#include <fmt/format.h>
+
+#include "check_network_fits_dataset.hpp"
+
+// Labels go from 0 to 9
+constexpr u64 digit_label_count { 10 };
+
+template<typename Scalar>
+static auto check_network_fits_images(const basic_network<Scalar>& neural_net, std::size_t pixels_per_image) -> void {
+	if (neural_net.topology.front() != pixels_per_image) {
+		fmt::print("Network takes {} inputs but the digits have {} pixels\n", neural_net.topology.front(),
+		           pixels_per_image);
+
+		std::exit(1);
+	}
+
+	if (neural_net.topology.back() < digit_label_count) {
+		fmt::print("Network has {} outputs, it needs at least {} to predict digits\n", neural_net.topology.back(),
+		           digit_label_count);
+
+		std::exit(1);
+	}
+}
+
+template<typename Scalar>
+auto check_network_fits_dataset(const basic_network<Scalar>& neural_net, const mnist_dataset& dataset) -> void {
+	check_network_fits_images(neural_net, dataset.pixels_per_image());
+}
+
+template<typename Scalar>
+auto check_network_fits_dataset(const basic_network<Scalar>& neural_net, const idx_stream& dataset) -> void {
+	check_network_fits_images(neural_net, dataset.pixels_per_image());
+}
+
+template auto check_network_fits_dataset(const network& neural_net, const mnist_dataset& dataset) -> void;
+template auto check_network_fits_dataset(const network_f32& neural_net, const mnist_dataset& dataset) -> void;
+template auto check_network_fits_dataset(const network& neural_net, const idx_stream& dataset) -> void;
+template auto check_network_fits_dataset(const network_f32& neural_net, const idx_stream& dataset) -> void;
@@ -0,0 +1,13 @@
+#pragma once
+
+#include "idx_stream.hpp"
+#include "mnist_dataset.hpp"
+#include "network.hpp"
+
+// Exits with an error unless neural_net takes one input per pixel of the
+// digits in dataset and has an output for every digit label
+template<typename Scalar>
+auto check_network_fits_dataset(const basic_network<Scalar>& neural_net, const mnist_dataset& dataset) -> void;
+
+template<typename Scalar>
+auto check_network_fits_dataset(const basic_network<Scalar>& neural_net, const idx_stream& dataset) -> void;
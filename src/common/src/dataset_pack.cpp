@@ -0,0 +1,176 @@
+#include <array>
+#include <cstring>
+#include <limits>
+#include <utility>
+
+#include <fmt/format.h>
+#include <sys/stat.h>
+
+#include "dataset_pack.hpp"
+#include "trace.hpp"
+
+constexpr std::array pack_encoding_names {
+	std::pair { pack_encoding::raw, std::string_view { "raw" } },
+	std::pair { pack_encoding::sparse, std::string_view { "sparse" } },
+};
+
+auto dataset_pack_path(const std::string& images_path) -> std::string {
+	return images_path + ".pack";
+}
+
+auto pack_encoding_from_name(std::string_view name) -> std::optional<pack_encoding> {
+	for (const auto& [encoding, encoding_name] : pack_encoding_names) {
+		if (encoding_name == name) {
+			return encoding;
+		}
+	}
+
+	return std::nullopt;
+}
+
+auto pack_encoding_name(pack_encoding encoding) -> std::string_view {
+	for (const auto& [named_encoding, name] : pack_encoding_names) {
+		if (named_encoding == encoding) {
+			return name;
+		}
+	}
+
+	return "unknown";
+}
+
+auto dataset_pack_checksum(std::span<const u8> bytes, u64 hash) -> u64 {
+	for (std::size_t i { 0 }; i + sizeof(u64) <= bytes.size(); i += sizeof(u64)) {
+		u64 word;
+		std::memcpy(&word, bytes.data() + i, sizeof word);
+
+		hash = (hash ^ word) * 0x100000001b3;
+	}
+
+	for (std::size_t i { bytes.size() / sizeof(u64) * sizeof(u64) }; i < bytes.size(); ++i) {
+		hash = (hash ^ bytes[i]) * 0x100000001b3;
+	}
+
+	return hash;
+}
+
+auto source_file_stamp_of(const std::string& filepath) -> std::optional<source_file_stamp> {
+	struct stat file_stat {};
+	if (stat(filepath.c_str(), &file_stat) == -1) {
+		return std::nullopt;
+	}
+
+	return source_file_stamp {
+		.size = static_cast<u64>(file_stat.st_size),
+		.modified = i64 { file_stat.st_mtim.tv_sec } * 1'000'000'000 + file_stat.st_mtim.tv_nsec,
+	};
+}
+
+// Copies the nonzero pixels of a sparse pack into output past their zero
+// runs. output has to be zeroed and exactly as large as the pixels were
+static auto unpack_sparse_pixels(std::span<const u8> packed, std::span<u8> output, const std::string& filepath)
+    -> bool {
+	TRACE_ZONE("unpack_sparse_pixels");
+
+	std::size_t in { 0 };
+	std::size_t out { 0 };
+
+	while (in + 2 <= packed.size()) {
+		std::size_t zero_count { packed[in] };
+		std::size_t pixel_count { packed[in + 1] };
+		in += 2;
+
+		if (out + zero_count + pixel_count > output.size() || in + pixel_count > packed.size()) {
+			break;
+		}
+
+		out += zero_count;
+
+		std::memcpy(output.data() + out, packed.data() + in, pixel_count);
+		out += pixel_count;
+		in += pixel_count;
+	}
+
+	if (in != packed.size() || out != output.size()) {
+		fmt::print("Corrupt pixels in dataset pack {}, reading its IDX files instead\n", filepath);
+		return false;
+	}
+
+	return true;
+}
+
+auto load_dataset_pack(const std::string& images_path, const std::string& labels_path)
+    -> std::optional<dataset_pack> {
+	auto filepath { dataset_pack_path(images_path) };
+	if (!source_file_stamp_of(filepath)) {
+		return std::nullopt;
+	}
+
+	auto file { mapped_file::try_open(filepath) };
+	if (!file) {
+		return std::nullopt;
+	}
+
+	dataset_pack pack { .file = std::move(*file) };
+	auto bytes { pack.file.bytes() };
+
+	dataset_pack_header header {};
+	if (bytes.size() < sizeof header) {
+		fmt::print("Dataset pack {} is truncated, reading its IDX files instead\n", filepath);
+		return std::nullopt;
+	}
+	std::memcpy(&header, bytes.data(), sizeof header);
+
+	if (header.magic_number != dataset_pack_magic_number || header.version != dataset_pack_version) {
+		fmt::print("{} isn't a dataset pack of version {}, reading its IDX files instead, rerun pack_dataset\n",
+		           filepath, dataset_pack_version);
+		return std::nullopt;
+	}
+
+	auto images_stamp { source_file_stamp_of(images_path) };
+	auto labels_stamp { source_file_stamp_of(labels_path) };
+
+	if ((images_stamp
+	     && (images_stamp->size != header.images_size || images_stamp->modified != header.images_modified))
+	    || (labels_stamp
+	        && (labels_stamp->size != header.labels_size || labels_stamp->modified != header.labels_modified))) {
+		fmt::print("Dataset pack {} no longer matches its IDX files, reading those instead\n", filepath);
+		return std::nullopt;
+	}
+
+	// Sizes are checked against what they're multiplied or added with before,
+	// so a crafted header can't wrap them around
+	constexpr u64 max_size { std::numeric_limits<u64>::max() };
+	auto within_file = [&](u64 offset, u64 size) { return offset <= bytes.size() && size <= bytes.size() - offset; };
+
+	bool raw { header.encoding == pack_encoding::raw };
+
+	if ((!raw && header.encoding != pack_encoding::sparse) || header.rows == 0 || header.columns == 0
+	    || header.columns > max_size / header.rows || header.count > max_size / (header.rows * header.columns)
+	    || !within_file(header.labels_offset, header.count) || !within_file(header.pixels_offset, header.pixels_size)) {
+		fmt::print("Corrupt header in dataset pack {}, reading its IDX files instead\n", filepath);
+		return std::nullopt;
+	}
+
+	// A sparse run of two bytes stands for at most 2 * 255 pixels
+	auto pixel_count { header.count * header.rows * header.columns };
+	if ((raw && header.pixels_size != pixel_count) || (!raw && pixel_count / 255 > header.pixels_size)) {
+		fmt::print("Corrupt header in dataset pack {}, reading its IDX files instead\n", filepath);
+		return std::nullopt;
+	}
+
+	pack.rows = header.rows;
+	pack.columns = header.columns;
+	pack.labels = bytes.subspan(header.labels_offset, header.count);
+	pack.pixels = bytes.subspan(header.pixels_offset, header.pixels_size);
+
+	if (!raw) {
+		pack.unpacked_pixels.resize(pixel_count);
+		if (!unpack_sparse_pixels(pack.pixels, pack.unpacked_pixels, filepath)) {
+			return std::nullopt;
+		}
+
+		pack.pixels = pack.unpacked_pixels;
+	}
+
+	return pack;
+}
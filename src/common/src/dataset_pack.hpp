@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "mapped_file.hpp"
+#include "short_types.hpp"
+
+// Dataset packs are caches of an IDX image file and its label file in one
+// file, written by pack_dataset next to the images as <images>.pack. The
+// header below is followed by the labels and then the pixels, both aligned
+// to dataset_pack_alignment so raw pixels can be mapped and used in place
+inline constexpr u32 dataset_pack_magic_number { 0x9ac };
+inline constexpr u32 dataset_pack_version { 1 };
+inline constexpr std::size_t dataset_pack_alignment { 4096 };
+
+enum class pack_encoding : u32 {
+	raw,  // the pixels as the IDX file has them
+	// Runs of zero pixels and the nonzero pixels after them, a zero run length
+	// byte, a nonzero count byte and that many pixels, repeated. Most pixels
+	// of handwritten digits are background, so this stores about a third
+	sparse,
+};
+
+struct dataset_pack_header {
+	u32 magic_number;
+	u32 version;
+	pack_encoding encoding;
+	u32 reserved;
+	u64 count;
+	u64 rows;
+	u64 columns;
+	u64 labels_offset;
+	u64 pixels_offset;
+	u64 pixels_size;  // stored bytes, count * rows * columns when raw
+
+	// Sizes and modification times in nanoseconds of the IDX files the pack
+	// was made from, a pack whose files changed since is stale
+	u64 images_size;
+	i64 images_modified;
+	u64 labels_size;
+	i64 labels_modified;
+
+	u64 source_checksum;  // dataset_pack_checksum of the image file then the label file
+};
+
+auto dataset_pack_path(const std::string& images_path) -> std::string;
+
+auto pack_encoding_from_name(std::string_view name) -> std::optional<pack_encoding>;
+auto pack_encoding_name(pack_encoding encoding) -> std::string_view;
+
+// FNV-1a over 64 bit words like network_file_checksum, continuing from hash
+// and folding in the bytes past the last whole word
+auto dataset_pack_checksum(std::span<const u8> bytes, u64 hash = 0xcbf29ce484222325) -> u64;
+
+// Size and modification time of a file, nullopt if it doesn't exist
+struct source_file_stamp {
+	u64 size;
+	i64 modified;
+};
+
+auto source_file_stamp_of(const std::string& filepath) -> std::optional<source_file_stamp>;
+
+// Pixels and labels of a pack, mapped in place or unpacked into memory
+struct dataset_pack {
+	mapped_file file;
+	std::vector<u8> unpacked_pixels {};
+
+	std::size_t rows { 0 };
+	std::size_t columns { 0 };
+	std::span<const u8> pixels {};
+	std::span<const u8> labels {};
+};
+
+// The pack of the IDX files, nullopt if there is none, it's stale or it can't
+// be read, the IDX files are read instead then. A pack without the IDX files
+// it was made from is used as it is
+auto load_dataset_pack(const std::string& images_path, const std::string& labels_path)
+    -> std::optional<dataset_pack>;
@@ -0,0 +1,185 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <mutex>
+
+#include <Eigen/Eigen>
+#include <fmt/format.h>
+
+#include "accuracy_of_neural_net.hpp"
+#include "evaluation_report.hpp"
+#include "trace.hpp"
+
+auto evaluation_report::correct() const -> u64 {
+	u64 total_correct { 0 };
+	for (std::size_t digit { 0 }; digit < evaluated_digit_count; ++digit) {
+		total_correct += confusion[digit][digit];
+	}
+
+	return total_correct;
+}
+
+auto evaluation_report::accuracy() const -> double {
+	return sample_count == 0 ? 0.0 : static_cast<double>(correct()) / static_cast<double>(sample_count);
+}
+
+auto evaluation_report::precision(std::size_t digit) const -> double {
+	u64 predicted_as_digit { 0 };
+	for (const auto& label_row : confusion) {
+		predicted_as_digit += label_row[digit];
+	}
+
+	if (predicted_as_digit == 0) {
+		return 0.0;
+	}
+
+	return static_cast<double>(confusion[digit][digit]) / static_cast<double>(predicted_as_digit);
+}
+
+auto evaluation_report::recall(std::size_t digit) const -> double {
+	u64 labeled_as_digit { 0 };
+	for (auto count : confusion[digit]) {
+		labeled_as_digit += count;
+	}
+
+	if (labeled_as_digit == 0) {
+		return 0.0;
+	}
+
+	return static_cast<double>(confusion[digit][digit]) / static_cast<double>(labeled_as_digit);
+}
+
+auto evaluation_report::top_k_accuracy(std::size_t k) const -> double {
+	u64 label_in_top_k { 0 };
+	for (std::size_t rank { 0 }; rank < std::min(k, max_top_k); ++rank) {
+		label_in_top_k += label_ranks[rank];
+	}
+
+	return sample_count == 0 ? 0.0 : static_cast<double>(label_in_top_k) / static_cast<double>(sample_count);
+}
+
+auto evaluation_report::operator+=(const evaluation_report& other) -> evaluation_report& {
+	sample_count += other.sample_count;
+
+	for (std::size_t label { 0 }; label < evaluated_digit_count; ++label) {
+		for (std::size_t predicted { 0 }; predicted < evaluated_digit_count; ++predicted) {
+			confusion[label][predicted] += other.confusion[label][predicted];
+		}
+	}
+
+	for (std::size_t rank { 0 }; rank < max_top_k; ++rank) {
+		label_ranks[rank] += other.label_ranks[rank];
+	}
+
+	for (std::size_t bin { 0 }; bin < confidence_bin_count; ++bin) {
+		confident_correct[bin] += other.confident_correct[bin];
+		confident_wrong[bin] += other.confident_wrong[bin];
+	}
+
+	misclassified.insert(misclassified.end(), other.misclassified.begin(), other.misclassified.end());
+
+	return *this;
+}
+
+// Adds the digits [first, last), predicted as one batch, to report
+template<typename Scalar>
+static auto evaluate_digits(const basic_network<Scalar>& neural_net, const mnist_dataset& digits, std::size_t first,
+                            std::size_t last, evaluation_report& report) -> void {
+	TRACE_ZONE("evaluate_digits", "digits", static_cast<i64>(last - first));
+
+	// One per thread, batches of the same thread reuse its buffers
+	thread_local typename basic_network<Scalar>::prediction_workspace workspace {};
+	auto predictions { neural_net.predict_batch(digits.pixels(first, last - first), workspace) };
+
+	for (std::size_t i { first }; i < last; ++i) {
+		auto outputs { predictions.row(static_cast<Eigen::Index>(i - first)).head(evaluated_digit_count) };
+
+		auto label { static_cast<std::size_t>(digits.label(i)) };
+		if (label >= evaluated_digit_count) {
+			fmt::print("Digit {} is labeled {}, labels go from 0 to {}\n", i, label, evaluated_digit_count - 1);
+			std::exit(1);
+		}
+
+		auto predicted { predicted_digit(outputs) };
+
+		// Ties go to the lower digit, like they do for the prediction
+		auto label_output { outputs(static_cast<Eigen::Index>(label)) };
+		std::size_t label_rank { 0 };
+		for (std::size_t digit { 0 }; digit < evaluated_digit_count; ++digit) {
+			auto output { outputs(static_cast<Eigen::Index>(digit)) };
+			if (output > label_output || (digit < label && output == label_output)) {
+				label_rank += 1;
+			}
+		}
+
+		// NaN outputs count as no confidence at all
+		auto confidence { static_cast<double>(outputs(static_cast<Eigen::Index>(predicted))) };
+		confidence = std::isnan(confidence) ? 0.0 : std::clamp(confidence, 0.0, 1.0);
+
+		auto bin { std::min(static_cast<std::size_t>(confidence * confidence_bin_count), confidence_bin_count - 1) };
+
+		report.sample_count += 1;
+		report.confusion[label][predicted] += 1;
+
+		if (label_rank < max_top_k) {
+			report.label_ranks[label_rank] += 1;
+		}
+
+		if (predicted == label) {
+			report.confident_correct[bin] += 1;
+		} else {
+			report.confident_wrong[bin] += 1;
+			report.misclassified.push_back({
+			    .index = static_cast<u32>(i),
+			    .label = static_cast<u8>(label),
+			    .predicted = static_cast<u8>(predicted),
+			});
+		}
+	}
+}
+
+template<typename Scalar>
+auto evaluate_neural_net(const basic_network<Scalar>& neural_net, std::span<const mnist_dataset* const> datasets,
+                         thread_pool& pool) -> std::vector<evaluation_report> {
+	TRACE_ZONE("evaluate_neural_net");
+
+	std::vector<evaluation_report> reports(datasets.size());
+	std::vector<std::mutex> report_mutexes(datasets.size());
+
+	// The tasks are the batches of every dataset, one dataset after the other
+	std::vector<std::size_t> first_tasks { 0 };
+	for (const auto* digits : datasets) {
+		auto batch_count { (digits->size() + prediction_batch_size - 1) / prediction_batch_size };
+		first_tasks.push_back(first_tasks.back() + batch_count);
+	}
+
+	pool.parallel_for(first_tasks.back(), [&](std::size_t task) {
+		auto dataset_index { static_cast<std::size_t>(
+		    std::distance(first_tasks.begin(), std::upper_bound(first_tasks.begin(), first_tasks.end(), task)) - 1) };
+
+		const auto& digits { *datasets[dataset_index] };
+		auto first { (task - first_tasks[dataset_index]) * prediction_batch_size };
+		auto last { std::min(digits.size(), first + prediction_batch_size) };
+
+		evaluation_report batch_report {};
+		evaluate_digits(neural_net, digits, first, last, batch_report);
+
+		digits.release_pixels(first, last - first);
+
+		std::scoped_lock lock { report_mutexes[dataset_index] };
+		reports[dataset_index] += batch_report;
+	});
+
+	// Batches finish in any order, sorting makes the report the same every time
+	for (auto& report : reports) {
+		std::sort(report.misclassified.begin(), report.misclassified.end(),
+		          [](const auto& a, const auto& b) { return a.index < b.index; });
+	}
+
+	return reports;
+}
+
+template auto evaluate_neural_net(const network& neural_net, std::span<const mnist_dataset* const> datasets,
+                                  thread_pool& pool) -> std::vector<evaluation_report>;
+template auto evaluate_neural_net(const network_f32& neural_net, std::span<const mnist_dataset* const> datasets,
+                                  thread_pool& pool) -> std::vector<evaluation_report>;
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+#include "mnist_dataset.hpp"
+#include "network.hpp"
+#include "short_types.hpp"
+#include "thread_pool.hpp"
+
+// Digits 0 to 9, the outputs past them don't take part in an evaluation
+inline constexpr std::size_t evaluated_digit_count { 10 };
+
+// Top-k accuracy is counted for every k from 1 up to this
+inline constexpr std::size_t max_top_k { 5 };
+
+inline constexpr std::size_t confidence_bin_count { 10 };
+
+struct misclassified_digit {
+	u32 index;
+	u8 label;
+	u8 predicted;
+};
+
+// How the predictions of a network compare to the labels of a dataset. The
+// predicted digit is the one with the highest output, and that output clamped
+// to [0, 1] is how confident the prediction is
+struct evaluation_report {
+	u64 sample_count { 0 };
+
+	// Samples by label, then by predicted digit
+	std::array<std::array<u64, evaluated_digit_count>, evaluated_digit_count> confusion {};
+
+	// Samples by the rank of the label's output among the outputs, 0 being
+	// the highest. Ranks of max_top_k and beyond aren't counted
+	std::array<u64, max_top_k> label_ranks {};
+
+	// Correct and wrong predictions by confidence, in bins of 1 / confidence_bin_count
+	std::array<u64, confidence_bin_count> confident_correct {};
+	std::array<u64, confidence_bin_count> confident_wrong {};
+
+	// Sorted by index
+	std::vector<misclassified_digit> misclassified {};
+
+	auto correct() const -> u64;
+	auto accuracy() const -> double;
+
+	// Shares of the samples predicted as digit that are labeled as it, and of
+	// the samples labeled as digit that are predicted as it. 0 without any
+	auto precision(std::size_t digit) const -> double;
+	auto recall(std::size_t digit) const -> double;
+
+	// Share of the samples whose label is among the k highest outputs
+	auto top_k_accuracy(std::size_t k) const -> double;
+
+	// Adds the counts of other, the misclassified digits end up unsorted
+	auto operator+=(const evaluation_report& other) -> evaluation_report&;
+};
+
+// Evaluates the network on every dataset in one parallel pass over the
+// batches of all of them, returning a report per dataset. The reports are the
+// same for any number of threads. Only the batches being predicted stay in
+// memory, the pixels of every other batch are released after it's predicted
+template<typename Scalar>
+auto evaluate_neural_net(const basic_network<Scalar>& neural_net, std::span<const mnist_dataset* const> datasets,
+                         thread_pool& pool) -> std::vector<evaluation_report>;
@@ -0,0 +1,207 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <mutex>
+
+#include <fcntl.h>
+#include <fmt/format.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "idx_stream.hpp"
+#include "trace.hpp"
+
+auto idx_chunk::size() const -> std::size_t {
+	return labels.size();
+}
+
+static auto open_idx_file(const std::string& filepath) -> int {
+	int fd { open(filepath.c_str(), O_RDONLY) };
+	if (fd == -1) {
+		fmt::print("Failed to open \"{}\"\n", filepath);
+		std::exit(1);
+	}
+
+	// Lets the kernel read further ahead than it would for random access
+	posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+	return fd;
+}
+
+static auto file_size(int fd) -> std::size_t {
+	struct stat file_stat {};
+	if (fstat(fd, &file_stat) == -1) {
+		fmt::print("Failed to stat an IDX file\n");
+		std::exit(1);
+	}
+
+	return static_cast<std::size_t>(file_stat.st_size);
+}
+
+// Reads exactly output.size() bytes at offset, short of the file end
+static auto read_at(int fd, std::span<u8> output, std::size_t offset) -> void {
+	while (!output.empty()) {
+		auto read_size { pread(fd, output.data(), output.size(), static_cast<off_t>(offset)) };
+
+		if (read_size == -1 && errno == EINTR) {
+			continue;
+		}
+
+		if (read_size <= 0) {
+			fmt::print("Failed to read an IDX file at byte {}\n", offset);
+			std::exit(1);
+		}
+
+		output = output.subspan(static_cast<std::size_t>(read_size));
+		offset += static_cast<std::size_t>(read_size);
+	}
+}
+
+idx_stream::idx_stream(const std::string& images_path, const std::string& labels_path, std::size_t in_chunk_size,
+                       std::size_t digit_count)
+    : images_fd { open_idx_file(images_path) }
+    , labels_fd { open_idx_file(labels_path) }
+    , samples_per_chunk { std::max<std::size_t>(in_chunk_size, 1) } {
+	auto images_size { file_size(images_fd) };
+	auto labels_size { file_size(labels_fd) };
+
+	std::array<u8, idx_image_header_size> image_header {};
+	std::array<u8, idx_label_header_size> label_header {};
+
+	if (images_size < image_header.size() || labels_size < label_header.size()) {
+		fmt::print("IDX file is too small to contain a header\n");
+		std::exit(1);
+	}
+
+	read_at(images_fd, image_header, 0);
+	read_at(labels_fd, label_header, 0);
+	layout = read_idx_layout(image_header, label_header, digit_count);
+
+	if (images_size < idx_image_header_size + layout.count * pixels_per_image()
+	    || labels_size < idx_label_header_size + layout.count) {
+		fmt::print("IDX files are smaller than the {} digit(s) their headers describe\n", layout.count);
+		std::exit(1);
+	}
+
+	reader = std::thread { &idx_stream::run, this };
+}
+
+idx_stream::~idx_stream() {
+	{
+		std::lock_guard lock { mutex };
+		stopping = true;
+	}
+	changed.notify_all();
+
+	reader.join();
+
+	close(images_fd);
+	close(labels_fd);
+}
+
+auto idx_stream::size() const -> std::size_t {
+	return layout.count;
+}
+
+auto idx_stream::image_rows() const -> std::size_t {
+	return layout.rows;
+}
+
+auto idx_stream::image_columns() const -> std::size_t {
+	return layout.columns;
+}
+
+auto idx_stream::pixels_per_image() const -> std::size_t {
+	return layout.rows * layout.columns;
+}
+
+auto idx_stream::chunk_size() const -> std::size_t {
+	return samples_per_chunk;
+}
+
+auto idx_stream::next() -> const idx_chunk* {
+	std::unique_lock lock { mutex };
+	release_held();
+
+	changed.wait(lock, [&] { return !ready.empty() || (next_first >= layout.count && !reading); });
+
+	if (ready.empty()) {
+		return nullptr;
+	}
+
+	held = ready.front();
+	ready.pop_front();
+
+	return &chunks[*held];
+}
+
+auto idx_stream::rewind(std::size_t first) -> void {
+	{
+		std::lock_guard lock { mutex };
+		release_held();
+
+		free_chunks.insert(free_chunks.end(), ready.begin(), ready.end());
+		ready.clear();
+
+		next_first = first - first % samples_per_chunk;
+		++generation;
+	}
+
+	changed.notify_all();
+}
+
+auto idx_stream::release_held() -> void {
+	if (held) {
+		free_chunks.push_back(*held);
+		held.reset();
+
+		changed.notify_all();
+	}
+}
+
+auto idx_stream::read_chunk(std::size_t first, idx_chunk& chunk) const -> void {
+	TRACE_ZONE("read_chunk", "first", static_cast<i64>(first));
+
+	auto count { std::min(samples_per_chunk, layout.count - first) };
+
+	chunk.first = first;
+	chunk.pixels.resize(static_cast<Eigen::Index>(count), static_cast<Eigen::Index>(pixels_per_image()));
+	chunk.labels.resize(count);
+
+	read_at(images_fd, { chunk.pixels.data(), static_cast<std::size_t>(chunk.pixels.size()) },
+	        idx_image_header_size + first * pixels_per_image());
+	read_at(labels_fd, chunk.labels, idx_label_header_size + first);
+}
+
+auto idx_stream::run() -> void {
+	std::unique_lock lock { mutex };
+
+	while (true) {
+		changed.wait(lock, [&] { return stopping || (!free_chunks.empty() && next_first < layout.count); });
+
+		if (stopping) {
+			return;
+		}
+
+		auto index { free_chunks.back() };
+		free_chunks.pop_back();
+
+		auto first { next_first };
+		auto read_generation { generation };
+		next_first = std::min(layout.count, first + samples_per_chunk);
+		reading = true;
+
+		lock.unlock();
+		read_chunk(first, chunks[index]);
+		lock.lock();
+
+		reading = false;
+		if (read_generation == generation) {
+			ready.push_back(index);
+		} else {
+			free_chunks.push_back(index);
+		}
+
+		changed.notify_all();
+	}
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <array>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "mnist_dataset.hpp"
+#include "network.hpp"
+#include "short_types.hpp"
+
+// Consecutive samples of an IDX image file and its label file
+struct idx_chunk {
+	// Index of the first sample in the files
+	std::size_t first { 0 };
+
+	// A row per sample, ready for network::predict_batch
+	pixel_matrix pixels {};
+	std::vector<u8> labels {};
+
+	auto size() const -> std::size_t;
+};
+
+// Reads an IDX image file and its label file front to back in chunks of
+// chunk_size samples, for datasets too large to map or keep in memory. A
+// background thread reads the next chunk while the caller works on the
+// current one, so at most two chunks are ever in memory
+class idx_stream {
+public:
+	idx_stream(const std::string& images_path, const std::string& labels_path, std::size_t in_chunk_size,
+	           std::size_t digit_count = 0);
+	~idx_stream();
+
+	idx_stream(const idx_stream&) = delete;
+	auto operator=(const idx_stream&) -> idx_stream& = delete;
+
+	auto size() const -> std::size_t;
+	auto image_rows() const -> std::size_t;
+	auto image_columns() const -> std::size_t;
+	auto pixels_per_image() const -> std::size_t;
+	auto chunk_size() const -> std::size_t;
+
+	// The chunk after the one returned last, nullptr past the last sample. It
+	// stays valid until the next call to next or rewind
+	auto next() -> const idx_chunk*;
+
+	// Continues reading at the start of the chunk holding sample first
+	auto rewind(std::size_t first = 0) -> void;
+
+private:
+	auto read_chunk(std::size_t first, idx_chunk& chunk) const -> void;
+	auto run() -> void;
+
+	// Hands the chunk the caller holds back to the reader
+	auto release_held() -> void;
+
+	int images_fd { -1 };
+	int labels_fd { -1 };
+	idx_layout layout {};
+	std::size_t samples_per_chunk;
+
+	std::array<idx_chunk, 2> chunks {};
+
+	std::mutex mutex {};
+	std::condition_variable changed {};
+
+	// Indices into chunks, read ones in file order and ones free to read into
+	std::deque<std::size_t> ready {};
+	std::vector<std::size_t> free_chunks { 0, 1 };
+	std::optional<std::size_t> held {};
+
+	// First sample of the chunk the reader reads next
+	std::size_t next_first { 0 };
+	bool reading { false };
+
+	// Bumped by rewind, chunks read before it are dropped
+	u64 generation { 0 };
+	bool stopping { false };
+
+	std::thread reader {};
+};
@@ -0,0 +1,72 @@
+#include <utility>
+
+#include "incremental_prediction.hpp"
+#include "trace.hpp"
+
+template<typename Scalar>
+auto incremental_prediction<Scalar>::predict(std::shared_ptr<const network_type> net, std::span<const u8> pixels)
+    -> const vector_type& {
+	TRACE_ZONE("incremental_prediction");
+
+	if (net != cached_net || pixels.size() != cached_pixels.size()) {
+		cached_net = std::move(net);
+		recompute(pixels);
+	} else {
+		changed_pixels.clear();
+		std::size_t nonzero_count { 0 };
+
+		for (u32 i { 0 }; i < pixels.size(); ++i) {
+			if (pixels[i] != cached_pixels[i]) {
+				changed_pixels.push_back(i);
+			}
+
+			nonzero_count += pixels[i] != 0 ? 1 : 0;
+		}
+
+		// Recomputing adds up a column per nonzero pixel, updating one per changed pixel
+		if (updates_since_recompute >= full_recompute_interval || changed_pixels.size() > nonzero_count) {
+			recompute(pixels);
+		} else if (!changed_pixels.empty()) {
+			TRACE_ZONE("update_weighted_input", "changed", static_cast<i64>(changed_pixels.size()));
+
+			const auto& weights { cached_net->layer_weights[0] };
+			for (auto i : changed_pixels) {
+				auto change { static_cast<Scalar>(pixels[i]) - static_cast<Scalar>(cached_pixels[i]) };
+				weighted_input.noalias() += (change / Scalar { 256 }) * weights.col(i);
+
+				cached_pixels[i] = pixels[i];
+			}
+
+			updates_since_recompute += 1;
+			total_updates += 1;
+		}
+	}
+
+	return cached_net->predict_from_weighted_input(weighted_input, workspace);
+}
+
+template<typename Scalar>
+auto incremental_prediction<Scalar>::incremental_updates() const -> u64 {
+	return total_updates;
+}
+
+template<typename Scalar>
+auto incremental_prediction<Scalar>::recompute(std::span<const u8> pixels) -> void {
+	TRACE_ZONE("recompute_weighted_input");
+
+	const auto& weights { cached_net->layer_weights[0] };
+
+	cached_pixels.assign(pixels.begin(), pixels.end());
+	weighted_input.setZero(weights.rows());
+
+	for (u32 i { 0 }; i < pixels.size(); ++i) {
+		if (pixels[i] != 0) {
+			weighted_input.noalias() += (static_cast<Scalar>(pixels[i]) / Scalar { 256 }) * weights.col(i);
+		}
+	}
+
+	updates_since_recompute = 0;
+}
+
+template class incremental_prediction<double>;
+template class incremental_prediction<float>;
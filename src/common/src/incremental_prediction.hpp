@@ -0,0 +1,51 @@
+#pragma once
+
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "network.hpp"
+#include "short_types.hpp"
+
+// Predicts for an input that changes a few pixels at a time, like a digit
+// being drawn. The first layer's weighted input is kept between predictions
+// and only the weight columns of the changed pixels are added to it, scaled
+// by how much each pixel changed. The layers after it are small and rerun
+// in full.
+//
+// The sum gets recomputed from scratch every full_recompute_interval updates
+// so rounding errors of the updates can't add up, and whenever that adds up
+// fewer columns than the update would
+template<typename Scalar>
+class incremental_prediction {
+public:
+	using network_type = basic_network<Scalar>;
+	using vector_type = typename network_type::vector_type;
+
+	static constexpr u64 full_recompute_interval { 64 };
+
+	// Output layer values of net for pixels. A net other than the one of the
+	// last call starts over from scratch. The values stay valid until the next call
+	auto predict(std::shared_ptr<const network_type> net, std::span<const u8> pixels) -> const vector_type&;
+
+	// Calls to predict that updated the kept weighted input rather than recomputing it
+	auto incremental_updates() const -> u64;
+
+private:
+	auto recompute(std::span<const u8> pixels) -> void;
+
+	// Kept so that a new network can't be told apart from it by address alone
+	std::shared_ptr<const network_type> cached_net {};
+
+	std::vector<u8> cached_pixels {};
+	vector_type weighted_input {};
+
+	std::vector<u32> changed_pixels {};
+	u64 updates_since_recompute { 0 };
+	u64 total_updates { 0 };
+
+	typename network_type::prediction_workspace workspace {};
+};
+
+extern template class incremental_prediction<double>;
+extern template class incremental_prediction<float>;
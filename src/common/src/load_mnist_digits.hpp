@@ -6,4 +6,6 @@
 
 #include "digit.hpp"
 
+// Copies every sample into its own digit, prefer mnist_dataset which views
+// the pixels in place
 auto digits_from_path(std::string images_path, std::string labels_path, size_t digit_count = 0) -> std::vector<digit>;
@@ -0,0 +1,102 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <utility>
+
+#include <fcntl.h>
+#include <fmt/format.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "mapped_file.hpp"
+
+mapped_file::mapped_file(const std::string& filepath, map_mode mode) {
+	auto file { try_open(filepath, mode) };
+	if (!file) {
+		std::exit(1);
+	}
+
+	*this = std::move(*file);
+}
+
+auto mapped_file::try_open(const std::string& filepath, map_mode mode) -> std::optional<mapped_file> {
+	int fd { open(filepath.c_str(), O_RDONLY) };
+	if (fd == -1) {
+		fmt::print("Failed to open \"{}\"\n", filepath);
+		return std::nullopt;
+	}
+
+	struct stat file_stat {};
+	if (fstat(fd, &file_stat) == -1) {
+		fmt::print("Failed to stat \"{}\"\n", filepath);
+		close(fd);
+		return std::nullopt;
+	}
+
+	mapped_file file {};
+	file.size = static_cast<std::size_t>(file_stat.st_size);
+
+	// mmap doesn't accept empty mappings, an empty file just has no bytes
+	if (file.size > 0) {
+		int protection { mode == map_mode::copy_on_write ? PROT_READ | PROT_WRITE : PROT_READ };
+
+		void* mapping { mmap(nullptr, file.size, protection, MAP_PRIVATE, fd, 0) };
+		if (mapping == MAP_FAILED) {
+			fmt::print("Failed to map \"{}\" into memory\n", filepath);
+			close(fd);
+			return std::nullopt;
+		}
+
+		file.data = static_cast<u8*>(mapping);
+	}
+
+	close(fd);
+
+	return file;
+}
+
+mapped_file::~mapped_file() {
+	if (data != nullptr) {
+		munmap(data, size);
+	}
+}
+
+mapped_file::mapped_file(mapped_file&& other) noexcept
+    : data { std::exchange(other.data, nullptr) }
+    , size { std::exchange(other.size, 0) } {
+}
+
+auto mapped_file::operator=(mapped_file&& other) noexcept -> mapped_file& {
+	std::swap(data, other.data);
+	std::swap(size, other.size);
+
+	return *this;
+}
+
+auto mapped_file::bytes() const -> std::span<const u8> {
+	return { data, size };
+}
+
+auto mapped_file::writable_bytes() -> std::span<u8> {
+	return { data, size };
+}
+
+auto mapped_file::release_pages(std::span<const u8> range) const -> void {
+	if (data == nullptr) {
+		return;
+	}
+
+	static const auto page_size { static_cast<std::uintptr_t>(sysconf(_SC_PAGESIZE)) };
+
+	auto first { std::max(reinterpret_cast<std::uintptr_t>(range.data()), reinterpret_cast<std::uintptr_t>(data)) };
+	auto last { std::min(reinterpret_cast<std::uintptr_t>(range.data() + range.size()),
+	                     reinterpret_cast<std::uintptr_t>(data + size)) };
+
+	first = (first + page_size - 1) / page_size * page_size;
+	last = last / page_size * page_size;
+
+	if (first < last) {
+		madvise(reinterpret_cast<void*>(first), last - first, MADV_DONTNEED);
+	}
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <span>
+#include <string>
+
+#include "short_types.hpp"
+
+enum class map_mode {
+	read_only,
+	// Writable, writes stay private to the mapping and never reach the file
+	copy_on_write,
+};
+
+// Memory mapping of a whole file, unmapped when destroyed
+class mapped_file {
+public:
+	// Maps nothing, bytes is empty
+	mapped_file() = default;
+	explicit mapped_file(const std::string& filepath, map_mode mode = map_mode::read_only);
+
+	// Prints why the file can't be mapped and returns nullopt, where the constructor exits
+	static auto try_open(const std::string& filepath, map_mode mode = map_mode::read_only)
+	    -> std::optional<mapped_file>;
+	~mapped_file();
+
+	mapped_file(mapped_file&& other) noexcept;
+	auto operator=(mapped_file&& other) noexcept -> mapped_file&;
+
+	mapped_file(const mapped_file&) = delete;
+	auto operator=(const mapped_file&) -> mapped_file& = delete;
+
+	auto bytes() const -> std::span<const u8>;
+
+	// Only writable for map_mode::copy_on_write mappings
+	auto writable_bytes() -> std::span<u8>;
+
+	// Lets the kernel drop the pages that lie wholly inside range from memory,
+	// the rest of the range and anything outside the mapping is left alone.
+	// Dropped pages are read from the file again when touched. Only for
+	// map_mode::read_only mappings, writes to the others would be lost
+	auto release_pages(std::span<const u8> range) const -> void;
+
+private:
+	u8* data { nullptr };
+	std::size_t size { 0 };
+};
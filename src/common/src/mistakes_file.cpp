@@ -0,0 +1,70 @@
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+#include <fmt/format.h>
+
+#include "mistakes_file.hpp"
+
+auto save_mistakes_file(const std::string& filepath, std::span<const std::string_view> split_names,
+                        std::span<const evaluation_report> reports) -> void {
+	std::FILE* file { std::fopen(filepath.c_str(), "w") };
+	if (file == nullptr) {
+		fmt::print("Failed to open mistakes file {}\n", filepath);
+		std::exit(1);
+	}
+
+	fmt::print(file, "{}\n", mistakes_file_magic);
+	for (std::size_t i { 0 }; i < reports.size(); ++i) {
+		for (const auto& digit : reports[i].misclassified) {
+			fmt::print(file, "{} {} {} {}\n", split_names[i], digit.index, digit.label, digit.predicted);
+		}
+	}
+
+	if (std::ferror(file) != 0 || std::fclose(file) != 0) {
+		fmt::print("Failed to write mistakes file {}\n", filepath);
+		std::exit(1);
+	}
+}
+
+auto load_mistakes_file(const std::string& filepath, std::string_view split) -> std::vector<misclassified_digit> {
+	std::ifstream file { filepath };
+	if (!file.is_open()) {
+		fmt::print("Failed to open mistakes file {}\n", filepath);
+		std::exit(1);
+	}
+
+	std::string line {};
+	if (!std::getline(file, line) || line != mistakes_file_magic) {
+		fmt::print("{} isn't a mistakes file\n", filepath);
+		std::exit(1);
+	}
+
+	std::vector<misclassified_digit> mistakes {};
+
+	for (u64 line_number { 2 }; std::getline(file, line); ++line_number) {
+		std::istringstream fields { line };
+
+		std::string line_split {};
+		u64 index { 0 };
+		u64 label { 0 };
+		u64 predicted { 0 };
+
+		if (!(fields >> line_split >> index >> label >> predicted) || label >= evaluated_digit_count
+		    || predicted >= evaluated_digit_count) {
+			fmt::print("Corrupt line {} in mistakes file {}\n", line_number, filepath);
+			std::exit(1);
+		}
+
+		if (line_split == split) {
+			mistakes.push_back({
+			    .index = static_cast<u32>(index),
+			    .label = static_cast<u8>(label),
+			    .predicted = static_cast<u8>(predicted),
+			});
+		}
+	}
+
+	return mistakes;
+}
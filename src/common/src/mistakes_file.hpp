@@ -0,0 +1,20 @@
+#pragma once
+
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "evaluation_report.hpp"
+
+// Text file of the digits a network misclassified, written by test_nn for
+// check_nn to step through. After a magic line every line is one digit:
+// <split> <index> <label> <predicted>, split naming the dataset it's in
+inline constexpr std::string_view mistakes_file_magic { "nn_mistakes 1" };
+
+// Writes the misclassified digits of every report under the split name of the same position
+auto save_mistakes_file(const std::string& filepath, std::span<const std::string_view> split_names,
+                        std::span<const evaluation_report> reports) -> void;
+
+// The misclassified digits of split in the file, in the order they're listed
+auto load_mistakes_file(const std::string& filepath, std::string_view split) -> std::vector<misclassified_digit>;
@@ -0,0 +1,191 @@
+#include <cstdlib>
+
+#include <fmt/format.h>
+
+#include "mnist_dataset.hpp"
+
+// IDX headers are made of big endian 32 bit integers
+static auto read_be_i32(std::span<const u8> bytes, std::size_t offset) -> i32 {
+	if (offset + 4 > bytes.size()) {
+		fmt::print("IDX file is too small to contain a header\n");
+		std::exit(1);
+	}
+
+	return static_cast<i32>((u32 { bytes[offset] } << 24) | (u32 { bytes[offset + 1] } << 16)
+	                        | (u32 { bytes[offset + 2] } << 8) | u32 { bytes[offset + 3] });
+}
+
+auto read_idx_layout(std::span<const u8> images, std::span<const u8> labels, std::size_t digit_count)
+    -> idx_layout {
+	{
+		auto magic_number = read_be_i32(images, 0);
+		auto image_magic_number = 0x803;
+
+		if (magic_number != image_magic_number) {
+			fmt::print(
+			    "Incorrect magic number from images file\n"
+			    "Expected {} got {}\n",
+			    image_magic_number, magic_number);
+
+			std::exit(1);
+		}
+	}
+
+	{
+		auto magic_number = read_be_i32(labels, 0);
+		auto label_magic_number = 0x801;
+
+		if (magic_number != label_magic_number) {
+			fmt::print(
+			    "Incorrect magic number from labels file\n"
+			    "Expected {} got {}\n",
+			    label_magic_number, magic_number);
+
+			std::exit(1);
+		}
+	}
+
+	auto image_count = read_be_i32(images, 4);
+	auto label_count = read_be_i32(labels, 4);
+
+	if (image_count != label_count) {
+		fmt::print(
+		    "image and label set do not match each other\n"
+		    "{} images != {} labels\n",
+		    image_count, label_count);
+
+		std::exit(1);
+	}
+
+	if (digit_count == 0) {
+		digit_count = static_cast<std::size_t>(image_count);
+	} else if (digit_count > static_cast<std::size_t>(image_count)) {
+		fmt::print("Not enough images ({}) in data for {} digit(s)\n", image_count, digit_count);
+		std::exit(1);
+	}
+
+	return {
+		.count = digit_count,
+		.rows = static_cast<std::size_t>(read_be_i32(images, 8)),
+		.columns = static_cast<std::size_t>(read_be_i32(images, 12)),
+	};
+}
+
+mnist_dataset::mnist_dataset(const std::string& images_path, const std::string& labels_path, std::size_t digit_count)
+    : pack { load_dataset_pack(images_path, labels_path) } {
+	if (pack) {
+		auto pack_count { pack->labels.size() };
+		if (digit_count > pack_count) {
+			fmt::print("Not enough images ({}) in data for {} digit(s)\n", pack_count, digit_count);
+			std::exit(1);
+		}
+
+		digit_count = digit_count == 0 ? pack_count : digit_count;
+		rows = pack->rows;
+		columns = pack->columns;
+
+		image_data = pack->pixels.first(digit_count * rows * columns);
+		label_data = pack->labels.first(digit_count);
+
+		return;
+	}
+
+	images_file = mapped_file { images_path };
+	labels_file = mapped_file { labels_path };
+
+	auto images { images_file.bytes() };
+	auto labels { labels_file.bytes() };
+
+	auto layout { read_idx_layout(images, labels, digit_count) };
+	rows = layout.rows;
+	columns = layout.columns;
+
+	if (images.size() < idx_image_header_size + layout.count * rows * columns
+	    || labels.size() < idx_label_header_size + layout.count) {
+		fmt::print("IDX files are smaller than the {} digit(s) their headers describe\n", layout.count);
+		std::exit(1);
+	}
+
+	image_data = images.subspan(idx_image_header_size, layout.count * rows * columns);
+	label_data = labels.subspan(idx_label_header_size, layout.count);
+}
+
+auto mnist_dataset::size() const -> std::size_t {
+	return label_data.size();
+}
+
+auto mnist_dataset::image_rows() const -> std::size_t {
+	return rows;
+}
+
+auto mnist_dataset::image_columns() const -> std::size_t {
+	return columns;
+}
+
+auto mnist_dataset::pixels_per_image() const -> std::size_t {
+	return rows * columns;
+}
+
+auto mnist_dataset::operator[](std::size_t index) const -> digit_view {
+	return { sample(index), label(index) };
+}
+
+auto mnist_dataset::sample(std::size_t index) const -> std::span<const u8> {
+	return image_data.subspan(index * pixels_per_image(), pixels_per_image());
+}
+
+auto mnist_dataset::label(std::size_t index) const -> u8 {
+	return label_data[index];
+}
+
+auto mnist_dataset::labels() const -> std::span<const u8> {
+	return label_data;
+}
+
+auto mnist_dataset::pixels(std::size_t first, std::size_t count) const -> Eigen::Map<const pixel_matrix> {
+	return { image_data.data() + first * pixels_per_image(), static_cast<Eigen::Index>(count),
+		     static_cast<Eigen::Index>(pixels_per_image()) };
+}
+
+auto mnist_dataset::pixels() const -> Eigen::Map<const pixel_matrix> {
+	return pixels(0, size());
+}
+
+auto mnist_dataset::release_pixels(std::size_t first, std::size_t count) const -> void {
+	auto rows_bytes { image_data.subspan(first * pixels_per_image(), count * pixels_per_image()) };
+
+	images_file.release_pages(rows_bytes);
+	if (pack) {
+		pack->file.release_pages(rows_bytes);
+	}
+}
+
+auto mnist_dataset::begin() const -> const_iterator {
+	return { this, 0 };
+}
+
+auto mnist_dataset::end() const -> const_iterator {
+	return { this, size() };
+}
+
+mnist_dataset::const_iterator::const_iterator(const mnist_dataset* in_dataset, std::size_t in_index)
+    : dataset { in_dataset }
+    , index { in_index } {
+}
+
+auto mnist_dataset::const_iterator::operator*() const -> digit_view {
+	return (*dataset)[index];
+}
+
+auto mnist_dataset::const_iterator::operator++() -> const_iterator& {
+	++index;
+
+	return *this;
+}
+
+auto mnist_dataset::const_iterator::operator++(int) -> const_iterator {
+	auto previous { *this };
+	++index;
+
+	return previous;
+}
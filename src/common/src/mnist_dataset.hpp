@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+#include <optional>
+#include <span>
+#include <string>
+
+#include <Eigen/Eigen>
+
+#include "dataset_pack.hpp"
+#include "mapped_file.hpp"
+#include "network.hpp"
+#include "short_types.hpp"
+
+inline constexpr std::size_t idx_image_header_size { 16 };
+inline constexpr std::size_t idx_label_header_size { 8 };
+
+// What the headers of an IDX image file and its label file describe
+struct idx_layout {
+	std::size_t count;
+	std::size_t rows;
+	std::size_t columns;
+};
+
+// Checks the headers against each other and exits if they don't describe the
+// same samples. digit_count limits the samples used, 0 uses all of them
+auto read_idx_layout(std::span<const u8> image_header, std::span<const u8> label_header, std::size_t digit_count)
+    -> idx_layout;
+
+// Non owning view of a single sample in a mnist_dataset
+struct digit_view {
+	std::span<const u8> pixels;
+	u8 label;
+};
+
+// Memory maps an IDX image file and its label file, the pixels of every
+// sample are exposed in place as one row major matrix with a row per sample.
+// A fresh dataset pack of the files is loaded in their place
+class mnist_dataset {
+public:
+	class const_iterator {
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = digit_view;
+		using difference_type = std::ptrdiff_t;
+
+		const_iterator() = default;
+		const_iterator(const mnist_dataset* in_dataset, std::size_t in_index);
+
+		auto operator*() const -> digit_view;
+		auto operator++() -> const_iterator&;
+		auto operator++(int) -> const_iterator;
+
+		auto operator==(const const_iterator& other) const -> bool = default;
+
+	private:
+		const mnist_dataset* dataset { nullptr };
+		std::size_t index { 0 };
+	};
+
+	mnist_dataset(const std::string& images_path, const std::string& labels_path, std::size_t digit_count = 0);
+
+	auto size() const -> std::size_t;
+	auto image_rows() const -> std::size_t;
+	auto image_columns() const -> std::size_t;
+	auto pixels_per_image() const -> std::size_t;
+
+	auto operator[](std::size_t index) const -> digit_view;
+	auto sample(std::size_t index) const -> std::span<const u8>;
+	auto label(std::size_t index) const -> u8;
+
+	auto labels() const -> std::span<const u8>;
+
+	// Rows [first, first + count) of the pixel matrix, ready for network::predict_batch
+	auto pixels(std::size_t first, std::size_t count) const -> Eigen::Map<const pixel_matrix>;
+	auto pixels() const -> Eigen::Map<const pixel_matrix>;
+
+	// Lets the kernel drop the mapped pixels of rows [first, first + count)
+	// from memory, for a single pass over the dataset. They're read from the
+	// file again if used later. Unpacked pixels of a sparse pack stay
+	auto release_pixels(std::size_t first, std::size_t count) const -> void;
+
+	auto begin() const -> const_iterator;
+	auto end() const -> const_iterator;
+
+private:
+	std::optional<dataset_pack> pack {};
+	mapped_file images_file {};
+	mapped_file labels_file {};
+
+	std::span<const u8> image_data {};
+	std::span<const u8> label_data {};
+
+	std::size_t rows { 0 };
+	std::size_t columns { 0 };
+};
@@ -0,0 +1,175 @@
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <utility>
+
+#include <fmt/format.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include "model_handle.hpp"
+#include "network_from_file.hpp"
+#include "trace.hpp"
+
+// How often the watcher checks whether callers let go of replaced networks
+constexpr int retired_poll_milliseconds { 100 };
+
+template<typename Scalar>
+basic_model_handle<Scalar>::basic_model_handle(std::string in_filepath) : filepath { std::move(in_filepath) } {
+	auto net { std::make_shared<network_type>() };
+	load_network_from_file(*net, filepath);
+
+	input_size = net->topology.front();
+	output_size = net->topology.back();
+
+	current = std::move(net);
+	loaded_versions = 1;
+
+	// Savers write a temporary file and rename it over the network, so the
+	// directory is watched for the rename rather than the file, whose inode
+	// the rename replaces. Files written in place aren't picked up, a closed
+	// write may be an unfinished one and a mapped network would see the
+	// writes that follow
+	std::filesystem::path directory { std::filesystem::path { filepath }.parent_path() };
+	if (directory.empty()) {
+		directory = ".";
+	}
+
+	inotify_fd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+	stop_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+
+	if (inotify_fd == -1 || stop_fd == -1
+	    || inotify_add_watch(inotify_fd, directory.c_str(), IN_MOVED_TO) == -1) {
+		fmt::print("Failed to watch \"{}\" for new versions: {}, keeping the one loaded\n", filepath,
+		           std::strerror(errno));
+		return;
+	}
+
+	// The watcher inherits a mask blocking every signal, so they go to the
+	// tool's own threads. A signalfd only works if no thread takes its signals
+	sigset_t all_signals {};
+	sigset_t previous_signals {};
+	sigfillset(&all_signals);
+	pthread_sigmask(SIG_SETMASK, &all_signals, &previous_signals);
+
+	watcher = std::thread { &basic_model_handle::watch, this };
+
+	pthread_sigmask(SIG_SETMASK, &previous_signals, nullptr);
+}
+
+template<typename Scalar>
+basic_model_handle<Scalar>::~basic_model_handle() {
+	if (watcher.joinable()) {
+		u64 stop { 1 };
+		[[maybe_unused]] auto written { write(stop_fd, &stop, sizeof stop) };
+
+		watcher.join();
+	}
+
+	for (int fd : { inotify_fd, stop_fd }) {
+		if (fd != -1) {
+			close(fd);
+		}
+	}
+}
+
+template<typename Scalar>
+auto basic_model_handle<Scalar>::get() const -> std::shared_ptr<const network_type> {
+	std::lock_guard lock { current_mutex };
+	return current;
+}
+
+template<typename Scalar>
+auto basic_model_handle<Scalar>::version() const -> u64 {
+	return loaded_versions;
+}
+
+template<typename Scalar>
+auto basic_model_handle<Scalar>::watch() -> void {
+	auto filename { std::filesystem::path { filepath }.filename() };
+
+	// Big enough for a few events with the longest names
+	alignas(inotify_event) std::array<char, 4096> buffer;
+
+	std::array<pollfd, 2> watched { {
+		{ .fd = inotify_fd, .events = POLLIN, .revents = 0 },
+		{ .fd = stop_fd, .events = POLLIN, .revents = 0 },
+	} };
+
+	while (true) {
+		poll(watched.data(), watched.size(), retired.empty() ? -1 : retired_poll_milliseconds);
+		free_retired();
+
+		if (watched[1].revents != 0) {
+			return;
+		}
+
+		// A burst of events, like several saves in a row, makes one reload
+		bool changed { false };
+		for (ssize_t read_size; (read_size = read(inotify_fd, buffer.data(), buffer.size())) > 0;) {
+			for (ssize_t offset { 0 }; offset < read_size;) {
+				const auto* event { reinterpret_cast<const inotify_event*>(buffer.data() + offset) };
+				offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+
+				if (event->len != 0 && filename == event->name) {
+					changed = true;
+				}
+			}
+		}
+
+		if (changed) {
+			reload();
+		}
+	}
+}
+
+template<typename Scalar>
+auto basic_model_handle<Scalar>::reload() -> void {
+	TRACE_ZONE("reload_network");
+
+	auto start_time { std::chrono::steady_clock::now() };
+
+	if (!std::filesystem::exists(filepath)) {
+		return;
+	}
+
+	// A version that can't be loaded leaves the loaded one in place, the next save may well be fine
+	auto net { std::make_shared<network_type>() };
+	if (!try_load_verified_network_from_file(*net, filepath)) {
+		fmt::print("New version of \"{}\" can't be loaded, keeping the loaded one\n", filepath);
+		return;
+	}
+
+	if (net->topology.front() != input_size || net->topology.back() != output_size) {
+		fmt::print("New version of \"{}\" has topology {}, it needs {} inputs and {} outputs like the loaded one\n",
+		           filepath, fmt::join(net->topology, ","), input_size, output_size);
+		return;
+	}
+
+	{
+		std::lock_guard lock { current_mutex };
+		std::swap(current, retired.emplace_back(std::move(net)));
+	}
+	loaded_versions += 1;
+
+	std::chrono::duration<double, std::milli> elapsed { std::chrono::steady_clock::now() - start_time };
+	fmt::print("Loaded version {} of \"{}\" in {:.2f}ms\n", loaded_versions.load(), filepath, elapsed.count());
+
+	free_retired();
+}
+
+template<typename Scalar>
+auto basic_model_handle<Scalar>::free_retired() -> void {
+	// Nothing can take a new reference to a retired network, only the
+	// watcher holds one once its count drops to 1
+	std::erase_if(retired, [](const auto& net) { return net.use_count() == 1; });
+}
+
+template class basic_model_handle<double>;
+template class basic_model_handle<float>;
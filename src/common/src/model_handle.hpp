@@ -0,0 +1,69 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "network.hpp"
+#include "short_types.hpp"
+
+// The latest version of a network file, for tools that keep running while
+// train_nn saves over it. A background thread watches with inotify for new
+// versions renamed over the file, the way save_network_to_file saves, and
+// loads them. A version that can't be loaded is reported and skipped. Callers
+// take the current one with get() and predict with it for as long as they
+// hold on to it.
+//
+// Loading never holds up get(), the new network is swapped in whole once it's
+// loaded. A replaced network stays as it was until the last caller holding it
+// lets go, and is freed by the watcher rather than by that caller
+template<typename Scalar>
+class basic_model_handle {
+public:
+	using network_type = basic_network<Scalar>;
+
+	// Loads the network like load_network_from_file does and starts watching
+	// the file. Later versions have to keep its input and output layer sizes
+	explicit basic_model_handle(std::string in_filepath);
+	~basic_model_handle();
+
+	basic_model_handle(const basic_model_handle&) = delete;
+	auto operator=(const basic_model_handle&) -> basic_model_handle& = delete;
+
+	auto get() const -> std::shared_ptr<const network_type>;
+
+	// Versions loaded so far, 1 right after construction
+	auto version() const -> u64;
+
+private:
+	auto watch() -> void;
+	auto reload() -> void;
+
+	// Frees the replaced networks no caller holds anymore
+	auto free_retired() -> void;
+
+	std::string filepath;
+
+	// Held only to copy or swap the pointer, never while loading
+	mutable std::mutex current_mutex {};
+	std::shared_ptr<const network_type> current {};
+	std::atomic<u64> loaded_versions { 0 };
+
+	// Only the watcher touches these
+	std::vector<std::shared_ptr<const network_type>> retired {};
+	u64 input_size { 0 };
+	u64 output_size { 0 };
+
+	int inotify_fd { -1 };
+	int stop_fd { -1 };
+	std::thread watcher {};
+};
+
+using model_handle = basic_model_handle<double>;
+using model_handle_f32 = basic_model_handle<float>;
+
+extern template class basic_model_handle<double>;
+extern template class basic_model_handle<float>;
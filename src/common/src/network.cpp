@@ -1,56 +1,366 @@
-#include <cmath>
+#include <algorithm>
+#include <charconv>
+#include <cstdlib>
 #include <cstdint>
+#include <optional>
 #include <span>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
 
+#include <fmt/format.h>
+
+#include "activation.hpp"
 #include "network.hpp"
 #include "short_types.hpp"
+#include "trace.hpp"
 
 using std::size_t;
 
-network::network() : network::network { 28 * 28, 16, 16, 10 } {
+template<typename Scalar>
+basic_network<Scalar>::basic_network() : basic_network { 28 * 28, 16, 16, 10 } {
 }
 
-network::network(std::initializer_list<u64> in_topology)
-    : topology { in_topology } {
-	layer_bias.reserve(topology.size() - 1);
+template<typename Scalar>
+basic_network<Scalar>::basic_network(std::initializer_list<u64> in_topology)
+    : basic_network(std::vector<u64>(in_topology)) {
+}
+
+// Number of Scalars in a parameter block of count values, padding included
+template<typename Scalar>
+auto padded_block_size(size_t count) -> size_t {
+	constexpr size_t block_alignment { basic_network<Scalar>::parameter_alignment / sizeof(Scalar) };
+
+	return (count + block_alignment - 1) / block_alignment * block_alignment;
+}
+
+template<typename Scalar>
+auto basic_network<Scalar>::parameter_count(const std::vector<u64>& topology) -> size_t {
+	size_t count { 0 };
 
 	for (size_t i { 1 }; i < topology.size(); ++i) {
-		layer_bias.emplace_back(topology[i]);
+		count += padded_block_size<Scalar>(topology[i]);
+		count += padded_block_size<Scalar>(topology[i] * topology[i - 1]);
+	}
+
+	return count;
+}
+
+template<typename Scalar>
+basic_network<Scalar>::basic_network(std::vector<u64> in_topology)
+    : topology { std::move(in_topology) }
+    , layer_activations(topology.size() - 1, activation_function::sigmoid)
+    , parameter_storage(parameter_count(topology)) {
+	parameter_block = parameter_storage;
+	map_layers();
+}
+
+template<typename Scalar>
+basic_network<Scalar>::basic_network(std::vector<u64> in_topology, mapped_file file, size_t parameter_offset)
+    : topology { std::move(in_topology) }
+    , layer_activations(topology.size() - 1, activation_function::sigmoid)
+    , parameter_file { std::move(file) } {
+	auto bytes { parameter_file->writable_bytes().subspan(parameter_offset, parameter_count(topology) * sizeof(Scalar)) };
+
+	parameter_block = { reinterpret_cast<Scalar*>(bytes.data()), bytes.size() / sizeof(Scalar) };
+	map_layers();
+}
+
+template<typename Scalar>
+basic_network<Scalar>::basic_network(const basic_network& other)
+    : topology { other.topology }
+    , layer_activations { other.layer_activations }
+    , parameter_storage(other.parameter_block.begin(), other.parameter_block.end()) {
+	parameter_block = parameter_storage;
+	map_layers();
+}
+
+template<typename Scalar>
+auto basic_network<Scalar>::operator=(const basic_network& other) -> basic_network& {
+	if (this == &other) {
+		return *this;
+	}
+
+	// Same shape networks get copied into often while training, reuse the block
+	if (!parameter_file && topology == other.topology) {
+		std::copy(other.parameter_block.begin(), other.parameter_block.end(), parameter_block.begin());
+		layer_activations = other.layer_activations;
+
+		return *this;
 	}
 
+	return *this = basic_network { other };
+}
+
+template<typename Scalar>
+auto basic_network<Scalar>::parameters() -> std::span<Scalar> {
+	return parameter_block;
+}
+
+template<typename Scalar>
+auto basic_network<Scalar>::parameters() const -> std::span<const Scalar> {
+	return parameter_block;
+}
+
+template<typename Scalar>
+auto basic_network<Scalar>::map_layers() -> void {
+	layer_weights.clear();
+	layer_bias.clear();
+
 	layer_weights.reserve(topology.size() - 1);
+	layer_bias.reserve(topology.size() - 1);
 
+	Scalar* block { parameter_block.data() };
 	for (size_t i { 1 }; i < topology.size(); ++i) {
-		layer_weights.emplace_back(topology[i], topology[i - 1]);
+		auto rows { static_cast<Eigen::Index>(topology[i]) };
+		auto cols { static_cast<Eigen::Index>(topology[i - 1]) };
+
+		layer_bias.emplace_back(block, rows);
+		block += padded_block_size<Scalar>(topology[i]);
+
+		layer_weights.emplace_back(block, rows, cols);
+		block += padded_block_size<Scalar>(topology[i] * topology[i - 1]);
+	}
+}
+
+static auto nonzero_pixel_count(std::span<const u8> pixels) -> size_t {
+	size_t nonzero_count { 0 };
+	for (const auto pixel : pixels) {
+		nonzero_count += pixel != 0 ? 1 : 0;
+	}
+
+	return nonzero_count;
+}
+
+static auto sparse_input(size_t nonzero_count, size_t pixel_count) -> bool {
+	return static_cast<double>(nonzero_count) < sparse_input_density * static_cast<double>(pixel_count);
+}
+
+// output = weights * pixels / 256, adding up only the weight columns of the
+// nonzero pixels. The weights are column major so every column is contiguous
+template<typename Scalar>
+static auto sparse_first_layer(const Eigen::Map<Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic>>& weights,
+                               const u8* pixels, Scalar* output, std::vector<u32>& nonzero_pixels) -> void {
+	const auto pixel_count { static_cast<u32>(weights.cols()) };
+
+	// Branchless, which pixels are zero is too irregular to predict
+	nonzero_pixels.resize(pixel_count + 1);
+	size_t nonzero_count { 0 };
+	for (u32 i { 0 }; i < pixel_count; ++i) {
+		nonzero_pixels[nonzero_count] = i;
+		nonzero_count += pixels[i] != 0 ? 1 : 0;
+	}
+
+	// Eigen's own vector code, -O2 doesn't vectorize a plain loop of this
+	Eigen::Map<Eigen::Matrix<Scalar, Eigen::Dynamic, 1>> sum { output, weights.rows() };
+	sum.setZero();
+
+	for (size_t n { 0 }; n < nonzero_count; ++n) {
+		const auto pixel { nonzero_pixels[n] };
+		sum.noalias() += (static_cast<Scalar>(pixels[pixel]) / Scalar { 256 }) * weights.col(pixel);
+	}
+}
+
+template<typename Scalar>
+auto basic_network<Scalar>::get_prediction(std::span<const u8> pixels) const -> vector_type {
+	prediction_workspace workspace {};
+
+	return std::move(get_prediction(pixels, workspace));
+}
+
+// The input layer is sized from the topology, more or fewer pixels than it
+// takes would be read or written past its end
+static auto check_input_size(size_t pixel_count, u64 input_size) -> void {
+	if (pixel_count != input_size) {
+		fmt::print("Network takes {} pixels per sample, got {}\n", input_size, pixel_count);
+		std::exit(1);
+	}
+}
+
+template<typename Scalar>
+auto basic_network<Scalar>::get_prediction(std::span<const u8> pixels, prediction_workspace& workspace) const
+    -> vector_type& {
+	TRACE_ZONE("get_prediction");
+
+	check_input_size(pixels.size(), topology.front());
+
+	auto& layers { resize_prediction_layers(workspace) };
+
+	if (sparse_input(nonzero_pixel_count(pixels), pixels.size())) {
+		TRACE_ZONE("sparse_gemm", "layer", i64 { 0 });
+		sparse_first_layer(layer_weights[0], pixels.data(), layers[1].data(), workspace.nonzero_pixels);
+	} else {
+		for (size_t i { 0 }; i < pixels.size(); ++i) {
+			layers[0][i] = static_cast<Scalar>(pixels[i]) / Scalar { 256 };
+		}
+
+		TRACE_ZONE("gemm", "layer", i64 { 0 });
+		layers[1].noalias() = layer_weights[0] * layers[0];
+	}
+
+	return finish_prediction(workspace);
+}
+
+template<typename Scalar>
+auto basic_network<Scalar>::predict_from_weighted_input(const vector_type& first_weighted_input,
+                                                        prediction_workspace& workspace) const -> vector_type& {
+	TRACE_ZONE("predict_from_weighted_input");
+
+	auto& layers { resize_prediction_layers(workspace) };
+	layers[1] = first_weighted_input;
+
+	return finish_prediction(workspace);
+}
+
+template<typename Scalar>
+auto basic_network<Scalar>::resize_prediction_layers(prediction_workspace& workspace) const
+    -> std::vector<vector_type>& {
+	auto& layers { workspace.layers };
+	layers.resize(topology.size());
+
+	// Resizing to the size a buffer already has doesn't reallocate
+	for (size_t i { 0 }; i < topology.size(); ++i) {
+		layers[i].resize(static_cast<Eigen::Index>(topology[i]));
 	}
+
+	return layers;
 }
 
-auto sigmoid(Eigen::VectorXd&& values) -> Eigen::VectorXd {
-	for (auto& value : std::span(values.data(), values.size())) {
-		value = 1.0 / (1.0 + std::exp(-value));
-		/* value = 0.5 * (1.0 + value / (1.0 + std::abs(value))); */
+template<typename Scalar>
+auto basic_network<Scalar>::finish_prediction(prediction_workspace& workspace) const -> vector_type& {
+	auto& layers { workspace.layers };
+
+	for (size_t i { 0 }; i < topology.size() - 1; ++i) {
+		if (i != 0) {
+			TRACE_ZONE("gemm", "layer", static_cast<i64>(i));
+			layers[i + 1].noalias() = layer_weights[i] * layers[i];
+		}
+
+		TRACE_ZONE("activation", "layer", static_cast<i64>(i));
+		apply_activation<Scalar>(
+		    { layers[i + 1].data(), static_cast<size_t>(layers[i + 1].size()) },
+		    { layer_bias[i].data(), static_cast<size_t>(layer_bias[i].size()) },
+		    layer_activations[i]);
 	}
 
-	return values;
+	return layers.back();
 }
 
-auto network::get_prediction(std::vector<u8> pixels) const -> Eigen::VectorXd {
-	Eigen::VectorXd input_layer { topology[0] };
+template<typename Scalar>
+auto basic_network<Scalar>::predict_batch(const Eigen::Ref<const pixel_matrix>& pixels) const -> prediction_matrix {
+	prediction_workspace workspace {};
+
+	return predict_batch(pixels, workspace);
+}
+
+template<typename Scalar>
+auto basic_network<Scalar>::predict_batch(const Eigen::Ref<const pixel_matrix>& pixels,
+                                          prediction_workspace& workspace) const -> Eigen::Ref<prediction_matrix> {
+	TRACE_ZONE("predict_batch");
+
+	check_input_size(static_cast<size_t>(pixels.cols()), topology.front());
+
+	auto& layers { workspace.batch_layers };
+	layers.resize(topology.size());
+
+	// Buffers only ever grow, a short last batch of a dataset uses their top rows
+	// rather than reallocating them twice
+	auto rows { pixels.rows() };
+	for (size_t i { 0 }; i < topology.size(); ++i) {
+		auto cols { static_cast<Eigen::Index>(topology[i]) };
+
+		if (layers[i].rows() < rows || layers[i].cols() != cols) {
+			layers[i].resize(std::max(rows, layers[i].rows()), cols);
+		}
+	}
+
+	// The whole batch goes one way, so the product of dense inputs stays one matrix-matrix product
+	size_t nonzero_count { 0 };
+	for (Eigen::Index row { 0 }; row < rows; ++row) {
+		nonzero_count += nonzero_pixel_count({ pixels.row(row).data(), static_cast<size_t>(pixels.cols()) });
+	}
+
+	const bool sparse { sparse_input(nonzero_count, static_cast<size_t>(pixels.size())) };
 
-	for (size_t i { 0 }; i < pixels.size(); ++i) {
-		input_layer[i] = static_cast<double>(pixels[i]) / 256.0;
+	if (!sparse) {
+		layers[0].topRows(rows).noalias() = pixels.cast<Scalar>() / Scalar { 256 };
 	}
 
-	auto output_layer = input_layer;
 	for (size_t i { 0 }; i < topology.size() - 1; ++i) {
-		output_layer = sigmoid(layer_weights[i] * output_layer + layer_bias[i]);
+		auto weighted_input { layers[i + 1].topRows(rows) };
+
+		if (i == 0 && sparse) {
+			TRACE_ZONE("sparse_gemm", "layer", static_cast<i64>(i));
+			for (Eigen::Index row { 0 }; row < rows; ++row) {
+				sparse_first_layer(layer_weights[0], pixels.row(row).data(), weighted_input.row(row).data(),
+				                   workspace.nonzero_pixels);
+			}
+		} else {
+			TRACE_ZONE("gemm", "layer", static_cast<i64>(i));
+			weighted_input.noalias() = layers[i].topRows(rows) * layer_weights[i].transpose();
+		}
+
+		TRACE_ZONE("activation", "layer", static_cast<i64>(i));
+
+		// Rows are samples, so the bias and activation go one contiguous row at a time
+		const std::span<const Scalar> bias { layer_bias[i].data(), static_cast<size_t>(layer_bias[i].size()) };
+		for (Eigen::Index row { 0 }; row < rows; ++row) {
+			apply_activation<Scalar>({ weighted_input.row(row).data(), bias.size() }, bias, layer_activations[i]);
+		}
+	}
+
+	return layers.back().topRows(rows);
+}
+
+auto valid_network_topology(const std::vector<u64>& topology) -> bool {
+	if (topology.size() < 2) {
+		return false;
+	}
+
+	for (const auto layer_size : topology) {
+		if (layer_size == 0) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+auto parse_network_topology(std::string_view text) -> std::optional<std::vector<u64>> {
+	std::vector<u64> topology {};
+
+	if (text.empty() || text.back() == ',') {
+		return std::nullopt;
+	}
+
+	while (!text.empty()) {
+		auto layer_end { std::min(text.find(','), text.size()) };
+		auto layer { text.substr(0, layer_end) };
+
+		u64 layer_size {};
+		auto [end, error] { std::from_chars(layer.data(), layer.data() + layer.size(), layer_size) };
+		if (error != std::errc {} || end != layer.data() + layer.size()) {
+			return std::nullopt;
+		}
+
+		topology.push_back(layer_size);
+		text.remove_prefix(std::min(layer_end + 1, text.size()));
+	}
+
+	if (!valid_network_topology(topology)) {
+		return std::nullopt;
 	}
 
-	return output_layer;
+	return topology;
 }
 
-auto nudge_neural_network_values(network& neural_net, std::mt19937& rand_gen) -> void {
-	std::uniform_real_distribution rand_multiplier { 0.9, 1.1 };
+template class basic_network<double>;
+template class basic_network<float>;
+
+template<typename Scalar>
+auto nudge_neural_network_values(basic_network<Scalar>& neural_net, std::mt19937& rand_gen) -> void {
+	std::uniform_real_distribution<Scalar> rand_multiplier { 0.9, 1.1 };
 	std::bernoulli_distribution rand_bool {};
 
 	auto span = [](auto& matrix) {
@@ -74,12 +384,13 @@ auto nudge_neural_network_values(network& neural_net, std::mt19937& rand_gen) ->
 	}
 }
 
-auto randomize_neural_network_value(network& neural_net, std::mt19937& rand_gen) -> void {
+template<typename Scalar>
+auto randomize_neural_network_value(basic_network<Scalar>& neural_net, std::mt19937& rand_gen) -> void {
 	auto span = [](auto& matrix) {
 		return std::span(matrix.data(), matrix.size());
 	};
 
-	std::uniform_real_distribution rand_normal { -1.0, 1.0 };
+	std::uniform_real_distribution<Scalar> rand_normal { -1.0, 1.0 };
 
 	for (auto& weights : neural_net.layer_weights) {
 		for (auto& w : span(weights)) {
@@ -93,3 +404,9 @@ auto randomize_neural_network_value(network& neural_net, std::mt19937& rand_gen)
 		}
 	}
 }
+
+template auto nudge_neural_network_values(network& neural_net, std::mt19937& rand_gen) -> void;
+template auto nudge_neural_network_values(network_f32& neural_net, std::mt19937& rand_gen) -> void;
+
+template auto randomize_neural_network_value(network& neural_net, std::mt19937& rand_gen) -> void;
+template auto randomize_neural_network_value(network_f32& neural_net, std::mt19937& rand_gen) -> void;
@@ -1,24 +1,145 @@
 #pragma once
 
+#include <cstddef>
 #include <initializer_list>
+#include <optional>
 #include <random>
+#include <span>
+#include <string_view>
 #include <vector>
 
 #include <Eigen/Eigen>
 
+#include "activation.hpp"
+#include "mapped_file.hpp"
 #include "short_types.hpp"
 
-class network {
+// One sample per row, so a batch of digits is a single contiguous block
+using pixel_matrix = Eigen::Matrix<u8, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+
+// Number of samples callers group together for predict_batch
+inline constexpr std::size_t prediction_batch_size { 64 };
+
+// Inputs with fewer nonzero pixels than this fraction only add up the first
+// layer weights of their nonzero pixels instead of multiplying every one.
+// Handwritten digits are about 15% ink, both ways break even around 30%
+inline constexpr double sparse_input_density { 0.25 };
+
+template<typename Scalar>
+class basic_network {
 public:
+	using scalar_type = Scalar;
+	using matrix_type = Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic>;
+	using vector_type = Eigen::Matrix<Scalar, Eigen::Dynamic, 1>;
+	using prediction_matrix = Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+
+	// Every layer is a view into the network's parameter block, see parameters()
+	using weights_type = Eigen::Map<matrix_type>;
+	using bias_type = Eigen::Map<vector_type>;
+
+	// Layer buffers predictions reuse, once they've grown to fit a network
+	// predicting doesn't allocate. Each thread needs a workspace of its own
+	struct prediction_workspace {
+		std::vector<vector_type> layers;
+		std::vector<prediction_matrix> batch_layers;
+		std::vector<u32> nonzero_pixels;
+	};
+
+	// Blocks in the parameter block start on multiples of this many bytes
+	static constexpr std::size_t parameter_alignment { 64 };
+
 	std::vector<u64> topology;
-	std::vector<Eigen::MatrixXd> layer_weights;
-	std::vector<Eigen::VectorXd> layer_bias;
+	std::vector<weights_type> layer_weights;
+	std::vector<bias_type> layer_bias;
+
+	// One per non-input layer, sigmoid unless chosen otherwise
+	std::vector<activation_function> layer_activations;
+
+	basic_network();
+	basic_network(std::initializer_list<u64> in_topology);
+
+	// Layer sizes from the input layer to the output layer, there have to be
+	// at least two layers and none of them may be empty
+	explicit basic_network(std::vector<u64> in_topology);
+
+	// Views the parameter block starting parameter_offset bytes into a mapped
+	// network file instead of copying it, the mapping has to be at least
+	// parameter_offset + parameter_count(in_topology) * sizeof(Scalar) bytes
+	basic_network(std::vector<u64> in_topology, mapped_file file, std::size_t parameter_offset);
+
+	// Copies always own their parameters, even when other views a mapped file
+	basic_network(const basic_network& other);
+	auto operator=(const basic_network& other) -> basic_network&;
+
+	basic_network(basic_network&& other) noexcept = default;
+	auto operator=(basic_network&& other) noexcept -> basic_network& = default;
+
+	// Converts a network of another precision, e.g. double to float
+	template<typename OtherScalar>
+	explicit basic_network(const basic_network<OtherScalar>& other) : basic_network(other.topology) {
+		layer_activations = other.layer_activations;
+
+		for (std::size_t i { 0 }; i < layer_weights.size(); ++i) {
+			layer_weights[i] = other.layer_weights[i].template cast<Scalar>();
+			layer_bias[i] = other.layer_bias[i].template cast<Scalar>();
+		}
+	}
 
-	network();
-	network(std::initializer_list<u64> in_topology);
+	// Bias then weights of every layer, each block padded to parameter_alignment.
+	// Network files store the parameters in exactly this layout
+	auto parameters() -> std::span<Scalar>;
+	auto parameters() const -> std::span<const Scalar>;
 
-	auto get_prediction(std::vector<u8> pixels) const -> Eigen::VectorXd;
+	// Size of the parameter block of a network with topology, padding included
+	static auto parameter_count(const std::vector<u64>& topology) -> std::size_t;
+
+	auto get_prediction(std::span<const u8> pixels) const -> vector_type;
+
+	// Same as above, the output layer values stay in workspace until its next use
+	auto get_prediction(std::span<const u8> pixels, prediction_workspace& workspace) const -> vector_type&;
+
+	// Runs the network on the first layer's weighted input, the product of its
+	// weights and the pixels before bias and activation. For callers keeping
+	// that product up to date themselves, see incremental_prediction
+	auto predict_from_weighted_input(const vector_type& first_weighted_input, prediction_workspace& workspace) const
+	    -> vector_type&;
+
+	// Runs every layer as one matrix-matrix product over all rows of pixels,
+	// returns one row of output layer values per input row
+	auto predict_batch(const Eigen::Ref<const pixel_matrix>& pixels) const -> prediction_matrix;
+
+	auto predict_batch(const Eigen::Ref<const pixel_matrix>& pixels, prediction_workspace& workspace) const
+	    -> Eigen::Ref<prediction_matrix>;
+
+private:
+	// Owns the parameter block, unless the network views a mapped file
+	std::vector<Scalar> parameter_storage;
+	std::optional<mapped_file> parameter_file;
+	std::span<Scalar> parameter_block;
+
+	// Points layer_weights and layer_bias into parameter_block
+	auto map_layers() -> void;
+
+	auto resize_prediction_layers(prediction_workspace& workspace) const -> std::vector<vector_type>&;
+
+	// Applies the first layer's bias and activation to workspace.layers[1]
+	// and runs the layers after it
+	auto finish_prediction(prediction_workspace& workspace) const -> vector_type&;
 };
 
-auto nudge_neural_network_values(network& neural_net, std::mt19937& rand_gen) -> void;
-auto randomize_neural_network_value(network& neural_net, std::mt19937& rand_gen) -> void;
+auto valid_network_topology(const std::vector<u64>& topology) -> bool;
+
+// Parses layer sizes like "784,16,16,10", nullopt unless they make a valid topology
+auto parse_network_topology(std::string_view text) -> std::optional<std::vector<u64>>;
+
+using network = basic_network<double>;
+using network_f32 = basic_network<float>;
+
+extern template class basic_network<double>;
+extern template class basic_network<float>;
+
+template<typename Scalar>
+auto nudge_neural_network_values(basic_network<Scalar>& neural_net, std::mt19937& rand_gen) -> void;
+
+template<typename Scalar>
+auto randomize_neural_network_value(basic_network<Scalar>& neural_net, std::mt19937& rand_gen) -> void;
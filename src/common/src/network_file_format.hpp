@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <span>
+
+#include "short_types.hpp"
+
+// Network files start with a magic number telling how the rest of the file is laid out
+
+// Far more than any network we train, stops a corrupt header from allocating
+// an absurd topology
+inline constexpr u32 max_network_file_layers { 1024 };
+
+// Self describing networks of any depth. The header below is followed by the
+// topology as u64s and one activation_function byte per non-input layer.
+// From header_size on comes the parameter block of basic_network, bias then
+// column major weights of every layer in scalar_size sized values, every block
+// aligned so the loader can map the file and use the parameters in place
+inline constexpr u32 network_magic_number { 0x607 };
+inline constexpr u32 network_file_version { 3 };
+
+struct network_file_header {
+	u32 magic_number;
+	u32 version;
+	u32 scalar_size;
+	u32 layer_count;  // entries in the topology, the input layer included
+	u64 header_size;  // offset of the parameter block, a multiple of its alignment
+	u64 parameter_size;  // in bytes
+	u64 checksum;  // network_file_checksum of the parameter block
+	double average_cost;  // training set cost the trainer measured for it, NaN if unknown
+};
+
+// FNV-1a over 64 bit words instead of bytes, a few times faster and the
+// parameter block size is always a multiple of 8
+inline auto network_file_checksum(std::span<const u8> bytes) -> u64 {
+	u64 hash { 0xcbf29ce484222325 };
+
+	for (std::size_t i { 0 }; i + sizeof(u64) <= bytes.size(); i += sizeof(u64)) {
+		u64 word;
+		std::memcpy(&word, bytes.data() + i, sizeof word);
+
+		hash = (hash ^ word) * 0x100000001b3;
+	}
+
+	return hash;
+}
+
+// Legacy fixed 784-16-16-10 networks, the magic number tells the precision of
+// the values following the topology
+inline constexpr u32 network_magic_number_f64 { 0x606 };
+inline constexpr u32 network_magic_number_f32 { 0x604 };
+
+// Quantized inference only networks, see quantized_network
+inline constexpr u32 network_magic_number_i8 { 0x601 };
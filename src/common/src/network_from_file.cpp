@@ -1,11 +1,20 @@
 #include <array>
+#include <cmath>
 #include <cstdlib>
+#include <cstring>
 #include <fstream>
+#include <optional>
 #include <span>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include <Eigen/Eigen>
 #include <fmt/format.h>
 
+#include "activation.hpp"
+#include "mapped_file.hpp"
+#include "network_file_format.hpp"
 #include "network_from_file.hpp"
 #include "short_types.hpp"
 
@@ -18,47 +27,411 @@ auto read_data(std::ifstream& file, T& output) -> void {
 	output = *reinterpret_cast<T*>(buf.data());
 };
 
-auto read_matrix(std::ifstream& file, Eigen::MatrixXd& matrix) {
+// Reads values stored as FileScalar into matrix, converting them to the
+// precision of the matrix
+template<typename FileScalar, typename Matrix>
+auto read_matrix(std::ifstream& file, Matrix& matrix) {
 	for (auto& value : std::span(matrix.data(), matrix.size())) {
-		read_data(file, value);
+		FileScalar file_value;
+		read_data(file, file_value);
+
+		value = static_cast<typename Matrix::Scalar>(file_value);
 	}
 };
 
-auto read_vector(std::ifstream& file, Eigen::VectorXd& matrix) {
-	for (auto& value : std::span(matrix.data(), matrix.size())) {
-		read_data(file, value);
+template<typename FileScalar, typename Scalar>
+auto read_layers(std::ifstream& file, basic_network<Scalar>& neural_net) {
+	for (size_t i { 0 }; i < neural_net.layer_weights.size(); ++i) {
+		read_matrix<FileScalar>(file, neural_net.layer_bias[i]);
+		read_matrix<FileScalar>(file, neural_net.layer_weights[i]);
 	}
-};
+}
+
+// The loaders report a file they can't use and return nothing, the public
+// functions without try_ exit on it
+template<typename T>
+auto value_or_exit(std::optional<T> value) -> T {
+	if (!value) {
+		std::exit(1);
+	}
+
+	return std::move(*value);
+}
 
-auto load_network_from_file(network& neural_net, const std::string filepath) -> void {
+auto open_network_file(const std::string& filepath) -> std::optional<std::ifstream> {
 	std::ifstream file { filepath, std::ios::binary };
 
 	if (!file.is_open()) {
 		fmt::print("Failed to open network file at {} while loading\n", filepath);
 
-		std::exit(1);
+		return std::nullopt;
 	}
 
-	u32 magic_number = 0x606;
+	return file;
+}
+
+auto read_magic_number(std::ifstream& file) -> std::optional<u32> {
 	u32 read_magic_number;
 	read_data(file, read_magic_number);
-	if (magic_number != read_magic_number) {
+
+	if (read_magic_number != network_magic_number && read_magic_number != network_magic_number_f64
+	    && read_magic_number != network_magic_number_f32) {
 		fmt::print(
 		    "Error read in magic number is incorrect\n"
-		    "Expected {}, got {}\n",
-		    magic_number, read_magic_number);
+		    "Expected {}, {} or {}, got {}\n",
+		    network_magic_number, network_magic_number_f64, network_magic_number_f32, read_magic_number);
+
+		return std::nullopt;
+	}
+
+	return read_magic_number;
+}
+
+// Fields at the start of the header, the ifstream is just past the magic number
+auto read_header(std::ifstream& file, const std::string& filepath) -> std::optional<network_file_header> {
+	network_file_header header {};
+	header.magic_number = network_magic_number;
+	read_data(file, header.version);
+	read_data(file, header.scalar_size);
+	read_data(file, header.layer_count);
+
+	if (header.version != network_file_version) {
+		fmt::print("Unsupported network file version {} in {}, expected {}\n", header.version, filepath,
+		           network_file_version);
+
+		return std::nullopt;
+	}
+
+	if (header.scalar_size != sizeof(float) && header.scalar_size != sizeof(double)) {
+		fmt::print("Unsupported value size {} in network file {}\n", header.scalar_size, filepath);
+
+		return std::nullopt;
+	}
+
+	if (header.layer_count < 2 || header.layer_count > max_network_file_layers) {
+		fmt::print("Invalid layer count {} in network file {}\n", header.layer_count, filepath);
+
+		return std::nullopt;
+	}
+
+	return header;
+}
+
+auto check_topology(const std::vector<u64>& topology, const std::string& filepath) -> bool {
+	if (!valid_network_topology(topology)) {
+		fmt::print("Invalid topology {} in network file {}\n", fmt::join(topology, ","), filepath);
+
+		return false;
+	}
+
+	return true;
+}
+
+auto check_activation(u8 stored_activation, const std::string& filepath) -> std::optional<activation_function> {
+	if (stored_activation > static_cast<u8>(activation_function::softmax)) {
+		fmt::print("Unknown activation function {} in network file {}\n", stored_activation, filepath);
+
+		return std::nullopt;
+	}
+
+	return static_cast<activation_function>(stored_activation);
+}
+
+// Header, topology and activations of a mapped file, after checking
+// that the parameter block they describe lies inside the file
+struct mapped_network_layout {
+	network_file_header header;
+	std::vector<u64> topology;
+	std::vector<activation_function> activations;
+};
+
+auto read_mapped_layout(std::span<const u8> bytes, const std::string& filepath)
+    -> std::optional<mapped_network_layout> {
+	auto read_bytes = [&](std::size_t offset, void* output, std::size_t size) {
+		if (offset + size > bytes.size()) {
+			fmt::print("Network file {} is truncated\n", filepath);
+
+			return false;
+		}
+
+		std::memcpy(output, bytes.data() + offset, size);
+
+		return true;
+	};
+
+	mapped_network_layout layout {};
+	if (!read_bytes(0, &layout.header, sizeof layout.header)) {
+		return std::nullopt;
+	}
+	const auto& header { layout.header };
+
+	// The file may have been replaced since its magic number was read
+	if (header.magic_number != network_magic_number || header.version != network_file_version) {
+		fmt::print("Network file {} isn't a version {} network\n", filepath, network_file_version);
+
+		return std::nullopt;
+	}
+
+	if (header.scalar_size != sizeof(float) && header.scalar_size != sizeof(double)) {
+		fmt::print("Unsupported value size {} in network file {}\n", header.scalar_size, filepath);
+
+		return std::nullopt;
+	}
+
+	if (header.layer_count < 2 || header.layer_count > max_network_file_layers) {
+		fmt::print("Invalid layer count {} in network file {}\n", header.layer_count, filepath);
+
+		return std::nullopt;
+	}
+
+	std::size_t offset { sizeof header };
+
+	layout.topology.resize(header.layer_count);
+	if (!read_bytes(offset, layout.topology.data(), layout.topology.size() * sizeof(u64))) {
+		return std::nullopt;
+	}
+	offset += layout.topology.size() * sizeof(u64);
+
+	if (!check_topology(layout.topology, filepath)) {
+		return std::nullopt;
+	}
+
+	for (u32 i { 1 }; i < header.layer_count; ++i) {
+		u8 stored_activation;
+		if (!read_bytes(offset, &stored_activation, sizeof stored_activation)) {
+			return std::nullopt;
+		}
+		offset += sizeof stored_activation;
+
+		auto activation { check_activation(stored_activation, filepath) };
+		if (!activation) {
+			return std::nullopt;
+		}
+
+		layout.activations.push_back(*activation);
+	}
+
+	std::size_t expected_parameter_size { header.scalar_size == sizeof(float)
+		                                      ? network_f32::parameter_count(layout.topology) * sizeof(float)
+		                                      : network::parameter_count(layout.topology) * sizeof(double) };
+
+	if (header.header_size < offset || header.header_size % network::parameter_alignment != 0
+	    || header.parameter_size != expected_parameter_size) {
+		fmt::print("Corrupt header in network file {}\n", filepath);
+
+		return std::nullopt;
+	}
+
+	if (header.header_size + header.parameter_size > bytes.size()) {
+		fmt::print("Network file {} is truncated\n", filepath);
+
+		return std::nullopt;
+	}
+
+	return layout;
+}
+
+// With verify_checksum the parameters are checked against the header on the
+// same mapping the network is built from, so a file replaced in between
+// can't slip past the check
+template<typename Scalar>
+auto map_network(basic_network<Scalar>& neural_net, const std::string& filepath, bool verify_checksum) -> bool {
+	auto file { mapped_file::try_open(filepath, map_mode::copy_on_write) };
+	if (!file) {
+		return false;
+	}
+
+	auto layout { read_mapped_layout(file->bytes(), filepath) };
+	if (!layout) {
+		return false;
+	}
+
+	if (verify_checksum
+	    && network_file_checksum(file->bytes().subspan(layout->header.header_size, layout->header.parameter_size))
+	           != layout->header.checksum) {
+		fmt::print("Network file {} is corrupt, its checksum doesn't match\n", filepath);
+
+		return false;
+	}
+
+	// Mapping only works when the file is in the precision asked for, others
+	// get converted from a view of the file
+	if (layout->header.scalar_size == sizeof(Scalar)) {
+		neural_net = basic_network<Scalar> { std::move(layout->topology), std::move(*file),
+			                                 layout->header.header_size };
+	} else if (layout->header.scalar_size == sizeof(float)) {
+		neural_net = basic_network<Scalar> { network_f32 { std::move(layout->topology), std::move(*file),
+			                                               layout->header.header_size } };
+	} else {
+		neural_net = basic_network<Scalar> { network { std::move(layout->topology), std::move(*file),
+			                                           layout->header.header_size } };
 	}
 
-	u64 layer_size;
-	read_data(file, layer_size);
-	read_data(file, layer_size);
-	read_data(file, layer_size);
-	read_data(file, layer_size);
+	neural_net.layer_activations = std::move(layout->activations);
 
-	read_vector(file, neural_net.layer_bias[0]);
-	read_matrix(file, neural_net.layer_weights[0]);
-	read_vector(file, neural_net.layer_bias[1]);
-	read_matrix(file, neural_net.layer_weights[1]);
-	read_vector(file, neural_net.layer_bias[2]);
-	read_matrix(file, neural_net.layer_weights[2]);
+	return true;
 }
+
+auto read_activation(std::ifstream& file, const std::string& filepath) -> std::optional<activation_function> {
+	u8 stored_activation;
+	read_data(file, stored_activation);
+
+	return check_activation(stored_activation, filepath);
+}
+
+template<typename Scalar>
+auto read_legacy_network(std::ifstream& file, u32 magic_number, basic_network<Scalar>& neural_net,
+                         const std::string& filepath) -> bool {
+	std::vector<u64> topology(4);
+	for (auto& layer_size : topology) {
+		read_data(file, layer_size);
+	}
+
+	if (!check_topology(topology, filepath)) {
+		return false;
+	}
+
+	neural_net = basic_network<Scalar> { std::move(topology) };
+
+	if (magic_number == network_magic_number_f32) {
+		read_layers<float>(file, neural_net);
+	} else {
+		read_layers<double>(file, neural_net);
+	}
+
+	// Legacy files may end with one activation byte per layer, ones without
+	// them are sigmoid throughout
+	for (auto& activation : neural_net.layer_activations) {
+		if (file.peek() == std::ifstream::traits_type::eof()) {
+			break;
+		}
+
+		auto stored_activation { read_activation(file, filepath) };
+		if (!stored_activation) {
+			return false;
+		}
+
+		activation = *stored_activation;
+	}
+
+	return true;
+}
+
+template<typename Scalar>
+auto load_network(basic_network<Scalar>& neural_net, const std::string& filepath, bool verify_checksum) -> bool {
+	auto file { open_network_file(filepath) };
+	if (!file) {
+		return false;
+	}
+
+	auto magic_number { read_magic_number(*file) };
+	if (!magic_number) {
+		return false;
+	}
+
+	if (*magic_number == network_magic_number) {
+		file->close();
+
+		return map_network(neural_net, filepath, verify_checksum);
+	}
+
+	if (!read_legacy_network(*file, *magic_number, neural_net, filepath)) {
+		return false;
+	}
+
+	if (!*file) {
+		fmt::print("Network file {} is truncated\n", filepath);
+
+		return false;
+	}
+
+	return true;
+}
+
+template<typename Scalar>
+auto try_load_network_from_file(basic_network<Scalar>& neural_net, const std::string& filepath) -> bool {
+	return load_network(neural_net, filepath, false);
+}
+
+template<typename Scalar>
+auto try_load_verified_network_from_file(basic_network<Scalar>& neural_net, const std::string& filepath) -> bool {
+	return load_network(neural_net, filepath, true);
+}
+
+template<typename Scalar>
+auto load_network_from_file(basic_network<Scalar>& neural_net, const std::string filepath) -> void {
+	if (!try_load_network_from_file(neural_net, filepath)) {
+		std::exit(1);
+	}
+}
+
+auto try_verify_network_file(const std::string& filepath) -> std::optional<bool> {
+	{
+		auto file { open_network_file(filepath) };
+		if (!file) {
+			return std::nullopt;
+		}
+
+		auto magic_number { read_magic_number(*file) };
+		if (!magic_number) {
+			return std::nullopt;
+		}
+
+		if (*magic_number != network_magic_number) {
+			return true;
+		}
+	}
+
+	auto file { mapped_file::try_open(filepath) };
+	if (!file) {
+		return std::nullopt;
+	}
+
+	auto layout { read_mapped_layout(file->bytes(), filepath) };
+	if (!layout) {
+		return std::nullopt;
+	}
+
+	return network_file_checksum(file->bytes().subspan(layout->header.header_size, layout->header.parameter_size))
+	    == layout->header.checksum;
+}
+
+auto verify_network_file(const std::string& filepath) -> bool {
+	return value_or_exit(try_verify_network_file(filepath));
+}
+
+auto network_file_average_cost(const std::string& filepath) -> std::optional<double> {
+	{
+		auto file { value_or_exit(open_network_file(filepath)) };
+		if (value_or_exit(read_magic_number(file)) != network_magic_number) {
+			return std::nullopt;
+		}
+	}
+
+	mapped_file file { filepath };
+	auto average_cost { value_or_exit(read_mapped_layout(file.bytes(), filepath)).header.average_cost };
+
+	if (std::isnan(average_cost)) {
+		return std::nullopt;
+	}
+
+	return average_cost;
+}
+
+auto network_file_scalar_size(const std::string& filepath) -> size_t {
+	auto file { value_or_exit(open_network_file(filepath)) };
+	auto magic_number { value_or_exit(read_magic_number(file)) };
+
+	if (magic_number == network_magic_number) {
+		return value_or_exit(read_header(file, filepath)).scalar_size;
+	}
+
+	return magic_number == network_magic_number_f32 ? sizeof(float) : sizeof(double);
+}
+
+template auto try_load_network_from_file(network& neural_net, const std::string& filepath) -> bool;
+template auto try_load_network_from_file(network_f32& neural_net, const std::string& filepath) -> bool;
+template auto try_load_verified_network_from_file(network& neural_net, const std::string& filepath) -> bool;
+template auto try_load_verified_network_from_file(network_f32& neural_net, const std::string& filepath) -> bool;
+template auto load_network_from_file(network& neural_net, const std::string filepath) -> void;
+template auto load_network_from_file(network_f32& neural_net, const std::string filepath) -> void;
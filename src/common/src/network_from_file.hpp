@@ -1,7 +1,34 @@
 #pragma once
 
+#include <cstddef>
+#include <optional>
 #include <string>
 
 #include "network.hpp"
 
-auto load_network_from_file(network& neural_net, const std::string filepath) -> void;
+// Loads a network saved in either precision, converting the values to the
+// precision of neural_net. neural_net takes on the topology and activations
+// stored in the file
+template<typename Scalar>
+auto load_network_from_file(basic_network<Scalar>& neural_net, const std::string filepath) -> void;
+
+// load_network_from_file that prints why a file can't be loaded and returns
+// false rather than exit, for files that may be replaced while in use
+template<typename Scalar>
+auto try_load_network_from_file(basic_network<Scalar>& neural_net, const std::string& filepath) -> bool;
+
+// try_load_network_from_file that also checks the parameters against the
+// checksum in the header, on the same mapping the network is built from
+template<typename Scalar>
+auto try_load_verified_network_from_file(basic_network<Scalar>& neural_net, const std::string& filepath) -> bool;
+
+// Checks the parameters of a network file against the checksum in its header.
+// Loading leaves this out so mapping a network stays independent of its size,
+// formats without a checksum always pass
+auto verify_network_file(const std::string& filepath) -> bool;
+
+// Training set cost stored when the network was saved, nullopt if it wasn't
+auto network_file_average_cost(const std::string& filepath) -> std::optional<double>;
+
+// Size of the values stored in the network file, sizeof(float) or sizeof(double)
+auto network_file_scalar_size(const std::string& filepath) -> size_t;
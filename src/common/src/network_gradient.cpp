@@ -0,0 +1,160 @@
+#include <cstddef>
+#include <span>
+#include <vector>
+
+#include <Eigen/Eigen>
+
+#include "activation.hpp"
+#include "network_gradient.hpp"
+#include "trace.hpp"
+
+template<typename Scalar>
+basic_network_gradient<Scalar>::basic_network_gradient(const basic_network<Scalar>& neural_net) {
+	using matrix_type = typename basic_network<Scalar>::matrix_type;
+	using vector_type = typename basic_network<Scalar>::vector_type;
+
+	layer_weights.reserve(neural_net.layer_weights.size());
+	for (const auto& weights : neural_net.layer_weights) {
+		layer_weights.emplace_back(matrix_type::Zero(weights.rows(), weights.cols()));
+	}
+
+	layer_bias.reserve(neural_net.layer_bias.size());
+	for (const auto& bias : neural_net.layer_bias) {
+		layer_bias.emplace_back(vector_type::Zero(bias.size()));
+	}
+}
+
+template<typename Scalar>
+auto basic_network_gradient<Scalar>::set_zero() -> void {
+	for (auto& weights : layer_weights) {
+		weights.setZero();
+	}
+
+	for (auto& bias : layer_bias) {
+		bias.setZero();
+	}
+}
+
+template struct basic_network_gradient<double>;
+template struct basic_network_gradient<float>;
+
+// Turns gradient from the cost's gradient with respect to a layer's activations
+// into its gradient with respect to the layer's weighted inputs, every column
+// is one sample. Derivatives are written in terms of the activations so the
+// weighted inputs don't have to be kept around
+template<typename Matrix>
+auto activation_backward(activation_function function, const Matrix& activation, Matrix& gradient) -> void {
+	using Scalar = typename Matrix::Scalar;
+
+	switch (function) {
+		case activation_function::sigmoid:
+			gradient.array() *= activation.array() * (Scalar { 1 } - activation.array());
+			break;
+
+		case activation_function::fast_sigmoid:
+			// a = 0.5 * (1 + z / (1 + |z|)) gives da/dz = 0.5 * (1 - |2a - 1|)^2
+			gradient.array() *= Scalar { 0.5 }
+			                    * (Scalar { 1 } - (Scalar { 2 } * activation.array() - Scalar { 1 }).abs()).square();
+			break;
+
+		case activation_function::relu:
+			gradient.array() *= (activation.array() > Scalar { 0 }).template cast<Scalar>();
+			break;
+
+		case activation_function::softmax:
+			// Jacobian-vector product of softmax, g' = a * (g - dot(g, a))
+			for (Eigen::Index col { 0 }; col < gradient.cols(); ++col) {
+				const Scalar weighted_sum { gradient.col(col).dot(activation.col(col)) };
+				gradient.col(col).array() = activation.col(col).array() * (gradient.col(col).array() - weighted_sum);
+			}
+			break;
+	}
+}
+
+template<typename Scalar>
+auto gradient_of_neural_net(const basic_network<Scalar>& neural_net, const mnist_dataset& digits,
+                            std::span<const size_t> indices, basic_network_gradient<Scalar>& gradient) -> double {
+	return gradient_of_neural_net(neural_net, digits.pixels(), digits.labels(), indices, gradient);
+}
+
+template<typename Scalar>
+auto gradient_of_neural_net(const basic_network<Scalar>& neural_net, const Eigen::Ref<const pixel_matrix>& pixels,
+                            std::span<const u8> labels, std::span<const size_t> indices,
+                            basic_network_gradient<Scalar>& gradient) -> double {
+	TRACE_ZONE("gradient_of_neural_net");
+
+	using matrix_type = typename basic_network<Scalar>::matrix_type;
+
+	const auto layer_count { neural_net.layer_weights.size() };
+	const auto batch_size { static_cast<Eigen::Index>(indices.size()) };
+
+	// Every column is one digit of the batch, so each layer is a single
+	// matrix-matrix product instead of batch_size matrix-vector products
+	std::vector<matrix_type> activations {};
+	activations.reserve(layer_count + 1);
+
+	matrix_type& input = activations.emplace_back(neural_net.topology[0], batch_size);
+	matrix_type expected { matrix_type::Zero(neural_net.topology.back(), batch_size) };
+
+	for (Eigen::Index col { 0 }; col < batch_size; ++col) {
+		const auto sample { static_cast<Eigen::Index>(indices[col]) };
+
+		for (Eigen::Index row { 0 }; row < pixels.cols(); ++row) {
+			input(row, col) = static_cast<Scalar>(pixels(sample, row)) / Scalar { 256 };
+		}
+
+		expected(labels[indices[col]], col) = Scalar { 1 };
+	}
+
+	for (size_t i { 0 }; i < layer_count; ++i) {
+		matrix_type& weighted_input = activations.emplace_back(neural_net.layer_weights[i] * activations[i]);
+
+		const std::span<const Scalar> bias { neural_net.layer_bias[i].data(), neural_net.topology[i + 1] };
+		for (Eigen::Index col { 0 }; col < batch_size; ++col) {
+			apply_activation<Scalar>({ weighted_input.col(col).data(), bias.size() }, bias, neural_net.layer_activations[i]);
+		}
+	}
+
+	// cost = sum((a - y)^2), so dcost/da = 2 * (a - y)
+	matrix_type error { activations.back() - expected };
+	double total_cost { static_cast<double>(error.squaredNorm()) };
+
+	matrix_type delta { Scalar { 2 } * error };
+	activation_backward(neural_net.layer_activations.back(), activations.back(), delta);
+
+	for (size_t i { layer_count }; i-- > 0;) {
+		gradient.layer_weights[i].noalias() += delta * activations[i].transpose();
+		gradient.layer_bias[i] += delta.rowwise().sum();
+
+		if (i > 0) {
+			delta = neural_net.layer_weights[i].transpose() * delta;
+			activation_backward(neural_net.layer_activations[i - 1], activations[i], delta);
+		}
+	}
+
+	return total_cost;
+}
+
+template<typename Scalar>
+auto apply_network_gradient(basic_network<Scalar>& neural_net, const basic_network_gradient<Scalar>& gradient,
+                            Scalar step) -> void {
+	for (size_t i { 0 }; i < neural_net.layer_weights.size(); ++i) {
+		neural_net.layer_weights[i] -= step * gradient.layer_weights[i];
+		neural_net.layer_bias[i] -= step * gradient.layer_bias[i];
+	}
+}
+
+template auto gradient_of_neural_net(const network& neural_net, const mnist_dataset& digits,
+                                     std::span<const size_t> indices, network_gradient& gradient) -> double;
+template auto gradient_of_neural_net(const network_f32& neural_net, const mnist_dataset& digits,
+                                     std::span<const size_t> indices, network_gradient_f32& gradient) -> double;
+template auto gradient_of_neural_net(const network& neural_net, const Eigen::Ref<const pixel_matrix>& pixels,
+                                     std::span<const u8> labels, std::span<const size_t> indices,
+                                     network_gradient& gradient) -> double;
+template auto gradient_of_neural_net(const network_f32& neural_net, const Eigen::Ref<const pixel_matrix>& pixels,
+                                     std::span<const u8> labels, std::span<const size_t> indices,
+                                     network_gradient_f32& gradient) -> double;
+
+template auto apply_network_gradient(network& neural_net, const network_gradient& gradient, double step) -> void;
+template auto apply_network_gradient(network_f32& neural_net, const network_gradient_f32& gradient, float step)
+    -> void;
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+#include <Eigen/Eigen>
+
+#include "mnist_dataset.hpp"
+#include "network.hpp"
+
+// Holds the partial derivatives of the cost with respect to every weight and
+// bias of a network, laid out the same way as the network itself
+template<typename Scalar>
+struct basic_network_gradient {
+	std::vector<typename basic_network<Scalar>::matrix_type> layer_weights;
+	std::vector<typename basic_network<Scalar>::vector_type> layer_bias;
+
+	explicit basic_network_gradient(const basic_network<Scalar>& neural_net);
+
+	auto set_zero() -> void;
+};
+
+using network_gradient = basic_network_gradient<double>;
+using network_gradient_f32 = basic_network_gradient<float>;
+
+extern template struct basic_network_gradient<double>;
+extern template struct basic_network_gradient<float>;
+
+// Runs backpropagation over the digits picked by indices as a single batch and
+// stores the summed gradient in gradient, returns the summed cost of the batch
+template<typename Scalar>
+auto gradient_of_neural_net(const basic_network<Scalar>& neural_net, const mnist_dataset& digits,
+                            std::span<const size_t> indices, basic_network_gradient<Scalar>& gradient) -> double;
+
+// Same over samples held in memory, a row of pixels and a label per sample
+template<typename Scalar>
+auto gradient_of_neural_net(const basic_network<Scalar>& neural_net, const Eigen::Ref<const pixel_matrix>& pixels,
+                            std::span<const u8> labels, std::span<const size_t> indices,
+                            basic_network_gradient<Scalar>& gradient) -> double;
+
+template<typename Scalar>
+auto apply_network_gradient(basic_network<Scalar>& neural_net, const basic_network_gradient<Scalar>& gradient,
+                            Scalar step) -> void;
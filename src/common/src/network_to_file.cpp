@@ -1,52 +1,91 @@
 #include <cstdlib>
+#include <filesystem>
 #include <fstream>
+#include <limits>
+#include <optional>
 #include <span>
+#include <system_error>
+#include <vector>
 
-#include <Eigen/Eigen>
+#include <fcntl.h>
 #include <fmt/format.h>
+#include <unistd.h>
 
+#include "network_file_format.hpp"
 #include "network_to_file.hpp"
 #include "short_types.hpp"
+#include "trace.hpp"
 
-template <typename T>
-auto write_data(std::ofstream& file, const T& data) {
-	file.write(reinterpret_cast<const char*>(&data), sizeof data);
-};
-
-auto write_matrix(std::ofstream& file, const Eigen::MatrixXd& matrix) {
-	for (const auto& value : std::span(matrix.data(), matrix.size())) {
-		write_data(file, value);
-	}
-};
+template<typename T>
+auto write_values(std::ofstream& file, std::span<const T> values) {
+	file.write(reinterpret_cast<const char*>(values.data()), static_cast<std::streamsize>(values.size_bytes()));
+}
 
-auto write_vector(std::ofstream& file, const Eigen::VectorXd& vector) {
-	for (const auto& value : std::span(vector.data(), vector.size())) {
-		write_data(file, value);
-	}
-};
+template<typename Scalar>
+auto save_network_to_file(const basic_network<Scalar>& neural_net, const std::string filepath,
+                          std::optional<double> average_cost) -> void {
+	TRACE_ZONE("save_network_to_file");
 
-auto save_network_to_file(const network& neural_net, const std::string filepath) -> void {
-	std::ofstream file { filepath, std::ios::binary };
+	// Written next to the destination and renamed over it, so a network that's
+	// still mapped from the old file keeps its parameters and readers never see
+	// half a network
+	std::string temporary_filepath { filepath + ".tmp" };
+	std::ofstream file { temporary_filepath, std::ios::binary };
 
 	if (!file.is_open()) {
-		fmt::print("Failed to open network file at {} while saving\n", filepath);
+		fmt::print("Failed to open network file at {} while saving\n", temporary_filepath);
 
 		std::exit(1);
 	}
 
-	u32 magic_number = 0x606;
+	auto parameters { neural_net.parameters() };
+	std::span<const u8> parameter_bytes { reinterpret_cast<const u8*>(parameters.data()), parameters.size_bytes() };
+
+	std::size_t unpadded_header_size { sizeof(network_file_header) + neural_net.topology.size() * sizeof(u64)
+		                               + neural_net.layer_activations.size() * sizeof(activation_function) };
+	constexpr std::size_t alignment { basic_network<Scalar>::parameter_alignment };
+
+	network_file_header header {
+		.magic_number = network_magic_number,
+		.version = network_file_version,
+		.scalar_size = sizeof(Scalar),
+		.layer_count = static_cast<u32>(neural_net.topology.size()),
+		.header_size = (unpadded_header_size + alignment - 1) / alignment * alignment,
+		.parameter_size = parameter_bytes.size(),
+		.checksum = network_file_checksum(parameter_bytes),
+		.average_cost = average_cost.value_or(std::numeric_limits<double>::quiet_NaN()),
+	};
+
+	write_values(file, std::span<const network_file_header> { &header, 1 });
+	write_values<u64>(file, neural_net.topology);
+	write_values<activation_function>(file, neural_net.layer_activations);
+	write_values<char>(file, std::vector<char>(header.header_size - unpadded_header_size));
+	write_values(file, parameters);
 
-	write_data(file, magic_number);
+	file.close();
+	if (!file) {
+		fmt::print("Failed to write network file at {}\n", temporary_filepath);
 
-	for (auto& layer_size : neural_net.topology) {
-		write_data(file,layer_size);
+		std::exit(1);
+	}
+
+	// Without this a crash of the whole machine could leave the rename on disk
+	// but not the data it points to
+	if (int fd { ::open(temporary_filepath.c_str(), O_RDONLY) }; fd != -1) {
+		::fsync(fd);
+		::close(fd);
 	}
 
-	write_vector(file, neural_net.layer_bias[0]);
-	write_matrix(file, neural_net.layer_weights[0]);
-	write_vector(file, neural_net.layer_bias[1]);
-	write_matrix(file, neural_net.layer_weights[1]);
-	write_vector(file, neural_net.layer_bias[2]);
-	write_matrix(file, neural_net.layer_weights[2]);
+	std::error_code error {};
+	std::filesystem::rename(temporary_filepath, filepath, error);
+	if (error) {
+		fmt::print("Failed to move network file {} to {}: {}\n", temporary_filepath, filepath, error.message());
+
+		std::exit(1);
+	}
 }
 
+template auto save_network_to_file(const network& neural_net, const std::string filepath,
+                                   std::optional<double> average_cost) -> void;
+template auto save_network_to_file(const network_f32& neural_net, const std::string filepath,
+                                   std::optional<double> average_cost) -> void;
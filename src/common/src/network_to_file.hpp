@@ -1,7 +1,12 @@
 #pragma once
 
+#include <optional>
 #include <string>
 
 #include "network.hpp"
 
-auto save_network_to_file(const network& neural_net, const std::string filepath) -> void;
+// Saves the values in the precision of neural_net, average_cost goes into the
+// header for whoever loads the file later
+template<typename Scalar>
+auto save_network_to_file(const basic_network<Scalar>& neural_net, const std::string filepath,
+                          std::optional<double> average_cost = std::nullopt) -> void;
@@ -0,0 +1,131 @@
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+#include "quantized_network.hpp"
+
+// Sigmoid of the pre-activation sampled every 1/sigmoid_lut_resolution over
+// [-sigmoid_lut_range, sigmoid_lut_range), values outside of it saturate to
+// the first or last entry
+constexpr float sigmoid_lut_range { 8.0f };
+constexpr float sigmoid_lut_resolution { 128.0f };
+constexpr std::size_t sigmoid_lut_size { static_cast<std::size_t>(2 * sigmoid_lut_range * sigmoid_lut_resolution) };
+
+auto make_sigmoid_lut() -> std::array<u8, sigmoid_lut_size> {
+	std::array<u8, sigmoid_lut_size> lut {};
+
+	for (std::size_t i { 0 }; i < lut.size(); ++i) {
+		// Sample the middle of every bucket
+		double z { (static_cast<double>(i) + 0.5) / sigmoid_lut_resolution - sigmoid_lut_range };
+		lut[i] = static_cast<u8>(std::lround(255.0 / (1.0 + std::exp(-z))));
+	}
+
+	return lut;
+}
+
+const std::array<u8, sigmoid_lut_size> sigmoid_lut { make_sigmoid_lut() };
+
+auto quantized_sigmoid(float z) -> i16 {
+	auto index { static_cast<long>(std::floor((z + sigmoid_lut_range) * sigmoid_lut_resolution)) };
+
+	return sigmoid_lut[std::clamp(index, 0l, static_cast<long>(sigmoid_lut_size) - 1)];
+}
+
+template<typename Scalar>
+quantized_network::quantized_network(const basic_network<Scalar>& neural_net)
+    : topology { neural_net.topology } {
+	layers.reserve(neural_net.layer_weights.size());
+
+	for (std::size_t i { 0 }; i < neural_net.layer_weights.size(); ++i) {
+		const auto& weights { neural_net.layer_weights[i] };
+		auto& quantized_layer { layers.emplace_back() };
+
+		quantized_layer.weights.resize(weights.size());
+		quantized_layer.row_scales.resize(weights.rows());
+		quantized_layer.bias.resize(weights.rows());
+
+		for (Eigen::Index row { 0 }; row < weights.rows(); ++row) {
+			// Symmetric quantization, the largest weight of the row maps to 127
+			double max_weight { static_cast<double>(weights.row(row).cwiseAbs().maxCoeff()) };
+			double scale { max_weight > 0.0 ? max_weight / 127.0 : 1.0 };
+
+			quantized_layer.row_scales[row] = static_cast<float>(scale);
+			quantized_layer.bias[row] = static_cast<float>(neural_net.layer_bias[i][row]);
+
+			for (Eigen::Index col { 0 }; col < weights.cols(); ++col) {
+				auto value { std::lround(static_cast<double>(weights(row, col)) / scale) };
+				quantized_layer.weights[row * weights.cols() + col] = static_cast<i16>(std::clamp(value, -127l, 127l));
+			}
+		}
+	}
+}
+
+// 8 bit weights times 8 bit activations fits easily in an i32 for MNIST
+// sized layers, 784 * 127 * 255 is about 2^24.6
+auto quantized_dot(std::span<const i16> weights, std::span<const i16> activations) -> i32 {
+	// Fixed size blocks give the compiler a loop it vectorizes into
+	// widening multiply-adds even at -O2
+	constexpr std::size_t block_size { 32 };
+
+	i32 accumulator { 0 };
+	std::size_t i { 0 };
+
+	for (; i + block_size <= activations.size(); i += block_size) {
+		i32 block_accumulator { 0 };
+		for (std::size_t j { 0 }; j < block_size; ++j) {
+			block_accumulator += static_cast<i32>(weights[i + j]) * static_cast<i32>(activations[i + j]);
+		}
+
+		accumulator += block_accumulator;
+	}
+
+	for (; i < activations.size(); ++i) {
+		accumulator += static_cast<i32>(weights[i]) * static_cast<i32>(activations[i]);
+	}
+
+	return accumulator;
+}
+
+auto quantized_network::get_prediction(std::span<const u8> pixels) const -> Eigen::VectorXf {
+	std::vector<i16> activations(pixels.begin(), pixels.end());
+	std::vector<i16> next_activations {};
+
+	float activation_scale { quantized_input_scale };
+	Eigen::VectorXf output_layer {};
+
+	for (std::size_t i { 0 }; i < layers.size(); ++i) {
+		const auto& current_layer { layers[i] };
+		const auto outputs { topology[i + 1] };
+		const auto inputs { topology[i] };
+
+		bool is_output_layer { i + 1 == layers.size() };
+		if (is_output_layer) {
+			output_layer.resize(outputs);
+		} else {
+			next_activations.resize(outputs);
+		}
+
+		for (std::size_t row { 0 }; row < outputs; ++row) {
+			auto accumulator { quantized_dot(std::span(current_layer.weights).subspan(row * inputs, inputs),
+				                             activations) };
+			float z { static_cast<float>(accumulator) * current_layer.row_scales[row] * activation_scale
+				      + current_layer.bias[row] };
+
+			if (is_output_layer) {
+				// Only a handful of outputs, an exact sigmoid keeps close
+				// predictions from collapsing to the same u8 value
+				output_layer[row] = 1.0f / (1.0f + std::exp(-z));
+			} else {
+				next_activations[row] = quantized_sigmoid(z);
+			}
+		}
+
+		std::swap(activations, next_activations);
+		activation_scale = quantized_activation_scale;
+	}
+
+	return output_layer;
+}
+
+template quantized_network::quantized_network(const network& neural_net);
+template quantized_network::quantized_network(const network_f32& neural_net);
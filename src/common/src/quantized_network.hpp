@@ -0,0 +1,43 @@
+#pragma once
+
+#include <array>
+#include <span>
+#include <vector>
+
+#include <Eigen/Eigen>
+
+#include "network.hpp"
+#include "short_types.hpp"
+
+// Inference only copy of a network with 8 bit weights. Every weight row has
+// its own scale, activations between layers are quantized to 8 bits and the
+// dot products are accumulated in 32 bit integers. Every layer of the source
+// network has to use the sigmoid activation
+class quantized_network {
+public:
+	struct layer {
+		// Row major, one row per output. The values fit in an i8 and are
+		// stored as such on disk, in memory they are widened to i16 so the
+		// dot product maps onto 16 bit multiply-adds (pmaddwd)
+		std::vector<i16> weights;
+		std::vector<float> row_scales;
+		std::vector<float> bias;
+	};
+
+	std::vector<u64> topology;
+	std::vector<layer> layers;
+
+	quantized_network() = default;
+
+	template<typename Scalar>
+	explicit quantized_network(const basic_network<Scalar>& neural_net);
+
+	// Output layer values, they match what the source network predicts up to
+	// quantization error
+	auto get_prediction(std::span<const u8> pixels) const -> Eigen::VectorXf;
+};
+
+// Real values of quantized activations, pixels go from 0 to 255/256 like they do in
+// network::get_prediction and sigmoid outputs from 0 to 1
+inline constexpr float quantized_input_scale { 1.0f / 256.0f };
+inline constexpr float quantized_activation_scale { 1.0f / 255.0f };
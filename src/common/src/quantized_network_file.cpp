@@ -0,0 +1,126 @@
+#include <cstdlib>
+#include <fstream>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include "network.hpp"
+#include "network_file_format.hpp"
+#include "quantized_network_file.hpp"
+#include "short_types.hpp"
+
+template<typename T>
+auto write_values(std::ofstream& file, const std::vector<T>& values) {
+	file.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+}
+
+template<typename T>
+auto read_values(std::ifstream& file, std::vector<T>& values, std::size_t count) {
+	values.resize(count);
+	file.read(reinterpret_cast<char*>(values.data()), count * sizeof(T));
+}
+
+auto save_quantized_network_to_file(const quantized_network& neural_net, const std::string& filepath) -> void {
+	std::ofstream file { filepath, std::ios::binary };
+
+	if (!file.is_open()) {
+		fmt::print("Failed to open quantized network file at {} while saving\n", filepath);
+
+		std::exit(1);
+	}
+
+	u32 magic_number { network_magic_number_i8 };
+	file.write(reinterpret_cast<const char*>(&magic_number), sizeof magic_number);
+
+	u64 layer_count { neural_net.topology.size() };
+	file.write(reinterpret_cast<const char*>(&layer_count), sizeof layer_count);
+	write_values(file, neural_net.topology);
+
+	for (const auto& layer : neural_net.layers) {
+		write_values(file, layer.row_scales);
+		write_values(file, layer.bias);
+		write_values(file, std::vector<i8>(layer.weights.begin(), layer.weights.end()));
+	}
+}
+
+auto load_quantized_network_from_file(quantized_network& neural_net, const std::string& filepath) -> void {
+	std::ifstream file { filepath, std::ios::binary };
+
+	if (!file.is_open()) {
+		fmt::print("Failed to open quantized network file at {} while loading\n", filepath);
+
+		std::exit(1);
+	}
+
+	u32 magic_number {};
+	file.read(reinterpret_cast<char*>(&magic_number), sizeof magic_number);
+	if (magic_number != network_magic_number_i8) {
+		fmt::print(
+		    "Error read in magic number is incorrect\n"
+		    "Expected {}, got {}\n",
+		    network_magic_number_i8, magic_number);
+
+		std::exit(1);
+	}
+
+	u64 layer_count {};
+	file.read(reinterpret_cast<char*>(&layer_count), sizeof layer_count);
+	if (!file || layer_count < 2 || layer_count > max_network_file_layers) {
+		fmt::print("Invalid layer count {} in quantized network file {}\n", layer_count, filepath);
+
+		std::exit(1);
+	}
+
+	read_values(file, neural_net.topology, layer_count);
+	if (!file || !valid_network_topology(neural_net.topology)) {
+		fmt::print("Invalid topology {} in quantized network file {}\n", fmt::join(neural_net.topology, ","),
+		           filepath);
+
+		std::exit(1);
+	}
+
+	// Layer sizes are checked against what's left of the file before anything
+	// gets allocated for them
+	auto read_position { static_cast<u64>(file.tellg()) };
+	file.seekg(0, std::ios::end);
+	u64 remaining_size { static_cast<u64>(file.tellg()) - read_position };
+	file.seekg(static_cast<std::streamoff>(read_position));
+
+	neural_net.layers.clear();
+	for (u64 i { 1 }; i < layer_count; ++i) {
+		auto inputs { neural_net.topology[i - 1] };
+		auto outputs { neural_net.topology[i] };
+
+		// Scale, bias and a row of 8 bit weights per output
+		if (inputs > remaining_size || outputs > remaining_size / (2 * sizeof(float) + inputs)) {
+			fmt::print("Quantized network file at {} ended early\n", filepath);
+
+			std::exit(1);
+		}
+		remaining_size -= outputs * (2 * sizeof(float) + inputs);
+
+		auto& layer { neural_net.layers.emplace_back() };
+
+		read_values(file, layer.row_scales, outputs);
+		read_values(file, layer.bias, outputs);
+
+		std::vector<i8> weights {};
+		read_values(file, weights, outputs * inputs);
+		layer.weights.assign(weights.begin(), weights.end());
+	}
+
+	if (!file) {
+		fmt::print("Quantized network file at {} ended early\n", filepath);
+
+		std::exit(1);
+	}
+}
+
+auto is_quantized_network_file(const std::string& filepath) -> bool {
+	std::ifstream file { filepath, std::ios::binary };
+
+	u32 magic_number {};
+	file.read(reinterpret_cast<char*>(&magic_number), sizeof magic_number);
+
+	return file && magic_number == network_magic_number_i8;
+}
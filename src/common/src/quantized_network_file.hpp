@@ -0,0 +1,11 @@
+#pragma once
+
+#include <string>
+
+#include "quantized_network.hpp"
+
+auto save_quantized_network_to_file(const quantized_network& neural_net, const std::string& filepath) -> void;
+auto load_quantized_network_from_file(quantized_network& neural_net, const std::string& filepath) -> void;
+
+// Checks the magic number without loading the rest of the file
+auto is_quantized_network_file(const std::string& filepath) -> bool;
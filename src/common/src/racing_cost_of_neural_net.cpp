@@ -0,0 +1,89 @@
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <numeric>
+#include <optional>
+#include <random>
+
+#include <Eigen/Eigen>
+
+#include "racing_cost_of_neural_net.hpp"
+
+racing_evaluator::racing_evaluator(const mnist_dataset& in_digits, std::mt19937& rand_gen,
+                                   const racing_options& in_options)
+    : digits { in_digits }
+    , order(in_digits.size())
+    , options { in_options } {
+	std::iota(order.begin(), order.end(), u32 { 0 });
+	std::shuffle(order.begin(), order.end(), rand_gen);
+}
+
+template<typename Scalar>
+auto racing_evaluator::evaluate(const basic_network<Scalar>& neural_net, double threshold_cost) const
+    -> racing_result {
+	thread_local typename basic_network<Scalar>::prediction_workspace workspace {};
+	thread_local pixel_matrix batch {};
+
+	const std::size_t digit_count { order.size() };
+
+	// The bound is checked once per batch, the risk is split between the checks
+	// so that all of them together stay within it
+	const double check_count { std::ceil(static_cast<double>(digit_count) / prediction_batch_size) };
+	const bool use_bound { options.rejection_risk > 0 };
+	const double log_term { use_bound ? std::log(check_count / options.rejection_risk) : 0.0 };
+
+	batch.resize(prediction_batch_size, static_cast<Eigen::Index>(digits.pixels_per_image()));
+
+	double total_cost { 0.0 };
+	double total_squared_cost { 0.0 };
+
+	for (std::size_t first { 0 }; first < digit_count; first += prediction_batch_size) {
+		auto count { std::min<std::size_t>(prediction_batch_size, digit_count - first) };
+
+		for (std::size_t i { 0 }; i < count; ++i) {
+			auto sample { digits.sample(order[first + i]) };
+			std::copy(sample.begin(), sample.end(), batch.row(static_cast<Eigen::Index>(i)).data());
+		}
+
+		auto predictions { neural_net.predict_batch(batch.topRows(static_cast<Eigen::Index>(count)), workspace) };
+
+		for (std::size_t i { 0 }; i < count; ++i) {
+			auto prediction { predictions.row(static_cast<Eigen::Index>(i)) };
+			prediction[digits.label(order[first + i])] -= Scalar { 1 };
+
+			auto cost { static_cast<double>(prediction.squaredNorm()) };
+			total_cost += cost;
+			total_squared_cost += cost * cost;
+		}
+
+		const std::size_t scored { first + count };
+		if (scored == digit_count) {
+			break;
+		}
+
+		// Costs are never negative, the digits left can only add to the total
+		if (total_cost / static_cast<double>(digit_count) >= threshold_cost) {
+			return { std::nullopt, scored };
+		}
+
+		if (!use_bound || scored < options.min_digits) {
+			continue;
+		}
+
+		// The mean of the shuffled prefix is close to normally distributed around
+		// the mean of the whole set, exp(-z^2 / 2) bounds the tail past z deviations
+		const auto n { static_cast<double>(scored) };
+		const double mean { total_cost / n };
+		const double variance { std::max(total_squared_cost / n - mean * mean, 0.0) };
+
+		if (mean - std::sqrt(2.0 * log_term * variance / n) >= threshold_cost) {
+			return { std::nullopt, scored };
+		}
+	}
+
+	return { total_cost / static_cast<double>(digit_count), digit_count };
+}
+
+template auto racing_evaluator::evaluate(const network& neural_net, double threshold_cost) const -> racing_result;
+template auto racing_evaluator::evaluate(const network_f32& neural_net, double threshold_cost) const
+    -> racing_result;
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <random>
+#include <vector>
+
+#include "mnist_dataset.hpp"
+#include "network.hpp"
+#include "short_types.hpp"
+
+struct racing_options {
+	// Chance a candidate that would have beaten the threshold gets rejected
+	// anyway. At 0 only candidates that provably can't win are rejected
+	double rejection_risk;
+
+	// Digits scored before a candidate can be rejected, enough for the mean
+	// of their costs to be close to normally distributed
+	u64 min_digits;
+};
+
+struct racing_result {
+	// Cost over every digit, nullopt if the candidate was rejected early
+	std::optional<double> average_cost;
+	std::size_t digits_scored;
+};
+
+// Scores candidates over the digits in one fixed shuffled order and stops as
+// soon as one can't beat a threshold cost, either because the cost summed so
+// far already rules it out or because a confidence bound on the mean puts it
+// above the threshold with probability 1 - rejection_risk
+class racing_evaluator {
+public:
+	racing_evaluator(const mnist_dataset& in_digits, std::mt19937& rand_gen, const racing_options& in_options);
+
+	template<typename Scalar>
+	auto evaluate(const basic_network<Scalar>& neural_net, double threshold_cost) const -> racing_result;
+
+private:
+	const mnist_dataset& digits;
+	std::vector<u32> order;
+	racing_options options;
+};
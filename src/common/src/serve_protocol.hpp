@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+
+#include "short_types.hpp"
+
+// How serve_nn talks to its clients over a Unix socket. Both ends are on the
+// same machine, so every value is in native byte order.
+//
+// Right after accepting a connection the server sends a serve_hello. From
+// then on every request is input_size pixel bytes, and the server answers
+// each one with output_size f32 output layer values. Answers come in the
+// order their requests were sent, so requests carry no id and a client may
+// send more before reading the answers
+inline constexpr u32 serve_magic_number { 0x5e7 };
+inline constexpr u32 serve_protocol_version { 1 };
+
+struct serve_hello {
+	u32 magic_number;
+	u32 version;
+	u32 input_size;  // bytes per request, the pixels of one image
+	u32 output_size;  // f32 values per answer
+};
+
+inline constexpr auto serve_answer_size(const serve_hello& hello) -> std::size_t {
+	return hello.output_size * sizeof(float);
+}
+
+// The server stops reading a connection while this many bytes of answers wait
+// for its client, so a client that never reads its answers can't grow them
+// forever. A client sending more requests ahead than fit in it before reading
+// an answer would wait on the server while the server waits on it
+inline constexpr std::size_t serve_max_pending_output { 1 << 20 };
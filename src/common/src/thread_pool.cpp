@@ -0,0 +1,91 @@
+#include "thread_pool.hpp"
+
+thread_pool::thread_pool(std::size_t thread_count) {
+	if (thread_count == 0) {
+		thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+	}
+
+	workers.reserve(thread_count - 1);
+	for (std::size_t i { 1 }; i < thread_count; ++i) {
+		workers.emplace_back(&thread_pool::worker_loop, this);
+	}
+}
+
+thread_pool::~thread_pool() {
+	{
+		std::lock_guard lock { state_mutex };
+		stopping = true;
+	}
+	job_available.notify_all();
+
+	for (auto& worker : workers) {
+		worker.join();
+	}
+}
+
+auto thread_pool::thread_count() const -> std::size_t {
+	return workers.size() + 1;
+}
+
+auto thread_pool::parallel_for(std::size_t task_count, const std::function<void(std::size_t)>& task) -> void {
+	if (task_count == 0) {
+		return;
+	}
+
+	std::lock_guard submit_lock { submit_mutex };
+
+	auto new_job { std::make_shared<job>() };
+	new_job->task = task;
+	new_job->task_count = task_count;
+	new_job->remaining_tasks = task_count;
+
+	{
+		std::lock_guard lock { state_mutex };
+		current_job = new_job;
+		++job_generation;
+	}
+	job_available.notify_all();
+
+	work_on(*new_job);
+
+	std::unique_lock lock { state_mutex };
+	job_finished.wait(lock, [&] { return new_job->remaining_tasks == 0; });
+	current_job.reset();
+}
+
+auto thread_pool::work_on(job& active_job) -> void {
+	for (auto i { active_job.next_task++ }; i < active_job.task_count; i = active_job.next_task++) {
+		active_job.task(i);
+
+		if (--active_job.remaining_tasks == 0) {
+			// Take the lock so the notification can't slip in between the
+			// submitter checking remaining_tasks and starting to wait
+			std::lock_guard lock { state_mutex };
+			job_finished.notify_all();
+		}
+	}
+}
+
+auto thread_pool::worker_loop() -> void {
+	std::size_t seen_generation { 0 };
+
+	while (true) {
+		std::shared_ptr<job> next_job {};
+
+		{
+			std::unique_lock lock { state_mutex };
+			job_available.wait(lock, [&] { return stopping || (current_job && job_generation != seen_generation); });
+
+			if (stopping) {
+				return;
+			}
+
+			seen_generation = job_generation;
+			next_job = current_job;
+		}
+
+		// Holding a reference keeps the job alive even if the submitter
+		// already returned, its tasks are all taken by then so nothing runs
+		work_on(*next_job);
+	}
+}
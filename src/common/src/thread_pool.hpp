@@ -0,0 +1,82 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads that stay alive between jobs. The thread
+// calling parallel_for works on the job too, so a pool of 1 thread has no
+// workers and runs everything on the caller
+class thread_pool {
+public:
+	// thread_count of 0 uses every hardware thread
+	explicit thread_pool(std::size_t thread_count = 0);
+	~thread_pool();
+
+	thread_pool(const thread_pool&) = delete;
+	auto operator=(const thread_pool&) -> thread_pool& = delete;
+
+	auto thread_count() const -> std::size_t;
+
+	// Calls task(i) once for every i in [0, task_count), returns after every call finished
+	auto parallel_for(std::size_t task_count, const std::function<void(std::size_t)>& task) -> void;
+
+	// Splits [0, count) into chunks of chunk_size, maps every chunk with
+	// map(first, last) and combines the results with reduce in chunk order.
+	// The chunks don't depend on the thread count so the result is the same
+	// for any number of threads, including the serial reduce_chunks below
+	template<typename T, typename Map, typename Reduce>
+	auto parallel_reduce(std::size_t count, std::size_t chunk_size, T init, Map map, Reduce reduce) -> T {
+		std::vector<T> partials((count + chunk_size - 1) / chunk_size, init);
+
+		parallel_for(partials.size(), [&](std::size_t chunk) {
+			partials[chunk] = map(chunk * chunk_size, std::min(count, (chunk + 1) * chunk_size));
+		});
+
+		for (const auto& partial : partials) {
+			init = reduce(init, partial);
+		}
+
+		return init;
+	}
+
+private:
+	struct job {
+		std::function<void(std::size_t)> task {};
+		std::size_t task_count { 0 };
+
+		std::atomic<std::size_t> next_task { 0 };
+		std::atomic<std::size_t> remaining_tasks { 0 };
+	};
+
+	auto work_on(job& active_job) -> void;
+	auto worker_loop() -> void;
+
+	std::vector<std::thread> workers {};
+
+	// Only one job runs at a time, other callers wait for it to finish
+	std::mutex submit_mutex {};
+
+	std::mutex state_mutex {};
+	std::condition_variable job_available {};
+	std::condition_variable job_finished {};
+	std::shared_ptr<job> current_job {};
+	std::size_t job_generation { 0 };
+	bool stopping { false };
+};
+
+// Serial counterpart of thread_pool::parallel_reduce producing bit identical results
+template<typename T, typename Map, typename Reduce>
+auto reduce_chunks(std::size_t count, std::size_t chunk_size, T init, Map map, Reduce reduce) -> T {
+	for (std::size_t first { 0 }; first < count; first += chunk_size) {
+		init = reduce(init, map(first, std::min(count, first + chunk_size)));
+	}
+
+	return init;
+}
@@ -0,0 +1,168 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include "short_types.hpp"
+#include "trace.hpp"
+
+#ifdef NN_TRACING
+
+// A thread records at most this many zones per session, about 40MB, later
+// ones are dropped and counted
+constexpr std::size_t max_thread_trace_events { 1 << 20 };
+
+struct trace_event {
+	const char* name;
+	const char* arg_name;
+	i64 arg_value;
+	std::chrono::steady_clock::time_point start;
+	std::chrono::steady_clock::duration duration;
+};
+
+// Events of one thread. Only that thread adds to them, the mutex is for the
+// session reading them, so it's never contended while recording
+struct thread_trace {
+	u64 id;
+	std::mutex mutex {};
+	std::vector<trace_event> events {};
+	u64 dropped { 0 };
+};
+
+// Outlives the threads it traces, a thread that exits still gets written
+struct trace_registry {
+	std::mutex mutex {};
+	std::vector<std::shared_ptr<thread_trace>> threads {};
+	std::atomic<bool> recording { false };
+	std::chrono::steady_clock::time_point start {};
+};
+
+static trace_registry registry {};
+
+static auto this_thread_trace() -> thread_trace& {
+	thread_local std::shared_ptr<thread_trace> trace { [] {
+		std::lock_guard lock { registry.mutex };
+
+		auto trace { std::make_shared<thread_trace>(registry.threads.size() + 1) };
+		registry.threads.push_back(trace);
+
+		return trace;
+	}() };
+
+	return *trace;
+}
+
+trace_zone::trace_zone(const char* in_name, const char* in_arg_name, i64 in_arg_value)
+    : name { registry.recording.load(std::memory_order_relaxed) ? in_name : nullptr }
+    , arg_name { in_arg_name }
+    , arg_value { in_arg_value } {
+	if (name != nullptr) {
+		start = std::chrono::steady_clock::now();
+	}
+}
+
+trace_zone::~trace_zone() {
+	if (name == nullptr) {
+		return;
+	}
+
+	auto duration { std::chrono::steady_clock::now() - start };
+	auto& trace { this_thread_trace() };
+
+	std::lock_guard lock { trace.mutex };
+	if (trace.events.size() >= max_thread_trace_events) {
+		++trace.dropped;
+		return;
+	}
+
+	trace.events.push_back({ name, arg_name, arg_value, start, duration });
+}
+
+trace_session::trace_session(std::string in_filepath) : filepath { std::move(in_filepath) } {
+	std::lock_guard lock { registry.mutex };
+
+	for (auto& trace : registry.threads) {
+		std::lock_guard trace_lock { trace->mutex };
+		trace->events.clear();
+		trace->dropped = 0;
+	}
+
+	registry.start = std::chrono::steady_clock::now();
+	registry.recording = true;
+}
+
+trace_session::~trace_session() {
+	registry.recording = false;
+
+	std::FILE* output { std::fopen(filepath.c_str(), "w") };
+	if (output == nullptr) {
+		fmt::print("Failed to open \"{}\" to write the trace to\n", filepath);
+		return;
+	}
+
+	auto microseconds = [](std::chrono::steady_clock::duration duration) {
+		return std::chrono::duration<double, std::micro> { duration }.count();
+	};
+
+	std::lock_guard lock { registry.mutex };
+
+	u64 event_count { 0 };
+	u64 dropped { 0 };
+
+	fmt::print(output, "{{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+	fmt::print(output, "{{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"args\": {{\"name\": \"nn\"}}}}");
+
+	for (auto& trace : registry.threads) {
+		std::lock_guard trace_lock { trace->mutex };
+
+		fmt::print(output,
+		           ",\n{{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": {0}, "
+		           "\"args\": {{\"name\": \"thread {0}\"}}}}",
+		           trace->id);
+
+		for (const auto& event : trace->events) {
+			if (event.start < registry.start) {
+				continue;
+			}
+
+			fmt::print(output, ",\n{{\"name\": \"{}\", \"ph\": \"X\", \"pid\": 1, \"tid\": {}, \"ts\": {:.3f}, "
+			                   "\"dur\": {:.3f}",
+			           event.name, trace->id, microseconds(event.start - registry.start),
+			           microseconds(event.duration));
+
+			if (event.arg_name != nullptr) {
+				fmt::print(output, ", \"args\": {{\"{}\": {}}}", event.arg_name, event.arg_value);
+			}
+
+			fmt::print(output, "}}");
+		}
+
+		event_count += trace->events.size();
+		dropped += trace->dropped;
+	}
+
+	fmt::print(output, "\n]}}\n");
+	std::fclose(output);
+
+	fmt::print("Wrote {} trace events to \"{}\"", event_count, filepath);
+	if (dropped != 0) {
+		fmt::print(", dropped {} past {} per thread", dropped, max_thread_trace_events);
+	}
+	fmt::print("\n");
+}
+
+#else
+
+trace_session::trace_session(std::string in_filepath) : filepath { std::move(in_filepath) } {
+	fmt::print("Built without tracing, configure with -DNN_TRACING=ON to write \"{}\"\n", filepath);
+}
+
+trace_session::~trace_session() = default;
+
+#endif
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+
+#include "short_types.hpp"
+
+// Scoped zones timing hot paths on every thread, written out as Chrome trace
+// event JSON that Perfetto or chrome://tracing show as thread timelines.
+// Zones only exist in builds configured with -DNN_TRACING=ON, otherwise
+// TRACE_ZONE expands to nothing and its arguments aren't even evaluated
+
+// Records zones while it exists and writes them to filepath when it ends
+class trace_session {
+public:
+	explicit trace_session(std::string in_filepath);
+	~trace_session();
+
+	trace_session(const trace_session&) = delete;
+	auto operator=(const trace_session&) -> trace_session& = delete;
+
+private:
+	std::string filepath;
+};
+
+#ifdef NN_TRACING
+
+// Times its scope on the calling thread while a trace_session records, name
+// and arg_name have to outlive the session, string literals do
+class trace_zone {
+public:
+	explicit trace_zone(const char* in_name, const char* in_arg_name = nullptr, i64 in_arg_value = 0);
+	~trace_zone();
+
+	trace_zone(const trace_zone&) = delete;
+	auto operator=(const trace_zone&) -> trace_zone& = delete;
+
+private:
+	const char* name;
+	const char* arg_name;
+	i64 arg_value;
+	std::chrono::steady_clock::time_point start;
+};
+
+#define TRACE_ZONE_CONCAT_INNER(a, b) a##b
+#define TRACE_ZONE_CONCAT(a, b) TRACE_ZONE_CONCAT_INNER(a, b)
+
+// TRACE_ZONE("name") or TRACE_ZONE("name", "arg name", integer value)
+#define TRACE_ZONE(...) trace_zone TRACE_ZONE_CONCAT(trace_zone_, __LINE__)(__VA_ARGS__)
+
+#else
+
+#define TRACE_ZONE(...) static_cast<void>(0)
+
+#endif
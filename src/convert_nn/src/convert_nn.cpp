@@ -0,0 +1,22 @@
+#include <fmt/format.h>
+
+#include "convert_nn.hpp"
+#include "network.hpp"
+#include "network_from_file.hpp"
+#include "network_to_file.hpp"
+
+auto convert_nn(const std::string& input_filepath, const std::string& output_filepath, const std::string& precision)
+    -> void {
+	// Every float is exactly representable as a double, so going through a
+	// double network loses nothing whichever way the conversion goes
+	network neural_net {};
+	load_network_from_file(neural_net, input_filepath);
+
+	if (precision == "f32") {
+		save_network_to_file(network_f32 { neural_net }, output_filepath);
+	} else {
+		save_network_to_file(neural_net, output_filepath);
+	}
+
+	fmt::print("Saved {} network to \"{}\"\n", precision, output_filepath);
+}
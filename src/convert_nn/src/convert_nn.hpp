@@ -0,0 +1,7 @@
+#pragma once
+
+#include <string>
+
+// Rewrites the network at input_filepath with values of precision ("f64" or "f32")
+auto convert_nn(const std::string& input_filepath, const std::string& output_filepath, const std::string& precision)
+    -> void;
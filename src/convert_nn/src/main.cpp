@@ -0,0 +1,47 @@
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+
+#include <cxxopts.hpp>
+#include <fmt/format.h>
+
+#include "convert_nn.hpp"
+#include "short_types.hpp"
+
+auto main(i32 argc, char* argv[]) -> i32 {
+	cxxopts::Options opts {
+		"NN Converter",
+		"Converts neural network files between double and float precision",
+	};
+
+	opts.add_options()
+		("i,input", "Path to network binary", cxxopts::value<std::string>()->default_value("neural_network.nn"))
+		("o,output", "Path to write the converted network to", cxxopts::value<std::string>())
+		("p,precision", "Precision to convert to (f64, f32)", cxxopts::value<std::string>()->default_value("f32"));
+
+	opts.parse_positional("input");
+
+	// FIXME: catch exceptions thrown by cxxopts::Options::parse on errors
+	auto results = opts.parse(argc, argv);
+
+	std::string network_filepath { results["input"].as<std::string>() };
+	fmt::print("Using \"{}\" as network file\n", network_filepath);
+
+	if (!std::filesystem::exists(network_filepath)) {
+		fmt::print("Network file \"{}\" doesn't exist!\n", network_filepath);
+		std::exit(1);
+	}
+
+	if (results.count("output") == 0) {
+		fmt::print("No output path given, pass one with --output\n");
+		std::exit(1);
+	}
+
+	std::string precision { results["precision"].as<std::string>() };
+	if (precision != "f64" && precision != "f32") {
+		fmt::print("Unknown precision \"{}\", expected f64 or f32\n", precision);
+		std::exit(1);
+	}
+
+	convert_nn(network_filepath, results["output"].as<std::string>(), precision);
+}
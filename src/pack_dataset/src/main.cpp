@@ -0,0 +1,48 @@
+#include <cstdlib>
+#include <string>
+
+#include <cxxopts.hpp>
+#include <fmt/format.h>
+
+#include "dataset_pack.hpp"
+#include "pack_dataset.hpp"
+#include "short_types.hpp"
+
+auto main(i32 argc, char* argv[]) -> i32 {
+	cxxopts::Options opts {
+		"Dataset Packer",
+		"Packs the mnist IDX files into dataset packs the other tools load in their place",
+	};
+
+	opts.add_options()
+		("data-dir", "Path to mnist data directory", cxxopts::value<std::string>()->default_value("data"))
+		("encoding", "How pixels are stored (raw, sparse), raw packs are mapped in place, sparse ones are a third the size and unpacked when loaded", cxxopts::value<std::string>()->default_value("sparse"))
+		("verify", "Check the existing packs were made from the IDX files as they are now instead of packing", cxxopts::value<bool>()->default_value("false"));
+
+	// FIXME: catch exceptions thrown by cxxopts::Options::parse on errors
+	auto results = opts.parse(argc, argv);
+
+	std::string data_dir { results["data-dir"].as<std::string>() };
+
+	std::string encoding_name { results["encoding"].as<std::string>() };
+	auto encoding { pack_encoding_from_name(encoding_name) };
+	if (!encoding) {
+		fmt::print("Unknown encoding \"{}\", expected raw or sparse\n", encoding_name);
+		std::exit(1);
+	}
+
+	bool all_fresh { true };
+
+	for (const auto* set : { "training", "testing" }) {
+		auto images_path { fmt::format("{}/mnist_{}_images", data_dir, set) };
+		auto labels_path { fmt::format("{}/mnist_{}_labels", data_dir, set) };
+
+		if (results["verify"].as<bool>()) {
+			all_fresh = verify_dataset_pack(images_path, labels_path) && all_fresh;
+		} else {
+			pack_dataset(images_path, labels_path, *encoding);
+		}
+	}
+
+	return all_fresh ? 0 : 1;
+}
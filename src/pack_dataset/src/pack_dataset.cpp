@@ -0,0 +1,176 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <span>
+#include <system_error>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include "dataset_pack.hpp"
+#include "mapped_file.hpp"
+#include "mnist_dataset.hpp"
+#include "pack_dataset.hpp"
+
+static auto aligned_offset(std::size_t offset) -> std::size_t {
+	return (offset + dataset_pack_alignment - 1) / dataset_pack_alignment * dataset_pack_alignment;
+}
+
+static auto stamp_of(const std::string& filepath) -> source_file_stamp {
+	auto stamp { source_file_stamp_of(filepath) };
+	if (!stamp) {
+		fmt::print("IDX file \"{}\" doesn't exist!\n", filepath);
+		std::exit(1);
+	}
+
+	return *stamp;
+}
+
+// Zero runs and the nonzero pixels after them as pack_encoding::sparse lays them out
+static auto sparse_pixels(std::span<const u8> pixels) -> std::vector<u8> {
+	constexpr std::size_t max_run { 255 };
+
+	std::vector<u8> packed {};
+	packed.reserve(pixels.size() / 2);
+
+	for (std::size_t i { 0 }; i < pixels.size();) {
+		std::size_t zero_count { 0 };
+		while (i < pixels.size() && pixels[i] == 0 && zero_count < max_run) {
+			++zero_count;
+			++i;
+		}
+
+		auto first_pixel { i };
+		while (i < pixels.size() && pixels[i] != 0 && i - first_pixel < max_run) {
+			++i;
+		}
+
+		packed.push_back(static_cast<u8>(zero_count));
+		packed.push_back(static_cast<u8>(i - first_pixel));
+		packed.insert(packed.end(), pixels.begin() + static_cast<std::ptrdiff_t>(first_pixel),
+		              pixels.begin() + static_cast<std::ptrdiff_t>(i));
+	}
+
+	return packed;
+}
+
+auto pack_dataset(const std::string& images_path, const std::string& labels_path, pack_encoding encoding) -> void {
+	// Taken before reading, a file changing while it's packed makes the pack stale
+	auto images_stamp { stamp_of(images_path) };
+	auto labels_stamp { stamp_of(labels_path) };
+
+	mapped_file images_file { images_path };
+	mapped_file labels_file { labels_path };
+
+	auto layout { read_idx_layout(images_file.bytes(), labels_file.bytes(), 0) };
+	auto pixel_count { layout.count * layout.rows * layout.columns };
+
+	if (images_file.bytes().size() < idx_image_header_size + pixel_count
+	    || labels_file.bytes().size() < idx_label_header_size + layout.count) {
+		fmt::print("IDX files are smaller than the {} digit(s) their headers describe\n", layout.count);
+		std::exit(1);
+	}
+
+	auto pixels { images_file.bytes().subspan(idx_image_header_size, pixel_count) };
+	auto labels { labels_file.bytes().subspan(idx_label_header_size, layout.count) };
+
+	std::vector<u8> packed_pixels {};
+	if (encoding == pack_encoding::sparse) {
+		packed_pixels = sparse_pixels(pixels);
+		pixels = packed_pixels;
+	}
+
+	dataset_pack_header header {
+		.magic_number = dataset_pack_magic_number,
+		.version = dataset_pack_version,
+		.encoding = encoding,
+		.reserved = 0,
+		.count = layout.count,
+		.rows = layout.rows,
+		.columns = layout.columns,
+		.labels_offset = aligned_offset(sizeof(dataset_pack_header)),
+		.pixels_offset = aligned_offset(aligned_offset(sizeof(dataset_pack_header)) + layout.count),
+		.pixels_size = pixels.size(),
+		.images_size = images_stamp.size,
+		.images_modified = images_stamp.modified,
+		.labels_size = labels_stamp.size,
+		.labels_modified = labels_stamp.modified,
+		.source_checksum = dataset_pack_checksum(labels_file.bytes(), dataset_pack_checksum(images_file.bytes())),
+	};
+
+	auto filepath { dataset_pack_path(images_path) };
+	std::string temporary_filepath { filepath + ".tmp" };
+
+	std::FILE* file { std::fopen(temporary_filepath.c_str(), "wb") };
+	if (file == nullptr) {
+		fmt::print("Failed to open dataset pack at {} while saving\n", temporary_filepath);
+		std::exit(1);
+	}
+
+	std::vector<u8> padding(dataset_pack_alignment);
+	std::fwrite(&header, sizeof header, 1, file);
+	std::fwrite(padding.data(), 1, header.labels_offset - sizeof header, file);
+	std::fwrite(labels.data(), 1, labels.size(), file);
+	std::fwrite(padding.data(), 1, header.pixels_offset - header.labels_offset - labels.size(), file);
+	std::fwrite(pixels.data(), 1, pixels.size(), file);
+
+	if (std::ferror(file) != 0 || std::fclose(file) != 0) {
+		fmt::print("Failed to write dataset pack at {}\n", temporary_filepath);
+		std::exit(1);
+	}
+
+	std::error_code error {};
+	std::filesystem::rename(temporary_filepath, filepath, error);
+	if (error) {
+		fmt::print("Failed to move dataset pack {} to {}: {}\n", temporary_filepath, filepath, error.message());
+		std::exit(1);
+	}
+
+	auto pack_size { header.pixels_offset + pixels.size() };
+	auto source_size { images_file.bytes().size() + labels_file.bytes().size() };
+
+	fmt::print("Packed {} digits of {}x{} pixels into \"{}\" ({}), {} bytes, {:.1f}% of the IDX files\n",
+	           layout.count, layout.rows, layout.columns, filepath, pack_encoding_name(encoding), pack_size,
+	           static_cast<double>(pack_size) / static_cast<double>(source_size) * 100.0);
+}
+
+auto verify_dataset_pack(const std::string& images_path, const std::string& labels_path) -> bool {
+	auto filepath { dataset_pack_path(images_path) };
+	if (!source_file_stamp_of(filepath)) {
+		fmt::print("There's no dataset pack at \"{}\"\n", filepath);
+		return false;
+	}
+
+	mapped_file pack_file { filepath };
+
+	dataset_pack_header header {};
+	if (pack_file.bytes().size() < sizeof header) {
+		fmt::print("Dataset pack \"{}\" is truncated\n", filepath);
+		return false;
+	}
+	std::memcpy(&header, pack_file.bytes().data(), sizeof header);
+
+	mapped_file images_file { images_path };
+	mapped_file labels_file { labels_path };
+
+	if (header.magic_number != dataset_pack_magic_number || header.version != dataset_pack_version
+	    || header.source_checksum
+	           != dataset_pack_checksum(labels_file.bytes(), dataset_pack_checksum(images_file.bytes()))) {
+		fmt::print("Dataset pack \"{}\" wasn't made from the IDX files as they are now\n", filepath);
+		return false;
+	}
+
+	auto images_stamp { stamp_of(images_path) };
+	auto labels_stamp { stamp_of(labels_path) };
+
+	if (images_stamp.size != header.images_size || images_stamp.modified != header.images_modified
+	    || labels_stamp.size != header.labels_size || labels_stamp.modified != header.labels_modified) {
+		fmt::print("Dataset pack \"{}\" matches its IDX files but they were modified since, the tools skip it\n",
+		           filepath);
+		return false;
+	}
+
+	fmt::print("Dataset pack \"{}\" matches its IDX files\n", filepath);
+	return true;
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <string>
+
+#include "dataset_pack.hpp"
+
+// Writes the pack of an IDX image file and its label file next to the images
+auto pack_dataset(const std::string& images_path, const std::string& labels_path, pack_encoding encoding) -> void;
+
+// Whether the pack next to the images was made from the IDX files as they are
+// now, checked by their contents rather than their sizes and times
+auto verify_dataset_pack(const std::string& images_path, const std::string& labels_path) -> bool;
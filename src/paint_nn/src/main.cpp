@@ -1,13 +1,15 @@
 #include <cstdlib>
 #include <filesystem>
+#include <optional>
+#include <string>
 
 #include <cxxopts.hpp>
 #include <fmt/format.h>
 
-#include "network.hpp"
-#include "network_from_file.hpp"
+#include "model_handle.hpp"
 #include "paint_nn.hpp"
 #include "short_types.hpp"
+#include "trace.hpp"
 
 auto main(i32 argc, char* argv[]) -> i32 {
 	cxxopts::Options opts {
@@ -16,7 +18,8 @@ auto main(i32 argc, char* argv[]) -> i32 {
 	};
 
 	opts.add_options()
-		("i,input", "Path to network binary", cxxopts::value<std::string>()->default_value("neural_network.nn"));
+		("i,input", "Path to network binary", cxxopts::value<std::string>()->default_value("neural_network.nn"))
+		("trace", "Path to write a Chrome trace event file of the run to, needs a build with NN_TRACING", cxxopts::value<std::string>());
 
 	opts.parse_positional("input");
 
@@ -31,8 +34,23 @@ auto main(i32 argc, char* argv[]) -> i32 {
 		std::exit(1);
 	}
 
-	network neural_net { 28 * 28, 16, 16, 10 };
-	load_network_from_file(neural_net, network_filepath);
+	std::optional<trace_session> trace {};
+	if (results.count("trace") != 0) {
+		trace.emplace(results["trace"].as<std::string>());
+	}
+
+	model_handle model { network_filepath };
+
+	// The canvas is a 28x28 digit with one output per digit, later versions
+	// keep the input and output sizes of the first
+	{
+		auto net { model.get() };
+		if (net->topology.front() != 28 * 28 || net->topology.back() < 10) {
+			fmt::print("Network \"{}\" has topology {}, it needs 784 inputs and 10 outputs\n", network_filepath,
+			           fmt::join(net->topology, ","));
+			std::exit(1);
+		}
+	}
 
-	paint_nn(neural_net);
+	paint_nn(model);
 }
@@ -1,17 +1,71 @@
+#include <algorithm>
+#include <cmath>
 #include <utility>
+#include <vector>
 
 #include <SFML/Graphics.hpp>
 #include <fmt/format.h>
 
 #include "constrained_integral.hpp"
-#include "network.hpp"
+#include "incremental_prediction.hpp"
+#include "model_handle.hpp"
 #include "paint_nn.hpp"
 #include "short_types.hpp"
 
-auto paint_nn(const network& net) -> void {
+constexpr u32 canvas_size { 28 };
+
+// Canvas cells from left and top up to, not including, right and bottom
+struct cell_box {
+	u32 left { 0 };
+	u32 top { 0 };
+	u32 right { 0 };
+	u32 bottom { 0 };
+};
+
+static auto is_empty(const cell_box& box) -> bool {
+	return box.left >= box.right || box.top >= box.bottom;
+}
+
+static auto merge(const cell_box& a, const cell_box& b) -> cell_box {
+	if (is_empty(a)) {
+		return b;
+	}
+
+	if (is_empty(b)) {
+		return a;
+	}
+
+	return {
+		std::min(a.left, b.left),
+		std::min(a.top, b.top),
+		std::max(a.right, b.right),
+		std::max(a.bottom, b.bottom),
+	};
+}
+
+// The cells a brush of radius around mouse_pos can reach, any cell outside
+// of it is further than radius away
+static auto brush_box(sf::Vector2f mouse_pos, float radius, std::pair<u32, u32> scale_factor) -> cell_box {
+	if (radius <= 0.0f) {
+		return {};
+	}
+
+	auto to_cell = [](float pos, u32 scale) {
+		return static_cast<u32>(std::clamp(std::floor(pos / scale), 0.0f, static_cast<float>(canvas_size)));
+	};
+
+	return {
+		to_cell(mouse_pos.x - radius, scale_factor.first),
+		to_cell(mouse_pos.y - radius, scale_factor.second),
+		std::min(to_cell(mouse_pos.x + radius, scale_factor.first) + 1, canvas_size),
+		std::min(to_cell(mouse_pos.y + radius, scale_factor.second) + 1, canvas_size),
+	};
+}
+
+auto paint_nn(const model_handle& model) -> void {
 	std::pair<u32, u32> scale_factor { 30, 30 };
 	sf::RenderWindow window {
-		{ 28 * scale_factor.first, 28 * scale_factor.second },
+		{ canvas_size * scale_factor.first, canvas_size * scale_factor.second },
 		"window title",
 		sf::Style::None,
 	};
@@ -21,18 +75,44 @@ auto paint_nn(const network& net) -> void {
 	sf::Vector2f mouse_pos { 0, 0 };
 	float cursor_radius = 30.0;
 
-	std::vector<std::pair<sf::Rect<u32>, u8>> pixels;
+	// The drawn digit, row by row like the MNIST images, and how bright the
+	// brush highlights each cell on top of it
+	std::vector<u8> pixels(canvas_size * canvas_size);
+	std::vector<u8> brush_levels(canvas_size * canvas_size);
 
-	for (u32 i = 0; i < 28; ++i) {
-		for (u32 j = 0; j < 28; ++j) {
-			sf::Rect<u32> bound_box {
-				{ i * scale_factor.first, j * scale_factor.second },
-				{ scale_factor.first, scale_factor.second },
-			};
+	// The canvas is drawn as a single texture scaled up to the window. Only
+	// the cells the brush covers, this frame or the last one, get uploaded again
+	sf::Texture canvas_texture {};
+	canvas_texture.create(canvas_size, canvas_size);
 
-			pixels.emplace_back(bound_box, 0);
-		}
-	}
+	sf::Sprite canvas_sprite { canvas_texture };
+	canvas_sprite.setScale(scale_factor.first, scale_factor.second);
+
+	constexpr cell_box whole_canvas { 0, 0, canvas_size, canvas_size };
+	cell_box canvas_repaint { whole_canvas };
+	cell_box previous_brush {};
+	std::vector<u8> repaint_pixels {};
+
+	sf::CircleShape cursor {};
+	cursor.setFillColor(sf::Color::Transparent);
+	/* cursor.setOutlineColor({ 0, 0, 0, 100 }); */
+	/* cursor.setOutlineThickness(1); */
+
+	// Strokes change a few pixels a frame, predicting only adds those to the
+	// first layer. Frames that change no pixels don't predict at all
+	incremental_prediction<double> predictor {};
+	u64 predicted_version { 0 };
+	bool pixels_changed { false };
+
+	auto print_prediction = [&] {
+		predicted_version = model.version();
+
+		const auto& prediction = predictor.predict(model.get(), pixels);
+		size_t predicted_digit = std::distance(
+		    prediction.data(), std::max_element(prediction.data(), prediction.data() + prediction.size()));
+
+		fmt::print(" {}\r", predicted_digit);
+	};
 
 	while (window.isOpen()) {
 		for (sf::Event event; window.pollEvent(event);) {
@@ -45,19 +125,6 @@ auto paint_nn(const network& net) -> void {
 					static_cast<float>(std::max(event.mouseMove.x, 0)),
 					static_cast<float>(std::max(event.mouseMove.y, 0)),
 				};
-
-				std::vector<u8> digit_pixels {};
-				digit_pixels.resize(28 * 28);
-
-				for (u32 i { 0 }; i < pixels.size(); ++i) {
-					digit_pixels[i] = pixels[i].second;
-				}
-
-				auto prediction = net.get_prediction(digit_pixels);
-				size_t predicted_digit = std::distance(
-				    prediction.data(), std::max_element(prediction.data(), prediction.data() + prediction.size()));
-
-				fmt::print(" {}\r", predicted_digit);
 			}
 
 			if (event.type == sf::Event::MouseWheelScrolled) {
@@ -67,62 +134,98 @@ auto paint_nn(const network& net) -> void {
 			if (event.type == sf::Event::MouseButtonPressed) {
 				// Clear the screen on middle mouse press
 				if (event.mouseButton.button == sf::Mouse::Button::Middle) {
-					for (auto& [_, color] : pixels) {
+					for (auto& color : pixels) {
+						pixels_changed = pixels_changed || color != 0;
 						color = 0;
 					}
+
+					canvas_repaint = whole_canvas;
 				}
 			}
 		}
 
+		for (u32 y { previous_brush.top }; y < previous_brush.bottom; ++y) {
+			for (u32 x { previous_brush.left }; x < previous_brush.right; ++x) {
+				brush_levels[y * canvas_size + x] = 0;
+			}
+		}
 
-		for (auto& [rect_box, color] : pixels) {
-			sf::RectangleShape rect { {
-				static_cast<float>(rect_box.width),
-				static_cast<float>(rect_box.height),
-			} };
+		bool left_pressed { sf::Mouse::isButtonPressed(sf::Mouse::Button::Left) };
+		bool right_pressed { sf::Mouse::isButtonPressed(sf::Mouse::Button::Right) };
 
-			rect.setPosition({
-			    static_cast<float>(rect_box.left),
-			    static_cast<float>(rect_box.top),
-			});
+		cell_box brush { brush_box(mouse_pos, cursor_radius, scale_factor) };
+		for (u32 y { brush.top }; y < brush.bottom; ++y) {
+			for (u32 x { brush.left }; x < brush.right; ++x) {
+				sf::Vector2f cell_middle {
+					(x + 0.5f) * scale_factor.first,
+					(y + 0.5f) * scale_factor.second,
+				};
 
-			sf::Vector2f rect_middle { rect_box.left + rect_box.width / 2.0f, rect_box.top + rect_box.height / 2.0f };
+				auto diff { mouse_pos - cell_middle };
+				auto dist_to_box { std::sqrt(
+					std::pow(std::max(std::abs(diff.x) - scale_factor.first / 2.0f, 0.0f), 2)
+					+ std::pow(std::max(std::abs(diff.y) - scale_factor.second / 2.0f, 0.0f), 2)) };
 
-			auto diff { mouse_pos - rect_middle };
-			auto dist_to_box { std::sqrt(std::pow(std::max(std::abs(diff.x) - rect_box.width / 2.0f, 0.0f), 2)
-				                         + std::pow(std::max(std::abs(diff.y) - rect_box.height / 2.0f, 0.0f), 2)) };
+				if (dist_to_box >= cursor_radius) {
+					continue;
+				}
 
-			if (dist_to_box < cursor_radius) {
 				u8 white_levels { static_cast<u8>(255.0f - pow(dist_to_box / cursor_radius, 2) * 255.0f) };
-				rect.setFillColor({ white_levels, white_levels, white_levels, 255 });
+				brush_levels[y * canvas_size + x] = white_levels;
 
-				if (sf::Mouse::isButtonPressed(sf::Mouse::Button::Left)) {
+				u8& color { pixels[y * canvas_size + x] };
+				u8 previous_color { color };
+				if (left_pressed) {
 					constrained_integral<u8> constrained_color { color, { 0, 255 } };
 					constrained_color += white_levels;
 
 					color = constrained_color;
-				} else if (sf::Mouse::isButtonPressed(sf::Mouse::Right)) {
+				} else if (right_pressed) {
 					color = 0;
 				}
-			} else {
-				rect.setFillColor(sf::Color::Black);
+
+				pixels_changed = pixels_changed || color != previous_color;
 			}
+		}
 
-			rect.setFillColor(rect.getFillColor() + sf::Color { color, color, color, 255 });
+		cell_box repaint { merge(canvas_repaint, merge(previous_brush, brush)) };
+		if (!is_empty(repaint)) {
+			u32 width { repaint.right - repaint.left };
+			u32 height { repaint.bottom - repaint.top };
+			repaint_pixels.resize(width * height * 4);
+
+			for (u32 y { 0 }; y < height; ++y) {
+				for (u32 x { 0 }; x < width; ++x) {
+					auto i { (repaint.top + y) * canvas_size + repaint.left + x };
+					auto shade { static_cast<u8>(std::min(brush_levels[i] + pixels[i], 255)) };
+
+					auto* rgba { &repaint_pixels[(y * width + x) * 4] };
+					rgba[0] = shade;
+					rgba[1] = shade;
+					rgba[2] = shade;
+					rgba[3] = 255;
+				}
+			}
 
-			window.draw(rect);
+			canvas_texture.update(repaint_pixels.data(), width, height, repaint.left, repaint.top);
 		}
 
-		sf::CircleShape cursor { cursor_radius };
+		canvas_repaint = {};
+		previous_brush = brush;
+
+		// A network saved since predicts the drawn digit again too
+		if (pixels_changed || (predicted_version != 0 && predicted_version != model.version())) {
+			print_prediction();
+			pixels_changed = false;
+		}
+
+		cursor.setRadius(cursor_radius);
 		cursor.setPosition({
 		    mouse_pos.x - cursor_radius,
 		    mouse_pos.y - cursor_radius,
 		});
 
-		cursor.setFillColor(sf::Color::Transparent);
-		/* cursor.setOutlineColor({ 0, 0, 0, 100 }); */
-		/* cursor.setOutlineThickness(1); */
-
+		window.draw(canvas_sprite);
 		window.draw(cursor);
 
 		window.display();
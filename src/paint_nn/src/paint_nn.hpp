@@ -1,5 +1,6 @@
 #pragma once
 
-#include "network.hpp"
+#include "model_handle.hpp"
 
-auto paint_nn(const network& neural_network) -> void;
+// Predicts with the latest version of the network, new ones show up as they're saved
+auto paint_nn(const model_handle& model) -> void;
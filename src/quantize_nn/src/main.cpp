@@ -0,0 +1,40 @@
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+
+#include <cxxopts.hpp>
+#include <fmt/format.h>
+
+#include "quantize_nn.hpp"
+#include "short_types.hpp"
+
+auto main(i32 argc, char* argv[]) -> i32 {
+	cxxopts::Options opts {
+		"NN Quantizer",
+		"Writes an int8 quantized copy of a neural network for inference",
+	};
+
+	opts.add_options()
+		("i,input", "Path to network binary", cxxopts::value<std::string>()->default_value("neural_network.nn"))
+		("o,output", "Path to write the quantized network to", cxxopts::value<std::string>());
+
+	opts.parse_positional("input");
+
+	// FIXME: catch exceptions thrown by cxxopts::Options::parse on errors
+	auto results = opts.parse(argc, argv);
+
+	std::string network_filepath { results["input"].as<std::string>() };
+	fmt::print("Using \"{}\" as network file\n", network_filepath);
+
+	if (!std::filesystem::exists(network_filepath)) {
+		fmt::print("Network file \"{}\" doesn't exist!\n", network_filepath);
+		std::exit(1);
+	}
+
+	if (results.count("output") == 0) {
+		fmt::print("No output path given, pass one with --output\n");
+		std::exit(1);
+	}
+
+	quantize_nn(network_filepath, results["output"].as<std::string>());
+}
@@ -0,0 +1,31 @@
+#include <cstdlib>
+#include <filesystem>
+
+#include <fmt/format.h>
+
+#include "activation.hpp"
+#include "network.hpp"
+#include "network_from_file.hpp"
+#include "quantize_nn.hpp"
+#include "quantized_network.hpp"
+#include "quantized_network_file.hpp"
+
+auto quantize_nn(const std::string& input_filepath, const std::string& output_filepath) -> void {
+	network neural_net {};
+	load_network_from_file(neural_net, input_filepath);
+
+	// The quantized hidden layers use a sigmoid lookup table
+	for (const auto activation : neural_net.layer_activations) {
+		if (activation != activation_function::sigmoid) {
+			fmt::print("Can't quantize \"{}\", only sigmoid networks are supported but it uses {}\n", input_filepath,
+			           activation_function_name(activation));
+
+			std::exit(1);
+		}
+	}
+
+	save_quantized_network_to_file(quantized_network { neural_net }, output_filepath);
+
+	fmt::print("Saved quantized network to \"{}\" ({} bytes, source {} bytes)\n", output_filepath,
+	           std::filesystem::file_size(output_filepath), std::filesystem::file_size(input_filepath));
+}
@@ -0,0 +1,6 @@
+#pragma once
+
+#include <string>
+
+// Writes an int8 quantized copy of the network at input_filepath for inference
+auto quantize_nn(const std::string& input_filepath, const std::string& output_filepath) -> void;
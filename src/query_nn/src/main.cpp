@@ -0,0 +1,43 @@
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+
+#include <cxxopts.hpp>
+#include <fmt/format.h>
+
+#include "mnist_dataset.hpp"
+#include "query_nn.hpp"
+#include "short_types.hpp"
+
+auto main(i32 argc, char* argv[]) -> i32 {
+	cxxopts::Options opts {
+		"NN Server Load Generator",
+		"Sends the testing digits to serve_nn from concurrent connections and reports throughput and latency",
+	};
+
+	opts.add_options()
+		("d,data-dir", "Path to mnist data directory", cxxopts::value<std::string>()->default_value("data"))
+		("s,socket", "Path of the Unix socket serve_nn listens on", cxxopts::value<std::string>()->default_value("serve_nn.sock"))
+		("c,connections", "Number of concurrent connections, each sending from a thread of its own", cxxopts::value<u64>()->default_value("8"))
+		("n,requests", "Number of requests to send over all connections", cxxopts::value<u64>()->default_value("20000"))
+		("p,pipeline", "Requests a connection sends ahead of the answers it got", cxxopts::value<u64>()->default_value("1"));
+
+	// FIXME: catch exceptions thrown by cxxopts::Options::parse on errors
+	auto results = opts.parse(argc, argv);
+
+	std::string data_dir { results["data-dir"].as<std::string>() };
+
+	if (!std::filesystem::is_directory(data_dir)) {
+		fmt::print("Data directory \"{}\" doesn't exist!\n", data_dir);
+		std::exit(1);
+	}
+
+	mnist_dataset testing_digits { data_dir + "/mnist_testing_images", data_dir + "/mnist_testing_labels" };
+
+	query_nn(testing_digits, {
+		.socket_path = results["socket"].as<std::string>(),
+		.connection_count = results["connections"].as<u64>(),
+		.request_count = results["requests"].as<u64>(),
+		.pipeline_depth = results["pipeline"].as<u64>(),
+	});
+}
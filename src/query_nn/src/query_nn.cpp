@@ -0,0 +1,214 @@
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <latch>
+#include <span>
+#include <thread>
+#include <vector>
+
+#include <Eigen/Eigen>
+#include <fmt/format.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "accuracy_of_neural_net.hpp"
+#include "query_nn.hpp"
+#include "serve_protocol.hpp"
+
+using query_clock = std::chrono::steady_clock;
+
+// What one connection measured
+struct connection_result {
+	std::vector<double> latencies {};  // in microseconds, one per request
+	u64 correct { 0 };
+};
+
+static auto connect_to(const std::string& socket_path) -> int {
+	sockaddr_un address { .sun_family = AF_UNIX, .sun_path = {} };
+	if (socket_path.size() >= sizeof address.sun_path) {
+		fmt::print("Socket path \"{}\" is longer than the {} bytes Unix sockets allow\n", socket_path,
+		           sizeof address.sun_path - 1);
+		std::exit(1);
+	}
+	socket_path.copy(address.sun_path, socket_path.size());
+
+	int fd { socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0) };
+	if (fd == -1 || connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof address) == -1) {
+		fmt::print("Failed to connect to \"{}\": {}\n", socket_path, std::strerror(errno));
+		std::exit(1);
+	}
+
+	return fd;
+}
+
+static auto send_all(int fd, std::span<const u8> bytes) -> void {
+	while (!bytes.empty()) {
+		auto sent { send(fd, bytes.data(), bytes.size(), MSG_NOSIGNAL) };
+		if (sent == -1 && errno == EINTR) {
+			continue;
+		}
+
+		if (sent == -1) {
+			fmt::print("Failed to send a request: {}\n", std::strerror(errno));
+			std::exit(1);
+		}
+
+		bytes = bytes.subspan(static_cast<std::size_t>(sent));
+	}
+}
+
+static auto receive_all(int fd, std::span<u8> bytes) -> void {
+	while (!bytes.empty()) {
+		auto received { recv(fd, bytes.data(), bytes.size(), 0) };
+		if (received == -1 && errno == EINTR) {
+			continue;
+		}
+
+		if (received <= 0) {
+			fmt::print("Server closed the connection before answering every request\n");
+			std::exit(1);
+		}
+
+		bytes = bytes.subspan(static_cast<std::size_t>(received));
+	}
+}
+
+static auto receive_hello(int fd, const mnist_dataset& digits) -> serve_hello {
+	serve_hello hello {};
+	receive_all(fd, { reinterpret_cast<u8*>(&hello), sizeof hello });
+
+	if (hello.magic_number != serve_magic_number || hello.version != serve_protocol_version) {
+		fmt::print("Server doesn't speak version {} of the serve_nn protocol\n", serve_protocol_version);
+		std::exit(1);
+	}
+
+	if (hello.output_size == 0) {
+		fmt::print("Server answers with no output values\n");
+		std::exit(1);
+	}
+
+	if (hello.input_size != digits.pixels_per_image()) {
+		fmt::print("Server takes {} pixels per request, the digits have {}\n", hello.input_size,
+		           digits.pixels_per_image());
+		std::exit(1);
+	}
+
+	return hello;
+}
+
+// Sends the digits connection_index, connection_index + connection_count, ...
+// keeping up to pipeline_depth requests unanswered
+static auto run_connection(int fd, const serve_hello& hello, const mnist_dataset& digits,
+                           const query_options& options, u64 pipeline_depth, std::size_t connection_index,
+                           u64 request_count, connection_result& result) -> void {
+	auto digit_index = [&](u64 request) {
+		return (connection_index + request * options.connection_count) % digits.size();
+	};
+
+	std::vector<float> answer(hello.output_size);
+	std::deque<query_clock::time_point> send_times {};
+	result.latencies.reserve(request_count);
+
+	u64 sent { 0 };
+	for (u64 request { 0 }; request < request_count; ++request) {
+		while (sent < request_count && sent - request < pipeline_depth) {
+			send_times.push_back(query_clock::now());
+			send_all(fd, digits.sample(digit_index(sent)));
+			++sent;
+		}
+
+		receive_all(fd, { reinterpret_cast<u8*>(answer.data()), serve_answer_size(hello) });
+
+		std::chrono::duration<double, std::micro> latency { query_clock::now() - send_times.front() };
+		send_times.pop_front();
+		result.latencies.push_back(latency.count());
+
+		Eigen::Map<const Eigen::VectorXf> prediction { answer.data(), static_cast<Eigen::Index>(answer.size()) };
+		if (predicted_digit(prediction) == digits.label(digit_index(request))) {
+			result.correct += 1;
+		}
+	}
+}
+
+auto query_nn(const mnist_dataset& digits, const query_options& options) -> void {
+	if (digits.size() == 0) {
+		fmt::print("No digits to send\n");
+		std::exit(1);
+	}
+
+	auto connection_count { std::max<u64>(options.connection_count, 1) };
+
+	std::vector<int> fds {};
+	std::vector<serve_hello> hellos {};
+	for (u64 i { 0 }; i < connection_count; ++i) {
+		fds.push_back(connect_to(options.socket_path));
+		hellos.push_back(receive_hello(fds.back(), digits));
+	}
+
+	// Requests are sent blocking, so the answers to the ones in flight have to
+	// fit in what the server buffers for a connection before it stops reading
+	u64 max_pipeline_depth { std::max<u64>(serve_max_pending_output / serve_answer_size(hellos.front()), 2) - 1 };
+	u64 pipeline_depth { std::clamp<u64>(options.pipeline_depth, 1, max_pipeline_depth) };
+	if (pipeline_depth < options.pipeline_depth) {
+		fmt::print("Sending at most {} requests ahead, the server would stop reading with more\n", pipeline_depth);
+	}
+
+	fmt::print("Sending {} requests over {} connections, {} in flight on each\n", options.request_count,
+	           connection_count, pipeline_depth);
+
+	std::vector<connection_result> results(connection_count);
+	std::vector<std::thread> threads {};
+	std::latch started { static_cast<std::ptrdiff_t>(connection_count) + 1 };
+
+	for (u64 i { 0 }; i < connection_count; ++i) {
+		// The first connections send one more request when they don't split evenly
+		auto request_count { options.request_count / connection_count
+		                     + (i < options.request_count % connection_count ? 1 : 0) };
+
+		threads.emplace_back([&, i, request_count] {
+			started.arrive_and_wait();
+			run_connection(fds[i], hellos[i], digits, options, pipeline_depth, i, request_count, results[i]);
+		});
+	}
+
+	started.arrive_and_wait();
+	auto start_time { query_clock::now() };
+
+	for (auto& thread : threads) {
+		thread.join();
+	}
+	std::chrono::duration<double> elapsed { query_clock::now() - start_time };
+
+	for (int fd : fds) {
+		close(fd);
+	}
+
+	std::vector<double> latencies {};
+	u64 correct { 0 };
+	for (const auto& result : results) {
+		latencies.insert(latencies.end(), result.latencies.begin(), result.latencies.end());
+		correct += result.correct;
+	}
+
+	if (latencies.empty()) {
+		fmt::print("No requests sent\n");
+		return;
+	}
+
+	std::sort(latencies.begin(), latencies.end());
+	auto percentile = [&](double fraction) {
+		auto index { static_cast<std::size_t>(fraction * static_cast<double>(latencies.size())) };
+		return latencies[std::min(index, latencies.size() - 1)];
+	};
+
+	fmt::print("{:.0f} requests/s over {:.2f}s\n", static_cast<double>(latencies.size()) / elapsed.count(),
+	           elapsed.count());
+	fmt::print("Latency p50 {:.0f}us | p99 {:.0f}us | max {:.0f}us\n", percentile(0.50), percentile(0.99),
+	           latencies.back());
+	fmt::print("{:6d} / {:6d} correct | {:.2f}%\n", correct, latencies.size(),
+	           static_cast<double>(correct) / static_cast<double>(latencies.size()) * 100.0);
+}
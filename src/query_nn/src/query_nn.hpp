@@ -0,0 +1,25 @@
+#pragma once
+
+#include <string>
+
+#include "mnist_dataset.hpp"
+#include "short_types.hpp"
+
+struct query_options {
+	std::string socket_path;
+
+	// Each connection has a thread of its own sending requests
+	u64 connection_count;
+
+	// Over all connections together
+	u64 request_count;
+
+	// Requests a connection has sent and not gotten the answer to yet, 1 waits
+	// for every answer before sending the next request
+	u64 pipeline_depth;
+};
+
+// Load generator for serve_nn. Sends the digits in turn as requests and
+// reports requests per second, latency percentiles and how many answers
+// predict the digit's label
+auto query_nn(const mnist_dataset& digits, const query_options& options) -> void;
@@ -0,0 +1,73 @@
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <optional>
+#include <string>
+
+#include <cxxopts.hpp>
+#include <fmt/format.h>
+
+#include "model_handle.hpp"
+#include "network_from_file.hpp"
+#include "quantized_network_file.hpp"
+#include "serve_nn.hpp"
+#include "short_types.hpp"
+#include "trace.hpp"
+
+auto main(i32 argc, char* argv[]) -> i32 {
+	cxxopts::Options opts {
+		"NN Server",
+		"Answers prediction requests of local processes over a Unix socket, batching concurrent ones",
+	};
+
+	opts.add_options()
+		("i,input", "Path to network binary", cxxopts::value<std::string>()->default_value("neural_network.nn"))
+		("s,socket", "Path of the Unix socket to listen on", cxxopts::value<std::string>()->default_value("serve_nn.sock"))
+		("b,max-batch", "Most requests predicted together in one batch", cxxopts::value<u64>()->default_value(std::to_string(prediction_batch_size)))
+		("max-delay", "Most microseconds a request waits for others to join its batch, 0 batches only what arrives together", cxxopts::value<u64>()->default_value("500"))
+		("trace", "Path to write a Chrome trace event file of the run to, needs a build with NN_TRACING", cxxopts::value<std::string>());
+
+	opts.parse_positional("input");
+
+	// FIXME: catch exceptions thrown by cxxopts::Options::parse on errors
+	auto results = opts.parse(argc, argv);
+
+	std::string network_filepath { results["input"].as<std::string>() };
+	fmt::print("Using \"{}\" as network file\n", network_filepath);
+
+	if (!std::filesystem::exists(network_filepath)) {
+		fmt::print("Network file \"{}\" doesn't exist!\n", network_filepath);
+		std::exit(1);
+	}
+
+	if (is_quantized_network_file(network_filepath)) {
+		fmt::print("Network file \"{}\" is quantized, serve_nn needs a network that can predict in batches\n",
+		           network_filepath);
+		std::exit(1);
+	}
+
+	if (!verify_network_file(network_filepath)) {
+		fmt::print("Network file \"{}\" is corrupt, its checksum doesn't match\n", network_filepath);
+		std::exit(1);
+	}
+
+	serve_options options {
+		.socket_path = results["socket"].as<std::string>(),
+		.max_batch_size = results["max-batch"].as<u64>(),
+		.max_batch_delay = std::chrono::microseconds { results["max-delay"].as<u64>() },
+	};
+
+	std::optional<trace_session> trace {};
+	if (results.count("trace") != 0) {
+		trace.emplace(results["trace"].as<std::string>());
+	}
+
+	// Serve in the precision the network was saved in
+	if (network_file_scalar_size(network_filepath) == sizeof(float)) {
+		model_handle_f32 model { network_filepath };
+		serve_nn(model, options);
+	} else {
+		model_handle model { network_filepath };
+		serve_nn(model, options);
+	}
+}
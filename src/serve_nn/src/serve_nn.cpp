@@ -0,0 +1,513 @@
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <fmt/format.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "serve_nn.hpp"
+#include "serve_protocol.hpp"
+#include "trace.hpp"
+
+// Bytes read from a connection per readable event
+constexpr std::size_t read_buffer_size { 1 << 16 };
+
+// Exits saying what failed if a system call did
+static auto check(int result, std::string_view action) -> int {
+	if (result == -1) {
+		fmt::print("Failed to {}: {}\n", action, std::strerror(errno));
+		std::exit(1);
+	}
+
+	return result;
+}
+
+static auto would_block() -> bool {
+	return errno == EAGAIN || errno == EWOULDBLOCK;
+}
+
+static auto listen_on(const std::string& socket_path) -> int {
+	sockaddr_un address { .sun_family = AF_UNIX, .sun_path = {} };
+	if (socket_path.size() >= sizeof address.sun_path) {
+		fmt::print("Socket path \"{}\" is longer than the {} bytes Unix sockets allow\n", socket_path,
+		           sizeof address.sun_path - 1);
+		std::exit(1);
+	}
+	socket_path.copy(address.sun_path, socket_path.size());
+
+	const auto* socket_address { reinterpret_cast<const sockaddr*>(&address) };
+
+	// A server that didn't exit cleanly leaves its socket behind and bind
+	// won't replace it. One that still accepts connections is left alone
+	if (std::filesystem::is_socket(socket_path)) {
+		int probe { check(socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0), "create a socket") };
+		bool in_use { connect(probe, socket_address, sizeof address) == 0 };
+		close(probe);
+
+		if (in_use) {
+			fmt::print("Another server is already listening on \"{}\"\n", socket_path);
+			std::exit(1);
+		}
+
+		unlink(socket_path.c_str());
+	}
+
+	int fd { check(socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0), "create a socket") };
+	check(bind(fd, socket_address, sizeof address), fmt::format("bind to \"{}\"", socket_path));
+	check(listen(fd, SOMAXCONN), fmt::format("listen on \"{}\"", socket_path));
+
+	return fd;
+}
+
+// SIGINT and SIGTERM are blocked and read from the returned file descriptor
+// instead, so the event loop handles them like any other event
+static auto stop_signal_fd() -> int {
+	sigset_t signals {};
+	sigemptyset(&signals);
+	sigaddset(&signals, SIGINT);
+	sigaddset(&signals, SIGTERM);
+
+	sigprocmask(SIG_BLOCK, &signals, nullptr);
+
+	return check(signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC), "create a signalfd");
+}
+
+// One accepted client
+struct connection {
+	int fd;
+
+	// File descriptors get reused, ids don't, a queued request whose
+	// connection closed meanwhile can't be answered to a newer one
+	u64 id;
+
+	// The first bytes of a request the client is partway through sending
+	std::vector<u8> input {};
+
+	// Answers not sent yet start output_sent bytes into output
+	std::vector<u8> output {};
+	std::size_t output_sent { 0 };
+
+	// What epoll watches the connection for
+	u32 events { 0 };
+
+	// Number of the last batch a request of the connection was queued in
+	std::optional<u64> last_batch {};
+
+	// Closed at the end of the event loop pass, events for it are ignored till then
+	bool closing { false };
+
+	auto pending_output() const -> std::size_t {
+		return output.size() - output_sent;
+	}
+};
+
+template<typename Scalar>
+class batch_server {
+public:
+	batch_server(const basic_model_handle<Scalar>& in_model, const serve_options& in_options);
+	~batch_server();
+
+	batch_server(const batch_server&) = delete;
+	auto operator=(const batch_server&) -> batch_server& = delete;
+
+	auto run() -> void;
+
+private:
+	struct queued_request {
+		int fd;
+		u64 connection_id;
+	};
+
+	auto accept_connections() -> void;
+	auto read_requests(connection& client) -> void;
+	auto queue_request(connection& client, std::span<const u8> pixels) -> void;
+
+	// Predicts every queued request in one predict_batch and sends the answers
+	auto run_batch() -> void;
+
+	// Clients that wait for every answer before sending again won't add to
+	// the batch once each of them has a request in it, waiting longer is no use
+	auto every_connection_queued() const -> bool;
+
+	auto send_output(connection& client) -> void;
+	auto update_events(connection& client) -> void;
+	auto close_later(connection& client) -> void;
+	auto close_connections() -> void;
+
+	auto set_batch_timer(std::chrono::microseconds delay) -> void;
+
+	const basic_model_handle<Scalar>& model;
+	serve_options options;
+
+	std::size_t input_size;
+	std::size_t output_size;
+
+	int listen_fd { -1 };
+	int signal_fd { -1 };
+	int timer_fd { -1 };
+	int epoll_fd { -1 };
+
+	std::unordered_map<int, connection> connections {};
+	std::vector<int> closing_fds {};
+	u64 next_connection_id { 0 };
+
+	// Row i holds the pixels of queued[i]
+	pixel_matrix batch_pixels {};
+	std::vector<queued_request> queued {};
+
+	// Connections with a request in the batch, not counting closing ones
+	std::size_t queued_connections { 0 };
+
+	typename basic_network<Scalar>::prediction_workspace workspace {};
+
+	u64 answered { 0 };
+	u64 batch_count { 0 };
+	u64 largest_batch { 0 };
+};
+
+template<typename Scalar>
+batch_server<Scalar>::batch_server(const basic_model_handle<Scalar>& in_model, const serve_options& in_options)
+    : model { in_model }
+    , options { in_options }
+    , input_size { in_model.get()->topology.front() }
+    , output_size { in_model.get()->topology.back() } {
+	options.max_batch_size = std::max<u64>(options.max_batch_size, 1);
+
+	batch_pixels.resize(static_cast<Eigen::Index>(options.max_batch_size), static_cast<Eigen::Index>(input_size));
+	queued.reserve(options.max_batch_size);
+
+	signal_fd = stop_signal_fd();
+	listen_fd = listen_on(options.socket_path);
+	timer_fd = check(timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC), "create a timerfd");
+	epoll_fd = check(epoll_create1(EPOLL_CLOEXEC), "create an epoll instance");
+
+	for (int fd : { listen_fd, signal_fd, timer_fd }) {
+		epoll_event event { .events = EPOLLIN, .data = { .fd = fd } };
+		check(epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event), "watch a file descriptor");
+	}
+}
+
+template<typename Scalar>
+batch_server<Scalar>::~batch_server() {
+	for (const auto& [fd, client] : connections) {
+		close(fd);
+	}
+
+	for (int fd : { epoll_fd, timer_fd, listen_fd, signal_fd }) {
+		close(fd);
+	}
+
+	unlink(options.socket_path.c_str());
+}
+
+template<typename Scalar>
+auto batch_server<Scalar>::run() -> void {
+	std::array<epoll_event, 64> events {};
+	bool stopping { false };
+
+	while (!stopping) {
+		int event_count { epoll_wait(epoll_fd, events.data(), static_cast<int>(events.size()), -1) };
+		if (event_count == -1 && errno == EINTR) {
+			continue;
+		}
+		check(event_count, "wait for events");
+
+		for (const auto& event : std::span { events.data(), static_cast<std::size_t>(event_count) }) {
+			int fd { event.data.fd };
+
+			if (fd == listen_fd) {
+				accept_connections();
+			} else if (fd == signal_fd) {
+				stopping = true;
+			} else if (fd == timer_fd) {
+				u64 expirations { 0 };
+				if (read(timer_fd, &expirations, sizeof expirations) == sizeof expirations) {
+					run_batch();
+				}
+			} else if (auto it { connections.find(fd) }; it != connections.end() && !it->second.closing) {
+				auto& client { it->second };
+
+				if ((event.events & (EPOLLERR | EPOLLHUP)) != 0) {
+					close_later(client);
+					continue;
+				}
+
+				if ((event.events & EPOLLOUT) != 0) {
+					send_output(client);
+				}
+
+				if ((event.events & EPOLLIN) != 0 && !client.closing) {
+					read_requests(client);
+				}
+			}
+		}
+
+		// A connection closing can leave every other one queued
+		if (options.max_batch_delay.count() == 0 || every_connection_queued()) {
+			run_batch();
+		}
+
+		close_connections();
+	}
+
+	// Requests already read still get their answers
+	run_batch();
+	close_connections();
+
+	fmt::print("Answered {} requests in {} batches, {:.1f} per batch on average and {} at most\n", answered,
+	           batch_count, batch_count == 0 ? 0.0 : static_cast<double>(answered) / batch_count, largest_batch);
+}
+
+template<typename Scalar>
+auto batch_server<Scalar>::accept_connections() -> void {
+	while (true) {
+		int fd { accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC) };
+		if (fd == -1) {
+			if (errno == EINTR || errno == ECONNABORTED) {
+				continue;
+			}
+
+			if (!would_block()) {
+				fmt::print("Failed to accept a connection: {}\n", std::strerror(errno));
+			}
+
+			return;
+		}
+
+		auto& client { connections.insert_or_assign(fd, connection { .fd = fd, .id = next_connection_id++ })
+			               .first->second };
+
+		epoll_event event { .events = EPOLLIN, .data = { .fd = fd } };
+		check(epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event), "watch a connection");
+		client.events = EPOLLIN;
+
+		serve_hello hello {
+			.magic_number = serve_magic_number,
+			.version = serve_protocol_version,
+			.input_size = static_cast<u32>(input_size),
+			.output_size = static_cast<u32>(output_size),
+		};
+
+		const auto* hello_bytes { reinterpret_cast<const u8*>(&hello) };
+		client.output.assign(hello_bytes, hello_bytes + sizeof hello);
+		send_output(client);
+	}
+}
+
+template<typename Scalar>
+auto batch_server<Scalar>::read_requests(connection& client) -> void {
+	std::array<u8, read_buffer_size> buffer;
+
+	auto read_size { recv(client.fd, buffer.data(), buffer.size(), 0) };
+	if (read_size == -1 && (errno == EINTR || would_block())) {
+		return;
+	}
+
+	if (read_size <= 0) {
+		close_later(client);
+		return;
+	}
+
+	std::span<const u8> received { buffer.data(), static_cast<std::size_t>(read_size) };
+
+	// Finish the request the last read ended partway through first
+	if (!client.input.empty()) {
+		auto missing { std::min(input_size - client.input.size(), received.size()) };
+		client.input.insert(client.input.end(), received.begin(),
+		                    received.begin() + static_cast<std::ptrdiff_t>(missing));
+		received = received.subspan(missing);
+
+		if (client.input.size() < input_size) {
+			return;
+		}
+
+		queue_request(client, client.input);
+		client.input.clear();
+	}
+
+	while (received.size() >= input_size) {
+		queue_request(client, received.first(input_size));
+		received = received.subspan(input_size);
+	}
+
+	client.input.assign(received.begin(), received.end());
+}
+
+template<typename Scalar>
+auto batch_server<Scalar>::queue_request(connection& client, std::span<const u8> pixels) -> void {
+	std::copy(pixels.begin(), pixels.end(), batch_pixels.row(static_cast<Eigen::Index>(queued.size())).data());
+	queued.push_back({ client.fd, client.id });
+
+	if (client.last_batch != batch_count) {
+		client.last_batch = batch_count;
+		queued_connections += 1;
+	}
+
+	// The oldest request in a batch decides when it runs
+	if (queued.size() == 1 && options.max_batch_delay.count() != 0) {
+		set_batch_timer(options.max_batch_delay);
+	}
+
+	if (queued.size() == options.max_batch_size || every_connection_queued()) {
+		run_batch();
+	}
+}
+
+template<typename Scalar>
+auto batch_server<Scalar>::every_connection_queued() const -> bool {
+	return !queued.empty() && queued_connections == connections.size() - closing_fds.size();
+}
+
+template<typename Scalar>
+auto batch_server<Scalar>::run_batch() -> void {
+	if (queued.empty()) {
+		return;
+	}
+
+	set_batch_timer(std::chrono::microseconds { 0 });
+
+	TRACE_ZONE("serve_batch", "size", static_cast<i64>(queued.size()));
+
+	auto net { model.get() };
+	auto rows { static_cast<Eigen::Index>(queued.size()) };
+	auto answers { net->predict_batch(batch_pixels.topRows(rows), workspace) };
+
+	std::vector<int> answered_fds {};
+	for (Eigen::Index row { 0 }; row < rows; ++row) {
+		const auto& request { queued[static_cast<std::size_t>(row)] };
+
+		auto it { connections.find(request.fd) };
+		if (it == connections.end() || it->second.id != request.connection_id || it->second.closing) {
+			continue;
+		}
+
+		auto& output { it->second.output };
+		for (Eigen::Index column { 0 }; column < answers.cols(); ++column) {
+			float value { static_cast<float>(answers(row, column)) };
+
+			const auto* value_bytes { reinterpret_cast<const u8*>(&value) };
+			output.insert(output.end(), value_bytes, value_bytes + sizeof value);
+		}
+
+		answered_fds.push_back(request.fd);
+	}
+
+	answered += queued.size();
+	batch_count += 1;
+	largest_batch = std::max<u64>(largest_batch, queued.size());
+	queued.clear();
+	queued_connections = 0;
+
+	std::sort(answered_fds.begin(), answered_fds.end());
+	answered_fds.erase(std::unique(answered_fds.begin(), answered_fds.end()), answered_fds.end());
+
+	for (int fd : answered_fds) {
+		send_output(connections.at(fd));
+	}
+}
+
+template<typename Scalar>
+auto batch_server<Scalar>::send_output(connection& client) -> void {
+	while (client.pending_output() > 0) {
+		auto sent { send(client.fd, client.output.data() + client.output_sent, client.pending_output(), MSG_NOSIGNAL) };
+		if (sent == -1 && errno == EINTR) {
+			continue;
+		}
+
+		if (sent == -1 && would_block()) {
+			break;
+		}
+
+		if (sent == -1) {
+			close_later(client);
+			return;
+		}
+
+		client.output_sent += static_cast<std::size_t>(sent);
+	}
+
+	// Keeps output from growing while a slow client never quite catches up
+	if (client.pending_output() == 0 || client.output_sent >= serve_max_pending_output) {
+		client.output.erase(client.output.begin(),
+		                    client.output.begin() + static_cast<std::ptrdiff_t>(client.output_sent));
+		client.output_sent = 0;
+	}
+
+	update_events(client);
+}
+
+template<typename Scalar>
+auto batch_server<Scalar>::update_events(connection& client) -> void {
+	u32 events { 0 };
+	if (client.pending_output() < serve_max_pending_output) {
+		events |= EPOLLIN;
+	}
+	if (client.pending_output() > 0) {
+		events |= EPOLLOUT;
+	}
+
+	if (events != client.events) {
+		epoll_event event { .events = events, .data = { .fd = client.fd } };
+		check(epoll_ctl(epoll_fd, EPOLL_CTL_MOD, client.fd, &event), "watch a connection");
+		client.events = events;
+	}
+}
+
+template<typename Scalar>
+auto batch_server<Scalar>::close_later(connection& client) -> void {
+	if (!client.closing) {
+		client.closing = true;
+		closing_fds.push_back(client.fd);
+
+		if (client.last_batch == batch_count) {
+			queued_connections -= 1;
+		}
+	}
+}
+
+template<typename Scalar>
+auto batch_server<Scalar>::close_connections() -> void {
+	for (int fd : closing_fds) {
+		close(fd);
+		connections.erase(fd);
+	}
+
+	closing_fds.clear();
+}
+
+template<typename Scalar>
+auto batch_server<Scalar>::set_batch_timer(std::chrono::microseconds delay) -> void {
+	// A zero delay disarms the timer, which also drops expirations not read yet
+	itimerspec timer {};
+	timer.it_value.tv_sec = static_cast<time_t>(delay.count() / 1'000'000);
+	timer.it_value.tv_nsec = static_cast<long>(delay.count() % 1'000'000 * 1000);
+
+	check(timerfd_settime(timer_fd, 0, &timer, nullptr), "set the batch timer");
+}
+
+template<typename Scalar>
+auto serve_nn(const basic_model_handle<Scalar>& model, const serve_options& options) -> void {
+	batch_server<Scalar> server { model, options };
+
+	fmt::print("Serving on \"{}\", batches of up to {} requests that wait up to {}us, SIGINT or SIGTERM stops\n",
+	           options.socket_path, std::max<u64>(options.max_batch_size, 1), options.max_batch_delay.count());
+
+	server.run();
+}
+
+template auto serve_nn(const model_handle& model, const serve_options& options) -> void;
+template auto serve_nn(const model_handle_f32& model, const serve_options& options) -> void;
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+
+#include "model_handle.hpp"
+#include "short_types.hpp"
+
+struct serve_options {
+	std::string socket_path;
+
+	// Requests predicted together in one predict_batch at most
+	u64 max_batch_size;
+
+	// Longest a request waits for others to join its batch. With 0 a batch is
+	// whatever arrived in one pass of the event loop
+	std::chrono::microseconds max_batch_delay;
+};
+
+// Answers prediction requests of local processes over a Unix socket, see
+// serve_protocol.hpp, until SIGINT or SIGTERM. One thread runs an epoll
+// event loop and gathers requests from every connection into batches. Every
+// batch uses the latest version of the network the model has loaded
+template<typename Scalar>
+auto serve_nn(const basic_model_handle<Scalar>& model, const serve_options& options) -> void;
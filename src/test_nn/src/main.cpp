@@ -1,5 +1,6 @@
 #include <cstdlib>
 #include <filesystem>
+#include <optional>
 #include <string>
 
 #include <cxxopts.hpp>
@@ -7,8 +8,10 @@
 
 #include "network.hpp"
 #include "network_from_file.hpp"
+#include "quantized_network_file.hpp"
 #include "short_types.hpp"
 #include "test_nn.hpp"
+#include "trace.hpp"
 
 auto main(i32 argc, char* argv[]) -> i32 {
 	cxxopts::Options opts {
@@ -18,7 +21,11 @@ auto main(i32 argc, char* argv[]) -> i32 {
 
 	opts.add_options()
 		("d,data-dir", "Path to mnist data directory", cxxopts::value<std::string>()->default_value("data"))
-		("i,input", "Path to network binary", cxxopts::value<std::string>()->default_value("neural_network.nn"));
+		("i,input", "Path to network binary", cxxopts::value<std::string>()->default_value("neural_network.nn"))
+		("t,threads", "Number of threads to use", cxxopts::value<u64>()->default_value("0"))
+		("m,mistakes", "Path to write the misclassified digits to, for check_nn to step through", cxxopts::value<std::string>())
+		("r,reference", "Network a quantized network was made from, to compare against", cxxopts::value<std::string>())
+		("trace", "Path to write a Chrome trace event file of the run to, needs a build with NN_TRACING", cxxopts::value<std::string>());
 
 	opts.parse_positional("input");
 
@@ -40,8 +47,46 @@ auto main(i32 argc, char* argv[]) -> i32 {
 		std::exit(1);
 	}
 
-	network neural_net { 28 * 28, 16, 16, 10 };
-	load_network_from_file(neural_net, network_filepath);
+	if (!is_quantized_network_file(network_filepath) && !verify_network_file(network_filepath)) {
+		fmt::print("Network file \"{}\" is corrupt, its checksum doesn't match\n", network_filepath);
+		std::exit(1);
+	}
+
+	std::optional<std::string> mistakes_filepath {};
+	if (results.count("mistakes") != 0) {
+		mistakes_filepath = results["mistakes"].as<std::string>();
+	}
+
+	std::optional<trace_session> trace {};
+	if (results.count("trace") != 0) {
+		trace.emplace(results["trace"].as<std::string>());
+	}
 
-	test_nn(neural_net, data_dir);
+	// Test in the precision the network was saved in
+	if (is_quantized_network_file(network_filepath)) {
+		if (mistakes_filepath) {
+			fmt::print("Not writing misclassified digits, quantized networks are only compared for accuracy\n");
+		}
+
+		quantized_network neural_net {};
+		load_quantized_network_from_file(neural_net, network_filepath);
+
+		std::optional<network> reference {};
+		if (results.count("reference") != 0) {
+			reference.emplace();
+			load_network_from_file(*reference, results["reference"].as<std::string>());
+		}
+
+		test_quantized_nn(neural_net, reference ? &*reference : nullptr, data_dir, results["threads"].as<u64>());
+	} else if (network_file_scalar_size(network_filepath) == sizeof(float)) {
+		network_f32 neural_net {};
+		load_network_from_file(neural_net, network_filepath);
+
+		test_nn(neural_net, data_dir, results["threads"].as<u64>(), mistakes_filepath);
+	} else {
+		network neural_net {};
+		load_network_from_file(neural_net, network_filepath);
+
+		test_nn(neural_net, data_dir, results["threads"].as<u64>(), mistakes_filepath);
+	}
 }
@@ -1,46 +1,167 @@
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <span>
+#include <string_view>
+
 #include <fmt/format.h>
 
-#include "load_mnist_digits.hpp"
+#include "accuracy_of_neural_net.hpp"
+#include "check_network_fits_dataset.hpp"
+#include "evaluation_report.hpp"
+#include "mistakes_file.hpp"
+#include "mnist_dataset.hpp"
 #include "test_nn.hpp"
+#include "thread_pool.hpp"
+
+static auto print_evaluation_report(std::string_view split_name, const evaluation_report& report) -> void {
+	fmt::print("\n{} confusion matrix, a row per label and a column per predicted digit:\n", split_name);
+
+	fmt::print("     ");
+	for (std::size_t predicted { 0 }; predicted < evaluated_digit_count; ++predicted) {
+		fmt::print(" {:6d}", predicted);
+	}
+	fmt::print("\n");
+
+	for (std::size_t label { 0 }; label < evaluated_digit_count; ++label) {
+		fmt::print("{:5d}", label);
+		for (auto count : report.confusion[label]) {
+			fmt::print(" {:6d}", count);
+		}
+		fmt::print("\n");
+	}
+
+	fmt::print("\nDigit | Precision | Recall\n");
+	for (std::size_t digit { 0 }; digit < evaluated_digit_count; ++digit) {
+		fmt::print("{:5d} | {:8.2f}% | {:5.2f}%\n", digit, report.precision(digit) * 100.0,
+		           report.recall(digit) * 100.0);
+	}
+
+	fmt::print("\nTop-k accuracy:");
+	for (std::size_t k { 1 }; k <= max_top_k; ++k) {
+		fmt::print(" {} {:.2f}%{}", k, report.top_k_accuracy(k) * 100.0, k < max_top_k ? " |" : "\n");
+	}
+
+	fmt::print("\nConfidence | Correct |  Wrong\n");
+	for (std::size_t bin { 0 }; bin < confidence_bin_count; ++bin) {
+		fmt::print("{:.2f}-{:.2f} | {:7d} | {:6d}\n", static_cast<double>(bin) / confidence_bin_count,
+		           static_cast<double>(bin + 1) / confidence_bin_count, report.confident_correct[bin],
+		           report.confident_wrong[bin]);
+	}
+}
+
+template<typename Scalar>
+auto test_nn(const basic_network<Scalar>& net, const std::string& data_dir, u64 thread_count,
+             const std::optional<std::string>& mistakes_filepath) -> void {
+	thread_pool pool { thread_count };
+
+	mnist_dataset training_digits { data_dir + "/mnist_training_images", data_dir + "/mnist_training_labels" };
+	mnist_dataset testing_digits { data_dir + "/mnist_testing_images", data_dir + "/mnist_testing_labels" };
+	check_network_fits_dataset(net, training_digits);
+	check_network_fits_dataset(net, testing_digits);
+
+	// Both splits are evaluated in the same pass
+	std::array<std::string_view, 2> split_names { "training", "testing" };
+	std::array<const mnist_dataset*, 2> datasets { &training_digits, &testing_digits };
 
-auto test_nn(const network& net, const std::string& data_dir) -> void {
 	fmt::print("Starting network test\n");
-	{
-		auto training_digits = digits_from_path(data_dir + "/mnist_training_images", data_dir + "/mnist_training_labels");
+	auto reports { evaluate_neural_net(net, datasets, pool) };
 
-		u32 total_correct_training { 0 };
-		for (const auto& d : training_digits) {
-			auto prediction = net.get_prediction(d.pixels);
+	fmt::print("Training: {:6d} / {:6d} correct | {:.2f}%\n", reports[0].correct(), reports[0].sample_count,
+	           reports[0].accuracy() * 100.0);
+	fmt::print("Testing:  {:6d} / {:6d} correct | {:.2f}%\n", reports[1].correct(), reports[1].sample_count,
+	           reports[1].accuracy() * 100.0);
 
-			size_t predicted_digit = std::distance(
-			    prediction.data(), std::max_element(prediction.data(), prediction.data() + prediction.size()));
+	print_evaluation_report("Training", reports[0]);
+	print_evaluation_report("Testing", reports[1]);
 
-			if (predicted_digit == d.label) {
-				total_correct_training += 1;
-			}
-		}
+	if (mistakes_filepath) {
+		save_mistakes_file(*mistakes_filepath, split_names, reports);
+		fmt::print("\nWrote the {} misclassified digits to \"{}\"\n",
+		           reports[0].misclassified.size() + reports[1].misclassified.size(), *mistakes_filepath);
+	}
+}
+
+template auto test_nn(const network& net, const std::string& data_dir, u64 thread_count,
+                      const std::optional<std::string>& mistakes_filepath) -> void;
+template auto test_nn(const network_f32& net, const std::string& data_dir, u64 thread_count,
+                      const std::optional<std::string>& mistakes_filepath) -> void;
+
+template<typename Predict>
+auto correct_predictions(const mnist_dataset& digits, thread_pool& pool, Predict predict) -> size_t {
+	return pool.parallel_reduce(
+	    digits.size(), prediction_batch_size, size_t { 0 },
+	    [&](size_t first, size_t last) {
+		    size_t total_correct { 0 };
+		    for (size_t i { first }; i < last; ++i) {
+			    if (predicted_digit(predict(digits.sample(i))) == digits.label(i)) {
+				    total_correct += 1;
+			    }
+		    }
+
+		    return total_correct;
+	    },
+	    std::plus {});
+}
+
+// Single threaded samples per second of predict over every digit
+template<typename Predict>
+auto prediction_throughput(const mnist_dataset& digits, Predict predict) -> double {
+	float checksum { 0.0f };
 
-		fmt::print("Training: {:6d} / {:6d} correct | {:.2f}%\n", total_correct_training, training_digits.size(),
-		           static_cast<double>(total_correct_training) / training_digits.size() * 100.0);
+	auto start_time { std::chrono::steady_clock::now() };
+	for (const auto& [pixels, label] : digits) {
+		checksum += static_cast<float>(predict(pixels)[label]);
 	}
+	std::chrono::duration<double> elapsed { std::chrono::steady_clock::now() - start_time };
 
+	// Keep the predictions from being optimized away
+	if (std::isnan(checksum)) {
+		fmt::print("NaN in predictions\n");
+	}
 
-	{
-		auto testing_digits = digits_from_path(data_dir + "/mnist_testing_images", data_dir + "/mnist_testing_labels");
+	return static_cast<double>(digits.size()) / elapsed.count();
+}
 
-		u32 total_correct_testing { 0 };
-		for (const auto& digit : testing_digits) {
-			auto prediction = net.get_prediction(digit.pixels);
+auto test_quantized_nn(const quantized_network& net, const network* reference, const std::string& data_dir,
+                       u64 thread_count) -> void {
+	thread_pool pool { thread_count };
 
-			size_t predicted_digit = std::distance(
-			    prediction.data(), std::max_element(prediction.data(), prediction.data() + prediction.size()));
+	auto predict_quantized = [&](std::span<const u8> pixels) { return net.get_prediction(pixels); };
+	auto predict_reference = [&](std::span<const u8> pixels) { return reference->get_prediction(pixels); };
 
-			if (predicted_digit == digit.label) {
-				total_correct_testing += 1;
-			}
+	auto print_accuracy = [&](const char* name, const mnist_dataset& digits) {
+		auto total_correct { correct_predictions(digits, pool, predict_quantized) };
+		auto accuracy { static_cast<double>(total_correct) / digits.size() * 100.0 };
+
+		fmt::print("{} {:6d} / {:6d} correct | {:.2f}%", name, total_correct, digits.size(), accuracy);
+
+		if (reference != nullptr) {
+			auto reference_correct { correct_predictions(digits, pool, predict_reference) };
+			auto reference_accuracy { static_cast<double>(reference_correct) / digits.size() * 100.0 };
+
+			fmt::print(" | {:+.2f}% against reference", accuracy - reference_accuracy);
 		}
 
-		fmt::print("Testing:  {:6d} / {:6d} correct | {:.2f}%\n", total_correct_testing, testing_digits.size(),
-		           static_cast<double>(total_correct_testing) / testing_digits.size() * 100.0);
+		fmt::print("\n");
+	};
+
+	fmt::print("Starting quantized network test\n");
+	{
+		mnist_dataset training_digits { data_dir + "/mnist_training_images", data_dir + "/mnist_training_labels" };
+		print_accuracy("Training:", training_digits);
+	}
+
+	mnist_dataset testing_digits { data_dir + "/mnist_testing_images", data_dir + "/mnist_testing_labels" };
+	print_accuracy("Testing: ", testing_digits);
+
+	auto quantized_throughput { prediction_throughput(testing_digits, predict_quantized) };
+	fmt::print("Quantized get_prediction: {:.0f} samples/s\n", quantized_throughput);
+
+	if (reference != nullptr) {
+		auto reference_throughput { prediction_throughput(testing_digits, predict_reference) };
+		fmt::print("Reference get_prediction: {:.0f} samples/s | {:.2f}x speedup\n", reference_throughput,
+		           quantized_throughput / reference_throughput);
 	}
 }
@@ -1,7 +1,18 @@
 #pragma once
 
+#include <optional>
 #include <string>
 
 #include "network.hpp"
+#include "quantized_network.hpp"
+#include "short_types.hpp"
 
-auto test_nn(const network& net, const std::string& data_dir) -> void;
+// Evaluates both splits in one pass and prints a report of each, see
+// evaluation_report. The misclassified digits are written to mistakes_filepath if there is one
+template<typename Scalar>
+auto test_nn(const basic_network<Scalar>& net, const std::string& data_dir, u64 thread_count,
+             const std::optional<std::string>& mistakes_filepath) -> void;
+
+// Compares accuracy and single threaded throughput against reference when it isn't null
+auto test_quantized_nn(const quantized_network& net, const network* reference, const std::string& data_dir,
+                       u64 thread_count) -> void;
@@ -0,0 +1,103 @@
+#include <algorithm>
+#include <memory>
+
+#include "best_network.hpp"
+
+static_assert(std::atomic<void*>::is_always_lock_free && std::atomic<u64>::is_always_lock_free,
+              "best_network needs lock free atomic pointers and counters");
+
+template<typename Scalar>
+best_network<Scalar>::best_network(const basic_network<Scalar>& neural_net, double average_cost,
+                                   std::size_t reader_count)
+    : best { new node { std::make_shared<snapshot>(neural_net, average_cost, 0) } }
+    , readers(reader_count) {
+}
+
+template<typename Scalar>
+best_network<Scalar>::~best_network() {
+	delete best.load();
+}
+
+// The announcement is ordered before loading the pointer, so a publisher
+// that doesn't see it has already swapped in a pointer this reader will load
+template<typename Scalar>
+auto best_network<Scalar>::enter(reader_slot& slot) -> void {
+	slot.reclamation_epoch.store(reclamation_epoch.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+}
+
+template<typename Scalar>
+auto best_network<Scalar>::leave(reader_slot& slot) -> void {
+	slot.reclamation_epoch.store(idle_epoch, std::memory_order_release);
+}
+
+template<typename Scalar>
+auto best_network<Scalar>::free_retired(reader_slot& slot) -> void {
+	if (slot.retired.empty()) {
+		return;
+	}
+
+	u64 oldest_epoch { idle_epoch };
+	for (const auto& reader : readers) {
+		oldest_epoch = std::min(oldest_epoch, reader.reclamation_epoch.load(std::memory_order_seq_cst));
+	}
+
+	std::erase_if(slot.retired, [&](const auto& retired) { return retired.reclamation_epoch <= oldest_epoch; });
+}
+
+template<typename Scalar>
+auto best_network<Scalar>::current(std::size_t reader) -> std::shared_ptr<const snapshot> {
+	auto& slot { readers[reader] };
+
+	enter(slot);
+	auto latest { best.load(std::memory_order_seq_cst)->value };
+	leave(slot);
+
+	free_retired(slot);
+
+	return latest;
+}
+
+template<typename Scalar>
+auto best_network<Scalar>::publish(std::size_t reader, const basic_network<Scalar>& neural_net, double average_cost)
+    -> std::shared_ptr<const snapshot> {
+	auto& slot { readers[reader] };
+
+	enter(slot);
+
+	node* replaced { best.load(std::memory_order_seq_cst) };
+	if (average_cost >= replaced->value->average_cost) {
+		leave(slot);
+		return nullptr;
+	}
+
+	// The copy is made before swapping, so the swap itself is all writers contend on
+	auto candidate { std::make_shared<snapshot>(neural_net, average_cost, replaced->value->epoch + 1) };
+	auto candidate_node { std::make_unique<node>(candidate) };
+
+	while (!best.compare_exchange_weak(replaced, candidate_node.get(), std::memory_order_seq_cst)) {
+		if (average_cost >= replaced->value->average_cost) {
+			leave(slot);
+			return nullptr;
+		}
+
+		candidate->epoch = replaced->value->epoch + 1;
+	}
+
+	candidate_node.release();
+	leave(slot);
+
+	// Winning the swap makes this reader the only one to retire the node.
+	// Readers entering from the new epoch on can only load the candidate
+	auto replaced_value { replaced->value };
+	slot.retired.push_back({
+	    .replaced = std::unique_ptr<node> { replaced },
+	    .reclamation_epoch = reclamation_epoch.fetch_add(1, std::memory_order_seq_cst) + 1,
+	});
+
+	free_retired(slot);
+
+	return replaced_value;
+}
+
+template class best_network<double>;
+template class best_network<float>;
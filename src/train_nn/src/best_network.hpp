@@ -0,0 +1,78 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "network.hpp"
+#include "short_types.hpp"
+
+// Lowest cost network found so far, shared between training threads without
+// locks. The current snapshot is behind an atomic pointer. Readers announce
+// the reclamation epoch they read it in and take a reference to it, which is
+// wait free. Publishing copies the network and swaps the new snapshot in with
+// a compare and swap if it's still an improvement. The publisher frees the
+// replaced pointer once every reader that could still be reading it has left.
+//
+// Every thread calling current or publish at the same time uses a reader of
+// its own, numbered from 0 to reader_count - 1
+template<typename Scalar>
+class best_network {
+public:
+	struct snapshot {
+		basic_network<Scalar> neural_net;
+		double average_cost;
+
+		// Counts up with every published network
+		u64 epoch;
+	};
+
+	best_network(const basic_network<Scalar>& neural_net, double average_cost, std::size_t reader_count);
+	~best_network();
+
+	best_network(const best_network&) = delete;
+	auto operator=(const best_network&) -> best_network& = delete;
+
+	auto current(std::size_t reader) -> std::shared_ptr<const snapshot>;
+
+	// Publishes neural_net if it costs less than the current best, returns the
+	// snapshot it replaced or nullptr if it wasn't an improvement
+	auto publish(std::size_t reader, const basic_network<Scalar>& neural_net, double average_cost)
+	    -> std::shared_ptr<const snapshot>;
+
+private:
+	// What the atomic pointer points to, snapshots outlive it for as long as they're held
+	struct node {
+		std::shared_ptr<const snapshot> value;
+	};
+
+	struct retired_node {
+		std::unique_ptr<node> replaced;
+
+		// Readers that announced an epoch before this one may still read it
+		u64 reclamation_epoch;
+	};
+
+	static constexpr u64 idle_epoch { std::numeric_limits<u64>::max() };
+
+	// Padded to a cache line so readers don't slow each other down
+	struct alignas(64) reader_slot {
+		std::atomic<u64> reclamation_epoch { idle_epoch };
+
+		// Nodes this reader replaced, only it touches them
+		std::vector<retired_node> retired {};
+	};
+
+	auto enter(reader_slot& slot) -> void;
+	auto leave(reader_slot& slot) -> void;
+	auto free_retired(reader_slot& slot) -> void;
+
+	std::atomic<node*> best;
+	std::atomic<u64> reclamation_epoch { 0 };
+	std::vector<reader_slot> readers;
+};
+
+extern template class best_network<double>;
+extern template class best_network<float>;
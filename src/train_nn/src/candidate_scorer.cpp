@@ -0,0 +1,67 @@
+#include <chrono>
+#include <optional>
+
+#include <fmt/format.h>
+
+#include "average_cost_of_neural_net.hpp"
+#include "candidate_scorer.hpp"
+
+candidate_scorer::candidate_scorer(const mnist_dataset& in_digits, std::mt19937& rand_gen,
+                                   const std::optional<racing_options>& racing)
+    : digits { in_digits } {
+	if (racing) {
+		evaluator.emplace(digits, rand_gen, *racing);
+	}
+}
+
+template<typename Scalar>
+auto candidate_scorer::score(const basic_network<Scalar>& neural_net, double threshold_cost,
+                             thread_telemetry& metrics) -> std::optional<double> {
+	candidates.fetch_add(1, std::memory_order_relaxed);
+	metrics.record_candidate();
+
+	auto start { std::chrono::steady_clock::now() };
+
+	if (!evaluator) {
+		auto average_cost { average_cost_of_neural_net(neural_net, digits) };
+
+		digits_scored.fetch_add(digits.size(), std::memory_order_relaxed);
+		metrics.record_compute(digits.size(), std::chrono::steady_clock::now() - start);
+
+		return average_cost;
+	}
+
+	auto result { evaluator->evaluate(neural_net, threshold_cost) };
+	digits_scored.fetch_add(result.digits_scored, std::memory_order_relaxed);
+	metrics.record_compute(result.digits_scored, std::chrono::steady_clock::now() - start);
+
+	if (!result.average_cost) {
+		rejected.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	return result.average_cost;
+}
+
+auto candidate_scorer::candidates_scored() const -> u64 {
+	return candidates.load();
+}
+
+auto candidate_scorer::print_summary(std::chrono::steady_clock::duration elapsed) const -> void {
+	auto seconds { std::chrono::duration<double> { elapsed }.count() };
+	auto candidate_count { static_cast<double>(candidates.load()) };
+
+	fmt::print("Evaluated {} candidates in {:.1f}s | {:.2f} candidates/s", candidates.load(), seconds,
+	           candidate_count / seconds);
+
+	if (evaluator && candidates.load() != 0) {
+		fmt::print(" | {} rejected early | {:.0f} digits scored per candidate", rejected.load(),
+		           static_cast<double>(digits_scored.load()) / candidate_count);
+	}
+
+	fmt::print("\n");
+}
+
+template auto candidate_scorer::score(const network& neural_net, double threshold_cost, thread_telemetry& metrics)
+    -> std::optional<double>;
+template auto candidate_scorer::score(const network_f32& neural_net, double threshold_cost,
+                                      thread_telemetry& metrics) -> std::optional<double>;
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <optional>
+#include <random>
+
+#include "mnist_dataset.hpp"
+#include "network.hpp"
+#include "racing_cost_of_neural_net.hpp"
+#include "short_types.hpp"
+#include "telemetry.hpp"
+
+// Scores the candidates of the nudging trainers, either over every digit or
+// raced against the cost they have to beat. Safe to share between threads,
+// it counts what it scored so the two can be compared
+class candidate_scorer {
+public:
+	candidate_scorer(const mnist_dataset& in_digits, std::mt19937& rand_gen,
+	                 const std::optional<racing_options>& racing);
+
+	// Cost of neural_net, nullopt when racing showed it won't get below threshold_cost.
+	// Counts the candidate and the time scoring it took in metrics
+	template<typename Scalar>
+	auto score(const basic_network<Scalar>& neural_net, double threshold_cost, thread_telemetry& metrics)
+	    -> std::optional<double>;
+
+	auto print_summary(std::chrono::steady_clock::duration elapsed) const -> void;
+
+	auto candidates_scored() const -> u64;
+
+private:
+	const mnist_dataset& digits;
+	std::optional<racing_evaluator> evaluator;
+
+	std::atomic<u64> candidates { 0 };
+	std::atomic<u64> rejected { 0 };
+	std::atomic<u64> digits_scored { 0 };
+};
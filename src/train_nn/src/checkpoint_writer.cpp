@@ -0,0 +1,134 @@
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <system_error>
+#include <utility>
+
+#include <fmt/format.h>
+
+#include "checkpoint_writer.hpp"
+#include "network_to_file.hpp"
+#include "training_state.hpp"
+
+template<typename Scalar>
+checkpoint_writer<Scalar>::checkpoint_writer(std::string in_filepath, const checkpoint_options& in_options,
+                                             telemetry& in_metrics)
+    : filepath { std::move(in_filepath) }
+    , options { in_options }
+    , metrics { in_metrics }
+    , writer { [this] { run(); } } {
+}
+
+template<typename Scalar>
+checkpoint_writer<Scalar>::~checkpoint_writer() {
+	{
+		std::lock_guard lock { pending_mutex };
+		stopping = true;
+	}
+
+	pending_changed.notify_one();
+	writer.join();
+}
+
+template<typename Scalar>
+auto checkpoint_writer<Scalar>::submit(std::shared_ptr<const basic_network<Scalar>> neural_net,
+                                       std::optional<double> average_cost, std::optional<training_state> state)
+    -> void {
+	{
+		auto start { std::chrono::steady_clock::now() };
+		std::lock_guard lock { pending_mutex };
+		metrics.record_checkpoint_wait(std::chrono::steady_clock::now() - start);
+
+		pending = checkpoint { std::move(neural_net), average_cost, std::move(state) };
+	}
+
+	pending_changed.notify_one();
+}
+
+template<typename Scalar>
+auto checkpoint_writer<Scalar>::submit(const basic_network<Scalar>& neural_net, std::optional<double> average_cost,
+                                       std::optional<training_state> state) -> void {
+	submit(std::make_shared<const basic_network<Scalar>>(neural_net), average_cost, std::move(state));
+}
+
+template<typename Scalar>
+auto checkpoint_writer<Scalar>::run() -> void {
+	using clock = std::chrono::steady_clock;
+
+	auto interval { std::chrono::duration_cast<clock::duration>(options.min_interval) };
+	std::optional<clock::time_point> last_write {};
+
+	std::unique_lock lock { pending_mutex };
+	while (true) {
+		pending_changed.wait(lock, [&] { return pending || stopping; });
+
+		if (!pending) {
+			return;
+		}
+
+		// Submits while waiting out the interval replace pending, the wait
+		// ends early only when stopping so the last one still gets written
+		if (last_write) {
+			pending_changed.wait_until(lock, *last_write + interval, [&] { return stopping; });
+		}
+
+		auto latest { std::move(*pending) };
+		pending.reset();
+
+		lock.unlock();
+		auto write_start { clock::now() };
+		write(latest);
+		last_write = clock::now();
+		metrics.record_checkpoint(*last_write - write_start);
+		lock.lock();
+	}
+}
+
+template<typename Scalar>
+auto checkpoint_writer<Scalar>::write(const checkpoint& latest) -> void {
+	if (options.snapshot_count != 0 && std::filesystem::exists(filepath)) {
+		rotate_snapshots();
+	}
+
+	save_network_to_file(*latest.neural_net, filepath, latest.average_cost);
+
+	auto state_filepath { training_state_path(filepath) };
+	if (latest.state) {
+		auto state { *latest.state };
+		state.parameter_checksum = training_state_checksum(*latest.neural_net);
+
+		save_training_state(state, state_filepath);
+	} else {
+		std::error_code error {};
+		std::filesystem::remove(state_filepath, error);
+	}
+}
+
+template<typename Scalar>
+auto checkpoint_writer<Scalar>::rotate_snapshots() -> void {
+	auto snapshot_path = [&](u64 index) {
+		return fmt::format("{}.{}", filepath, index);
+	};
+
+	std::error_code error {};
+	std::filesystem::remove(snapshot_path(options.snapshot_count), error);
+
+	for (u64 index { options.snapshot_count - 1 }; index >= 1; --index) {
+		if (std::filesystem::exists(snapshot_path(index))) {
+			std::filesystem::rename(snapshot_path(index), snapshot_path(index + 1), error);
+		}
+	}
+
+	// A hard link keeps the network file in place, anyone opening it between
+	// here and the rename in save_network_to_file still finds a network
+	std::filesystem::create_hard_link(filepath, snapshot_path(1), error);
+	if (error) {
+		fmt::print("Failed to keep snapshot {} of {}: {}\n", snapshot_path(1), filepath, error.message());
+	}
+}
+
+template class checkpoint_writer<double>;
+template class checkpoint_writer<float>;
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+
+#include "network.hpp"
+#include "short_types.hpp"
+#include "telemetry.hpp"
+#include "training_state.hpp"
+
+struct checkpoint_options {
+	// Least time between two writes, improvements in between are coalesced
+	// and only the latest of them gets written
+	std::chrono::duration<double> min_interval;
+
+	// Earlier checkpoints kept next to the network file as <file>.1 (newest)
+	// to <file>.<snapshot_count>, 0 keeps none
+	u64 snapshot_count;
+};
+
+// Writes networks handed to it from a background thread, so training threads
+// never wait on the disk. Every write goes to a temporary file renamed over
+// the network file, the file only ever holds a complete network. A training
+// state submitted with a network is written after it as <file>.state, a
+// network without one removes the state that no longer matches it
+template<typename Scalar>
+class checkpoint_writer {
+public:
+	// Counts the checkpoints it writes and the time they take in metrics
+	checkpoint_writer(std::string in_filepath, const checkpoint_options& in_options, telemetry& in_metrics);
+
+	// Writes the checkpoint still pending, if any
+	~checkpoint_writer();
+
+	checkpoint_writer(const checkpoint_writer&) = delete;
+	auto operator=(const checkpoint_writer&) -> checkpoint_writer& = delete;
+
+	// Replaces the pending checkpoint, neural_net mustn't change after this.
+	// Never touches the disk, it only waits for another submit
+	auto submit(std::shared_ptr<const basic_network<Scalar>> neural_net, std::optional<double> average_cost,
+	            std::optional<training_state> state = std::nullopt) -> void;
+
+	// Copies neural_net for networks that keep changing while training
+	auto submit(const basic_network<Scalar>& neural_net, std::optional<double> average_cost,
+	            std::optional<training_state> state = std::nullopt) -> void;
+
+private:
+	struct checkpoint {
+		std::shared_ptr<const basic_network<Scalar>> neural_net;
+		std::optional<double> average_cost;
+		std::optional<training_state> state;
+	};
+
+	auto run() -> void;
+	auto write(const checkpoint& latest) -> void;
+	auto rotate_snapshots() -> void;
+
+	std::string filepath;
+	checkpoint_options options;
+	telemetry& metrics;
+
+	std::mutex pending_mutex {};
+	std::condition_variable pending_changed {};
+	std::optional<checkpoint> pending {};
+	bool stopping { false };
+
+	std::thread writer;
+};
+
+extern template class checkpoint_writer<double>;
+extern template class checkpoint_writer<float>;
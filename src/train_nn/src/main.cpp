@@ -1,16 +1,25 @@
+#include <algorithm>
+#include <chrono>
 #include <cstdlib>
 #include <filesystem>
+#include <optional>
 #include <random>
 #include <string>
 #include <thread>
+#include <utility>
+#include <vector>
 
 #include <cxxopts.hpp>
 #include <fmt/format.h>
 
+#include "activation.hpp"
 #include "network.hpp"
 #include "network_from_file.hpp"
 #include "short_types.hpp"
+#include "telemetry.hpp"
 #include "train_nn.hpp"
+#include "trace.hpp"
+#include "training_state.hpp"
 
 auto main(i32 argc, char* argv[]) -> i32 {
 	cxxopts::Options opts {
@@ -22,19 +31,139 @@ auto main(i32 argc, char* argv[]) -> i32 {
 		("data-dir", "Path to mnist data directory", cxxopts::value<std::string>()->default_value("data"))
 		("i,input", "Path to network binary", cxxopts::value<std::string>()->default_value("neural_network.nn"))
 		("t,threads", "Number of threads to use", cxxopts::value<u64>()->default_value("0"))
-		("s,seed", "Seed for random number generator", cxxopts::value<u64>()->default_value("0"));
+		("s,seed", "Seed for random number generator", cxxopts::value<u64>()->default_value("0"))
+		("a,algorithm", "Training algorithm to use (sgd, hill-climb, population)", cxxopts::value<std::string>()->default_value("sgd"))
+		("b,batch-size", "Digits per mini-batch (sgd)", cxxopts::value<u64>()->default_value("10"))
+		("l,learning-rate", "Learning rate (sgd)", cxxopts::value<double>()->default_value("1.5"))
+		("e,epochs", "Number of passes over the training set (sgd)", cxxopts::value<u64>()->default_value("30"))
+		("target-accuracy", "Test accuracy in percent to report the time to reach (sgd)", cxxopts::value<double>()->default_value("95"))
+		("stream-chunk", "Training digits to read at a time instead of mapping the training set, batches are shuffled within a chunk, 0 maps it (sgd)", cxxopts::value<u64>()->default_value("0"))
+		("population", "Number of networks in the population, split between the threads (population)", cxxopts::value<u64>()->default_value("16"))
+		("selection", "How parents are selected (tournament, truncation) (population)", cxxopts::value<std::string>()->default_value("tournament"))
+		("tournament-size", "Networks competing in every tournament (population)", cxxopts::value<u64>()->default_value("3"))
+		("crossover", "How parents are combined (none, uniform, layer) (population)", cxxopts::value<std::string>()->default_value("uniform"))
+		("checkpoint-interval", "Least seconds between writes of the network file, improvements in between only write the latest", cxxopts::value<double>()->default_value("1"))
+		("resume", "Continue the run saved in <input>.state with its algorithm, seed and threads, other options have to match it for sgd to reproduce it", cxxopts::value<bool>()->default_value("false"))
+		("checkpoint-keep", "Earlier checkpoints to keep as <input>.1 (newest) to <input>.N", cxxopts::value<u64>()->default_value("0"))
+		("evaluation", "How candidates are scored (full, racing) (hill-climb, population)", cxxopts::value<std::string>()->default_value("racing"))
+		("racing-risk", "Chance racing rejects a candidate that would have been better, 0 only rejects ones that can't be (hill-climb, population)", cxxopts::value<double>()->default_value("0.01"))
+		("racing-min-digits", "Digits scored before racing can reject a candidate (hill-climb, population)", cxxopts::value<u64>()->default_value("1000"))
+		("migration-interval", "Candidates between taking in the best network of other threads, 0 never does (population)", cxxopts::value<u64>()->default_value("20"))
+		("metrics", "Path to write training metrics to every metrics interval, a summary is printed at the end", cxxopts::value<std::string>()->default_value(""))
+		("metrics-format", "Format of the metrics file (jsonl, csv)", cxxopts::value<std::string>()->default_value("jsonl"))
+		("metrics-interval", "Seconds between two samples in the metrics file", cxxopts::value<double>()->default_value("1"))
+		("trace", "Path to write a Chrome trace event file of the run to, needs a build with NN_TRACING", cxxopts::value<std::string>())
+		("p,precision", "Precision to train in (f64, f32), defaults to the precision of the network file", cxxopts::value<std::string>()->default_value(""))
+		("topology", "Comma separated layer sizes of new networks, from input to output", cxxopts::value<std::string>()->default_value("784,16,16,10"))
+		("hidden-activation", "Activation of the hidden layers of new networks (sigmoid, fast-sigmoid, relu, softmax)", cxxopts::value<std::string>()->default_value("sigmoid"))
+		("output-activation", "Activation of the output layer of new networks (sigmoid, fast-sigmoid, relu, softmax)", cxxopts::value<std::string>()->default_value("sigmoid"));
 
 	opts.parse_positional("input");
 
 	// FIXME: catch exceptions thrown by cxxopts::Options::parse on errors
 	auto results { opts.parse(argc, argv) };
 
-	u64 initial_seed = results["seed"].as<u64>();
+	std::string network_filepath { results["input"].as<std::string>() };
+
+	std::optional<training_state> resumed_state {};
+	if (results["resume"].as<bool>()) {
+		auto state_filepath { training_state_path(network_filepath) };
+
+		resumed_state = load_training_state(state_filepath);
+		if (!resumed_state || !std::filesystem::exists(network_filepath)) {
+			fmt::print("Nothing to resume, \"{}\" needs a network and training state at \"{}\"\n",
+			           network_filepath, state_filepath);
+			std::exit(1);
+		}
+
+		for (const auto* option : { "seed", "threads", "algorithm" }) {
+			if (results.count(option) != 0) {
+				fmt::print("Ignoring --{}, resuming the run saved in \"{}\"\n", option, state_filepath);
+			}
+		}
+	}
+
+	u64 initial_seed = resumed_state ? resumed_state->seed : results["seed"].as<u64>();
 	if (initial_seed == 0) {
 		initial_seed = static_cast<u64>(std::time(nullptr));
 	}
 	std::mt19937 rand_gen { initial_seed };
 
+	std::string algorithm { resumed_state ? resumed_state->algorithm : results["algorithm"].as<std::string>() };
+	if (algorithm != "sgd" && algorithm != "hill-climb" && algorithm != "population") {
+		fmt::print("Unknown training algorithm \"{}\", expected sgd, hill-climb or population\n", algorithm);
+		std::exit(1);
+	}
+
+	std::string selection_name { results["selection"].as<std::string>() };
+	auto selection { selection_method_from_name(selection_name) };
+	if (!selection) {
+		fmt::print("Unknown selection \"{}\", expected tournament or truncation\n", selection_name);
+		std::exit(1);
+	}
+
+	std::string crossover_name { results["crossover"].as<std::string>() };
+	auto crossover { crossover_method_from_name(crossover_name) };
+	if (!crossover) {
+		fmt::print("Unknown crossover \"{}\", expected none, uniform or layer\n", crossover_name);
+		std::exit(1);
+	}
+
+	std::string evaluation { results["evaluation"].as<std::string>() };
+	if (evaluation != "full" && evaluation != "racing") {
+		fmt::print("Unknown evaluation \"{}\", expected full or racing\n", evaluation);
+		std::exit(1);
+	}
+
+	std::optional<racing_options> racing {};
+	if (evaluation == "racing") {
+		racing = racing_options {
+			.rejection_risk = results["racing-risk"].as<double>(),
+			.min_digits = results["racing-min-digits"].as<u64>(),
+		};
+
+		if (racing->rejection_risk < 0.0 || racing->rejection_risk >= 1.0) {
+			fmt::print("racing risk has to be at least 0 and less than 1\n");
+			std::exit(1);
+		}
+	}
+
+	checkpoint_options checkpoints {
+		.min_interval = std::chrono::duration<double> { results["checkpoint-interval"].as<double>() },
+		.snapshot_count = results["checkpoint-keep"].as<u64>(),
+	};
+
+	if (checkpoints.min_interval.count() < 0.0) {
+		fmt::print("checkpoint interval can't be negative\n");
+		std::exit(1);
+	}
+
+	std::optional<telemetry_options> metrics_options {};
+	if (std::string metrics_filepath { results["metrics"].as<std::string>() }; !metrics_filepath.empty()) {
+		std::string format_name { results["metrics-format"].as<std::string>() };
+		auto format { telemetry_format_from_name(format_name) };
+		if (!format) {
+			fmt::print("Unknown metrics format \"{}\", expected jsonl or csv\n", format_name);
+			std::exit(1);
+		}
+
+		metrics_options = telemetry_options {
+			.filepath = std::move(metrics_filepath),
+			.format = *format,
+			.interval = std::chrono::duration<double> { results["metrics-interval"].as<double>() },
+		};
+
+		if (metrics_options->interval.count() <= 0.0) {
+			fmt::print("metrics interval has to be more than 0\n");
+			std::exit(1);
+		}
+	}
+
+	if (results["tournament-size"].as<u64>() == 0) {
+		fmt::print("tournament size has to be at least 1\n");
+		std::exit(1);
+	}
+
 	std::string data_dir { results["data-dir"].as<std::string>() };
 
 	if (!std::filesystem::is_directory(data_dir)) {
@@ -42,19 +171,44 @@ auto main(i32 argc, char* argv[]) -> i32 {
 		std::exit(1);
 	}
 
-	std::string network_filepath { results["input"].as<std::string>() };
 	fmt::print("Using \"{}\" as network file\n", network_filepath);
 
-	network neural_network { 28 * 28, 16, 16, 10 };
-	if (std::filesystem::exists(network_filepath)) {
-		load_network_from_file(neural_network, network_filepath);
-	} else {
-		fmt::print("Network file \"{}\" doesn't exist!\n", network_filepath);
-		fmt::print("Generating new random network at \"{}\"\n", network_filepath);
-		randomize_neural_network_value(neural_network, rand_gen);
+	std::string precision { results["precision"].as<std::string>() };
+	if (precision.empty()) {
+		bool file_is_f32 { std::filesystem::exists(network_filepath)
+			               && network_file_scalar_size(network_filepath) == sizeof(float) };
+
+		precision = file_is_f32 ? "f32" : "f64";
+	} else if (precision != "f64" && precision != "f32") {
+		fmt::print("Unknown precision \"{}\", expected f64 or f32\n", precision);
+		std::exit(1);
+	}
+
+	std::string topology_option { results["topology"].as<std::string>() };
+	auto parsed_topology { parse_network_topology(topology_option) };
+	if (!parsed_topology) {
+		fmt::print("Invalid topology \"{}\", expected at least two comma separated non-zero layer sizes\n",
+		           topology_option);
+		std::exit(1);
 	}
+	std::vector<u64> topology { std::move(*parsed_topology) };
+
+	auto parse_activation = [&](const std::string& option) {
+		std::string name { results[option].as<std::string>() };
+		auto activation { activation_function_from_name(name) };
 
-	u64 thread_count { results["threads"].as<u64>() };
+		if (!activation) {
+			fmt::print("Unknown {} \"{}\", expected sigmoid, fast-sigmoid, relu or softmax\n", option, name);
+			std::exit(1);
+		}
+
+		return *activation;
+	};
+
+	activation_function hidden_activation { parse_activation("hidden-activation") };
+	activation_function output_activation { parse_activation("output-activation") };
+
+	u64 thread_count { resumed_state ? resumed_state->thread_count : results["threads"].as<u64>() };
 	if (thread_count == 0) {
 		thread_count = std::thread::hardware_concurrency();
 
@@ -65,6 +219,108 @@ auto main(i32 argc, char* argv[]) -> i32 {
 
 	fmt::print("Using {} as seed\n", initial_seed);
 	fmt::print("Using {} thread{}\n", thread_count, thread_count > 1 ? "s" : "");
+	fmt::print("Using {} precision\n", precision);
+
+	training_state initial_state { .algorithm = algorithm, .seed = initial_seed, .thread_count = thread_count };
+	if (resumed_state) {
+		initial_state = std::move(*resumed_state);
+		restore_rand_gen(rand_gen, initial_state.rand_gen);
+
+		fmt::print("Resuming after {:.0f}s of training at cost {}\n", initial_state.elapsed_seconds,
+		           initial_state.best_cost);
+	}
+
+	std::optional<trace_session> trace {};
+	if (results.count("trace") != 0) {
+		trace.emplace(results["trace"].as<std::string>());
+	}
+
+	auto train = [&]<typename Scalar>(basic_network<Scalar> neural_network) {
+		if (std::filesystem::exists(network_filepath)) {
+			if (!verify_network_file(network_filepath)) {
+				fmt::print("Network file \"{}\" is corrupt, its checksum doesn't match\n", network_filepath);
+				std::exit(1);
+			}
+
+			load_network_from_file(neural_network, network_filepath);
 
-	train_nn(neural_network, network_filepath, data_dir, rand_gen, thread_count);
+			if (auto stored_cost { network_file_average_cost(network_filepath) }) {
+				fmt::print("Network file was saved at cost {}\n", *stored_cost);
+			}
+
+			if (initial_state.resumed && training_state_checksum(neural_network) != initial_state.parameter_checksum) {
+				fmt::print("Training state of \"{}\" was saved with another network, can't resume it\n",
+				           network_filepath);
+				std::exit(1);
+			}
+
+			if (results.count("topology") != 0 && neural_network.topology != topology) {
+				fmt::print("Ignoring --topology, \"{}\" already has topology {}\n", network_filepath,
+				           fmt::join(neural_network.topology, ","));
+			}
+		} else {
+			fmt::print("Network file \"{}\" doesn't exist!\n", network_filepath);
+			fmt::print("Generating new random network at \"{}\"\n", network_filepath);
+			randomize_neural_network_value(neural_network, rand_gen);
+
+			std::fill(neural_network.layer_activations.begin(), neural_network.layer_activations.end() - 1,
+			          hidden_activation);
+			neural_network.layer_activations.back() = output_activation;
+		}
+
+		fmt::print("Using topology {}\n", fmt::join(neural_network.topology, ","));
+		fmt::print("Using activations");
+		for (const auto activation : neural_network.layer_activations) {
+			fmt::print(" {}", activation_function_name(activation));
+		}
+		fmt::print("\n");
+
+		// sgd runs its batches on one thread, the nudging trainers on every thread
+		telemetry metrics { algorithm == "sgd" ? 1 : thread_count, metrics_options };
+
+		if (algorithm == "sgd") {
+			sgd_options options {
+				.batch_size = results["batch-size"].as<u64>(),
+				.learning_rate = results["learning-rate"].as<double>(),
+				.epochs = results["epochs"].as<u64>(),
+				.target_accuracy = results["target-accuracy"].as<double>(),
+				.stream_chunk = results["stream-chunk"].as<u64>(),
+			};
+
+			fmt::print("Using sgd with batch size {} and learning rate {}\n", options.batch_size,
+			           options.learning_rate);
+
+			train_nn_sgd(neural_network, network_filepath, data_dir, rand_gen, thread_count, checkpoints,
+			             initial_state, metrics, options);
+		} else if (algorithm == "population") {
+			population_options options {
+				.population_size = results["population"].as<u64>(),
+				.selection = *selection,
+				.tournament_size = results["tournament-size"].as<u64>(),
+				.crossover = *crossover,
+				.migration_interval = results["migration-interval"].as<u64>(),
+			};
+
+			fmt::print("Using {} evaluation\n", evaluation);
+			fmt::print("Using a population of {} with {} selection and {} crossover\n", options.population_size,
+			           selection_name, crossover_name);
+
+			train_nn_population(neural_network, network_filepath, data_dir, rand_gen, thread_count, checkpoints,
+			                    initial_state, metrics, options, racing);
+		} else {
+			fmt::print("Using {} evaluation\n", evaluation);
+			train_nn(neural_network, network_filepath, data_dir, rand_gen, thread_count, checkpoints, initial_state,
+			         metrics, racing);
+		}
+
+		if (metrics_options) {
+			metrics.print_summary();
+		}
+	};
+
+	if (precision == "f32") {
+		train(network_f32 { topology });
+	} else {
+		train(network { topology });
+	}
 }
@@ -0,0 +1,86 @@
+#include <atomic>
+
+#include <fmt/format.h>
+#include <poll.h>
+#include <signal.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "stop_signal.hpp"
+
+// Only a lock free atomic is safe to touch from a signal handler
+static std::atomic<bool> signal_received { false };
+static_assert(std::atomic<bool>::is_always_lock_free);
+
+static auto handle_stop_signal(int) -> void {
+	signal_received = true;
+}
+
+stop_signal::stop_signal() {
+	signal_received = false;
+
+	struct sigaction action {};
+	action.sa_handler = handle_stop_signal;
+	sigemptyset(&action.sa_mask);
+
+	sigaction(SIGINT, &action, &old_interrupt_action);
+	sigaction(SIGTERM, &action, &old_terminate_action);
+
+	listener = std::thread { &stop_signal::listen, this };
+}
+
+stop_signal::~stop_signal() {
+	listener_finished = true;
+	listener.join();
+
+	sigaction(SIGINT, &old_interrupt_action, nullptr);
+	sigaction(SIGTERM, &old_terminate_action, nullptr);
+}
+
+auto stop_signal::requested() const -> bool {
+	return stop_requested || signal_received;
+}
+
+auto stop_signal::listen() -> void {
+	// Get terminal state to revert to after we are done
+	termios old_term {};
+	tcgetattr(STDIN_FILENO, &old_term);
+
+	// Set the terminal to not buffer when characters are enterd
+	termios new_term { old_term };
+	new_term.c_lflag &= ~(ICANON | ECHO);
+	tcsetattr(STDIN_FILENO, TCSANOW, &new_term);
+
+	fmt::print("Press 's' in terminal to stop\n");
+
+	// Poll with a timeout instead of blocking in getchar so the listener
+	// can also exit when training finishes on its own
+	pollfd stdin_poll { STDIN_FILENO, POLLIN, 0 };
+	while (!listener_finished) {
+		if (signal_received) {
+			fmt::print("Got a signal to stop, exiting training loop as soon as possible\n");
+			stop_requested = true;
+			break;
+		}
+
+		if (poll(&stdin_poll, 1, 100) <= 0) {
+			continue;
+		}
+
+		char c;
+		if (read(STDIN_FILENO, &c, 1) != 1) {
+			break;
+		}
+
+		if (c == 's') {
+			fmt::print("Exiting training loop as soon as possible\n");
+			stop_requested = true;
+			break;
+		}
+
+		fmt::print("Press 's' in terminal to stop\n");
+	}
+
+	// Revert terminal state
+	tcsetattr(STDIN_FILENO, TCSANOW, &old_term);
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+
+#include <signal.h>
+
+// Listens in the background for 's' to be input in the terminal, after it
+// gets that requested() returns true so training loops can exit early.
+// SIGINT and SIGTERM stop training the same way while it exists, so a run
+// that gets interrupted or preempted still saves where it got to
+class stop_signal {
+public:
+	stop_signal();
+	~stop_signal();
+
+	stop_signal(const stop_signal&) = delete;
+	auto operator=(const stop_signal&) -> stop_signal& = delete;
+
+	auto requested() const -> bool;
+
+private:
+	auto listen() -> void;
+
+	std::atomic<bool> stop_requested { false };
+	std::atomic<bool> listener_finished { false };
+
+	struct sigaction old_interrupt_action {};
+	struct sigaction old_terminate_action {};
+
+	std::thread listener;
+};
@@ -0,0 +1,323 @@
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <mutex>
+#include <numeric>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include "telemetry.hpp"
+
+constexpr std::array telemetry_format_names {
+	std::pair { telemetry_format::jsonl, std::string_view { "jsonl" } },
+	std::pair { telemetry_format::csv, std::string_view { "csv" } },
+};
+
+auto telemetry_format_from_name(std::string_view name) -> std::optional<telemetry_format> {
+	for (const auto& [format, known_name] : telemetry_format_names) {
+		if (known_name == name) {
+			return format;
+		}
+	}
+
+	return std::nullopt;
+}
+
+static auto nanoseconds(std::chrono::steady_clock::duration duration) -> u64 {
+	return static_cast<u64>(std::max<std::chrono::nanoseconds::rep>(
+	    std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count(), 0));
+}
+
+// Only for counters a single thread writes
+static auto add(std::atomic<u64>& counter, u64 value) -> void {
+	counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+auto latency_histogram::record(std::chrono::steady_clock::duration duration) -> void {
+	auto value { nanoseconds(duration) };
+
+	// The highest set bit picks the power of two, the two bits below it the bucket in it
+	std::size_t index { value };
+	if (value >= sub_buckets) {
+		auto exponent { static_cast<std::size_t>(std::bit_width(value)) - 1 };
+		index = (exponent - 1) * sub_buckets + ((value >> (exponent - 2)) & (sub_buckets - 1));
+	}
+
+	add(counts[std::min(index, bucket_count - 1)], 1);
+}
+
+auto latency_histogram::add_to(std::array<u64, bucket_count>& buckets) const -> void {
+	for (std::size_t i { 0 }; i < bucket_count; ++i) {
+		buckets[i] += counts[i].load(std::memory_order_relaxed);
+	}
+}
+
+auto latency_histogram::quantile(const std::array<u64, bucket_count>& buckets, double fraction)
+    -> std::chrono::nanoseconds {
+	auto total { std::accumulate(buckets.begin(), buckets.end(), u64 { 0 }) };
+	if (total == 0) {
+		return std::chrono::nanoseconds { 0 };
+	}
+
+	auto rank { static_cast<u64>(std::ceil(fraction * static_cast<double>(total))) };
+
+	u64 seen { 0 };
+	std::size_t index { 0 };
+	for (; index < bucket_count - 1; ++index) {
+		seen += buckets[index];
+		if (seen >= std::max<u64>(rank, 1)) {
+			break;
+		}
+	}
+
+	if (index < sub_buckets) {
+		return std::chrono::nanoseconds { index };
+	}
+
+	// Inverse of record, the upper bound is the lower bound of the next bucket
+	auto exponent { index / sub_buckets + 1 };
+	auto sub_bucket { index % sub_buckets };
+	auto upper_bound { (u64 { 1 } << exponent) + ((sub_bucket + 1) << (exponent - 2)) };
+
+	return std::chrono::nanoseconds { static_cast<std::chrono::nanoseconds::rep>(upper_bound) };
+}
+
+auto thread_telemetry::record_candidate() -> void {
+	add(candidates, 1);
+}
+
+auto thread_telemetry::record_improvement() -> void {
+	add(improvements, 1);
+}
+
+auto thread_telemetry::record_compute(u64 samples_run, std::chrono::steady_clock::duration duration) -> void {
+	add(samples, samples_run);
+	add(compute_nanoseconds, nanoseconds(duration));
+	compute_latency.record(duration);
+}
+
+auto thread_telemetry::record_lock_wait(std::chrono::steady_clock::duration duration) -> void {
+	add(lock_wait_nanoseconds, nanoseconds(duration));
+}
+
+telemetry::telemetry(u64 thread_count, std::optional<telemetry_options> in_options)
+    : threads(thread_count)
+    , start_time { std::chrono::steady_clock::now() }
+    , cost { std::numeric_limits<double>::quiet_NaN() }
+    , options { std::move(in_options) } {
+	if (!options) {
+		return;
+	}
+
+	output = std::fopen(options->filepath.c_str(), "w");
+	if (output == nullptr) {
+		fmt::print("Failed to open \"{}\" to write metrics to\n", options->filepath);
+		std::exit(1);
+	}
+
+	write_header();
+	sampler = std::thread { [this] { run(); } };
+}
+
+telemetry::~telemetry() {
+	if (!options) {
+		return;
+	}
+
+	{
+		std::lock_guard lock { stop_mutex };
+		stopping = true;
+	}
+
+	stop_changed.notify_one();
+	sampler.join();
+
+	std::fclose(output);
+}
+
+auto telemetry::thread(std::size_t index) -> thread_telemetry& {
+	return threads[index];
+}
+
+auto telemetry::record_cost(double in_cost) -> void {
+	cost.store(in_cost, std::memory_order_relaxed);
+}
+
+auto telemetry::record_checkpoint(std::chrono::steady_clock::duration write_time) -> void {
+	checkpoints.fetch_add(1, std::memory_order_relaxed);
+	checkpoint_nanoseconds.fetch_add(nanoseconds(write_time), std::memory_order_relaxed);
+}
+
+auto telemetry::record_checkpoint_wait(std::chrono::steady_clock::duration duration) -> void {
+	checkpoint_wait_nanoseconds.fetch_add(nanoseconds(duration), std::memory_order_relaxed);
+}
+
+auto telemetry::record_dataset_load(std::chrono::steady_clock::duration duration) -> void {
+	dataset_load_nanoseconds.fetch_add(nanoseconds(duration), std::memory_order_relaxed);
+}
+
+auto telemetry::collect() const -> totals {
+	totals current {
+		.time = std::chrono::steady_clock::now(),
+		.thread_candidates = {},
+		.thread_samples = {},
+		.improvements = 0,
+		.compute_nanoseconds = 0,
+		.lock_wait_nanoseconds = checkpoint_wait_nanoseconds.load(std::memory_order_relaxed),
+		.checkpoints = checkpoints.load(std::memory_order_relaxed),
+		.checkpoint_nanoseconds = checkpoint_nanoseconds.load(std::memory_order_relaxed),
+	};
+
+	for (const auto& counters : threads) {
+		current.thread_candidates.push_back(counters.candidates.load(std::memory_order_relaxed));
+		current.thread_samples.push_back(counters.samples.load(std::memory_order_relaxed));
+		current.improvements += counters.improvements.load(std::memory_order_relaxed);
+		current.compute_nanoseconds += counters.compute_nanoseconds.load(std::memory_order_relaxed);
+		current.lock_wait_nanoseconds += counters.lock_wait_nanoseconds.load(std::memory_order_relaxed);
+	}
+
+	return current;
+}
+
+auto telemetry::run() -> void {
+	auto interval { std::chrono::duration_cast<std::chrono::steady_clock::duration>(options->interval) };
+	auto previous { collect() };
+
+	std::unique_lock lock { stop_mutex };
+	while (true) {
+		bool stopped { stop_changed.wait_until(lock, previous.time + interval, [&] { return stopping; }) };
+
+		auto current { collect() };
+		write_sample(previous, current);
+		previous = std::move(current);
+
+		if (stopped) {
+			return;
+		}
+	}
+}
+
+auto telemetry::write_header() -> void {
+	if (options->format != telemetry_format::csv) {
+		return;
+	}
+
+	fmt::print(output, "seconds,cost,samples_per_second,candidates_per_second,improvements,compute_fraction,"
+	                   "lock_wait_ms,checkpoints,checkpoint_ms");
+	for (std::size_t i { 0 }; i < threads.size(); ++i) {
+		fmt::print(output, ",thread{0}_samples_per_second,thread{0}_candidates_per_second", i);
+	}
+	fmt::print(output, "\n");
+}
+
+auto telemetry::write_sample(const totals& previous, const totals& current) -> void {
+	auto seconds { std::chrono::duration<double> { current.time - previous.time }.count() };
+	if (seconds <= 0.0) {
+		return;
+	}
+
+	auto rate = [&](u64 now, u64 before) {
+		return static_cast<double>(now - before) / seconds;
+	};
+
+	auto sum = [](const std::vector<u64>& values) {
+		return std::accumulate(values.begin(), values.end(), u64 { 0 });
+	};
+
+	auto elapsed { std::chrono::duration<double> { current.time - start_time }.count() };
+	auto latest_cost { cost.load(std::memory_order_relaxed) };
+	auto compute_fraction { static_cast<double>(current.compute_nanoseconds - previous.compute_nanoseconds)
+		                    / (seconds * 1e9 * static_cast<double>(threads.size())) };
+	auto lock_wait_ms { static_cast<double>(current.lock_wait_nanoseconds - previous.lock_wait_nanoseconds) / 1e6 };
+	auto checkpoint_ms { static_cast<double>(current.checkpoint_nanoseconds - previous.checkpoint_nanoseconds)
+		                 / 1e6 };
+
+	if (options->format == telemetry_format::csv) {
+		fmt::print(output, "{:.3f},{},{:.1f},{:.3f},{},{:.4f},{:.3f},{},{:.3f}", elapsed,
+		           std::isnan(latest_cost) ? std::string {} : fmt::format("{}", latest_cost),
+		           rate(sum(current.thread_samples), sum(previous.thread_samples)),
+		           rate(sum(current.thread_candidates), sum(previous.thread_candidates)),
+		           current.improvements - previous.improvements, compute_fraction, lock_wait_ms,
+		           current.checkpoints - previous.checkpoints, checkpoint_ms);
+
+		for (std::size_t i { 0 }; i < threads.size(); ++i) {
+			fmt::print(output, ",{:.1f},{:.3f}", rate(current.thread_samples[i], previous.thread_samples[i]),
+			           rate(current.thread_candidates[i], previous.thread_candidates[i]));
+		}
+	} else {
+		fmt::print(output,
+		           "{{\"seconds\": {:.3f}, \"cost\": {}, \"samples_per_second\": {:.1f}, "
+		           "\"candidates_per_second\": {:.3f}, \"improvements\": {}, \"compute_fraction\": {:.4f}, "
+		           "\"lock_wait_ms\": {:.3f}, \"checkpoints\": {}, \"checkpoint_ms\": {:.3f}, \"threads\": [",
+		           elapsed, std::isnan(latest_cost) ? std::string { "null" } : fmt::format("{}", latest_cost),
+		           rate(sum(current.thread_samples), sum(previous.thread_samples)),
+		           rate(sum(current.thread_candidates), sum(previous.thread_candidates)),
+		           current.improvements - previous.improvements, compute_fraction, lock_wait_ms,
+		           current.checkpoints - previous.checkpoints, checkpoint_ms);
+
+		for (std::size_t i { 0 }; i < threads.size(); ++i) {
+			fmt::print(output, "{}{{\"samples_per_second\": {:.1f}, \"candidates_per_second\": {:.3f}}}",
+			           i == 0 ? "" : ", ", rate(current.thread_samples[i], previous.thread_samples[i]),
+			           rate(current.thread_candidates[i], previous.thread_candidates[i]));
+		}
+
+		fmt::print(output, "]}}");
+	}
+
+	fmt::print(output, "\n");
+
+	// Whoever follows the file sees every sample as soon as it's taken
+	std::fflush(output);
+}
+
+auto telemetry::print_summary() const -> void {
+	auto current { collect() };
+	auto seconds { std::chrono::duration<double> { current.time - start_time }.count() };
+	auto thread_seconds { seconds * static_cast<double>(threads.size()) };
+
+	auto sum = [](const std::vector<u64>& values) {
+		return std::accumulate(values.begin(), values.end(), u64 { 0 });
+	};
+
+	auto as_seconds = [](u64 nanoseconds) {
+		return static_cast<double>(nanoseconds) / 1e9;
+	};
+
+	std::array<u64, latency_histogram::bucket_count> latency_buckets {};
+	for (const auto& counters : threads) {
+		counters.compute_latency.add_to(latency_buckets);
+	}
+
+	auto milliseconds = [&](double fraction) {
+		return std::chrono::duration<double, std::milli> { latency_histogram::quantile(latency_buckets, fraction) }
+		    .count();
+	};
+
+	fmt::print("Telemetry over {:.1f}s: {:.0f} samples/s | {:.2f} candidates/s | {} improvements\n", seconds,
+	           static_cast<double>(sum(current.thread_samples)) / seconds,
+	           static_cast<double>(sum(current.thread_candidates)) / seconds, current.improvements);
+	fmt::print("  compute {:.1f}% of thread time (p50 {:.3f}ms | p99 {:.3f}ms) | lock wait {:.3f}ms\n",
+	           as_seconds(current.compute_nanoseconds) / thread_seconds * 100.0, milliseconds(0.5),
+	           milliseconds(0.99), as_seconds(current.lock_wait_nanoseconds) * 1e3);
+	fmt::print("  dataset loaded in {:.3f}s | {} checkpoints written in {:.3f}s\n",
+	           as_seconds(dataset_load_nanoseconds.load()), current.checkpoints,
+	           as_seconds(current.checkpoint_nanoseconds));
+
+	if (threads.size() > 1) {
+		for (std::size_t i { 0 }; i < threads.size(); ++i) {
+			fmt::print("  thread {}: {:.0f} samples/s | {:.2f} candidates/s\n", i,
+			           static_cast<double>(current.thread_samples[i]) / seconds,
+			           static_cast<double>(current.thread_candidates[i]) / seconds);
+		}
+	}
+}
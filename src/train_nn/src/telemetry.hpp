@@ -0,0 +1,140 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "short_types.hpp"
+
+enum class telemetry_format {
+	jsonl,  // one JSON object per sample
+	csv,    // a header line, then one line per sample
+};
+
+auto telemetry_format_from_name(std::string_view name) -> std::optional<telemetry_format>;
+
+struct telemetry_options {
+	std::string filepath;
+	telemetry_format format;
+
+	// Time between two samples written to filepath
+	std::chrono::duration<double> interval;
+};
+
+// Durations in 4 buckets per power of two nanoseconds, so quantiles are
+// within about 20% of the real value. Only one thread may record into it
+class latency_histogram {
+public:
+	static constexpr std::size_t sub_buckets { 4 };
+	static constexpr std::size_t bucket_count { 64 * sub_buckets };
+
+	auto record(std::chrono::steady_clock::duration duration) -> void;
+
+	// Adds the counts to buckets, to combine the histograms of several threads
+	auto add_to(std::array<u64, bucket_count>& buckets) const -> void;
+
+	// Upper bound of the bucket holding the fraction quantile of buckets
+	static auto quantile(const std::array<u64, bucket_count>& buckets, double fraction) -> std::chrono::nanoseconds;
+
+private:
+	std::array<std::atomic<u64>, bucket_count> counts {};
+};
+
+// Counters of one training thread, only that thread writes them so counting
+// is a plain load and store rather than a locked add. Each sits on cache
+// lines of its own so threads counting never contend
+struct alignas(64) thread_telemetry {
+	// Candidates scored, sgd doesn't have any and only counts samples
+	std::atomic<u64> candidates { 0 };
+	std::atomic<u64> improvements { 0 };
+
+	// Digits run through the network, forward only or forward and back
+	std::atomic<u64> samples { 0 };
+
+	std::atomic<u64> compute_nanoseconds { 0 };
+	std::atomic<u64> lock_wait_nanoseconds { 0 };
+	latency_histogram compute_latency {};
+
+	auto record_candidate() -> void;
+	auto record_improvement() -> void;
+
+	// One candidate or batch of samples_run digits that took duration
+	auto record_compute(u64 samples_run, std::chrono::steady_clock::duration duration) -> void;
+	auto record_lock_wait(std::chrono::steady_clock::duration duration) -> void;
+};
+
+// Counts what training threads spend their time on and, when given a file,
+// writes a sample of the rates since the last one every interval from a
+// background thread. The counters are always kept, they cost about a clock
+// read per candidate or batch. Compute time is counted when a candidate or
+// batch finishes, so a sample's compute fraction can exceed 1 when long
+// candidates finish in it or threads share cores
+class telemetry {
+public:
+	telemetry(u64 thread_count, std::optional<telemetry_options> in_options);
+
+	// Writes the sample since the last one
+	~telemetry();
+
+	telemetry(const telemetry&) = delete;
+	auto operator=(const telemetry&) -> telemetry& = delete;
+
+	auto thread(std::size_t index) -> thread_telemetry&;
+
+	// Best cost of the nudging trainers, training cost of the epoch so far for sgd
+	auto record_cost(double cost) -> void;
+
+	auto record_checkpoint(std::chrono::steady_clock::duration write_time) -> void;
+
+	// Time spent waiting for the checkpoint writer to take a network
+	auto record_checkpoint_wait(std::chrono::steady_clock::duration duration) -> void;
+
+	auto record_dataset_load(std::chrono::steady_clock::duration duration) -> void;
+
+	// Throughput, where the thread time went and latency quantiles of the whole run
+	auto print_summary() const -> void;
+
+private:
+	// Totals of every counter at one point in time, samples are the difference of two
+	struct totals {
+		std::chrono::steady_clock::time_point time;
+		std::vector<u64> thread_candidates;
+		std::vector<u64> thread_samples;
+		u64 improvements;
+		u64 compute_nanoseconds;
+		u64 lock_wait_nanoseconds;
+		u64 checkpoints;
+		u64 checkpoint_nanoseconds;
+	};
+
+	auto collect() const -> totals;
+	auto run() -> void;
+	auto write_header() -> void;
+	auto write_sample(const totals& previous, const totals& current) -> void;
+
+	std::vector<thread_telemetry> threads;
+	std::chrono::steady_clock::time_point start_time;
+
+	std::atomic<double> cost;
+	std::atomic<u64> checkpoints { 0 };
+	std::atomic<u64> checkpoint_nanoseconds { 0 };
+	std::atomic<u64> checkpoint_wait_nanoseconds { 0 };
+	std::atomic<u64> dataset_load_nanoseconds { 0 };
+
+	std::optional<telemetry_options> options;
+	std::FILE* output { nullptr };
+
+	std::mutex stop_mutex {};
+	std::condition_variable stop_changed {};
+	bool stopping { false };
+
+	std::thread sampler {};
+};
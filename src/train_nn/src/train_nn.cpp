@@ -1,90 +1,113 @@
 #include <chrono>
-#include <mutex>
+#include <string>
 #include <thread>
 #include <vector>
 
 #include <fmt/chrono.h>
 #include <fmt/format.h>
-#include <termios.h>
-#include <unistd.h>
 
 #include "average_cost_of_neural_net.hpp"
-#include "load_mnist_digits.hpp"
-#include "network_to_file.hpp"
-
-auto train_nn(network& output_network, const std::string& output_filepath, const std::string& data_dir,
-              std::mt19937& rand_gen, u64 thread_count) -> void {
-	auto training_digits { digits_from_path(data_dir + "/mnist_training_images", data_dir + "/mnist_training_labels") };
-
-	double output_network_average_cost { average_cost_of_neural_net(output_network, training_digits) };
+#include "best_network.hpp"
+#include "candidate_scorer.hpp"
+#include "check_network_fits_dataset.hpp"
+#include "checkpoint_writer.hpp"
+#include "mnist_dataset.hpp"
+#include "stop_signal.hpp"
+#include "telemetry.hpp"
+#include "thread_pool.hpp"
+#include "trace.hpp"
+#include "train_nn.hpp"
+#include "training_state.hpp"
+
+template<typename Scalar>
+auto train_nn(basic_network<Scalar>& output_network, const std::string& output_filepath, const std::string& data_dir,
+              std::mt19937& rand_gen, u64 thread_count, const checkpoint_options& checkpoints,
+              const training_state& initial_state, telemetry& metrics, const std::optional<racing_options>& racing)
+    -> void {
+	auto load_start { std::chrono::steady_clock::now() };
+	mnist_dataset training_digits { data_dir + "/mnist_training_images", data_dir + "/mnist_training_labels" };
+	metrics.record_dataset_load(std::chrono::steady_clock::now() - load_start);
+	check_network_fits_dataset(output_network, training_digits);
+
+	double output_network_average_cost {};
+	{
+		thread_pool pool { thread_count };
+		output_network_average_cost = average_cost_of_neural_net(output_network, training_digits, pool);
+	}
 	fmt::print("network cost: {}\n", output_network_average_cost);
+	metrics.record_cost(output_network_average_cost);
+
+	// Everything drawn from rand_gen is drawn here, a resumed run that starts
+	// from the same state draws the same racing order and thread seeds
+	auto initial_rand_gen { rand_gen_state(rand_gen) };
+
+	stop_signal stop {};
+	// The threads read the best network as readers 0 to thread_count - 1, this one as the last
+	best_network<Scalar> best { output_network, output_network_average_cost, thread_count + 1 };
+	auto main_reader { thread_count };
+	candidate_scorer scorer { training_digits, rand_gen, racing };
+	checkpoint_writer<Scalar> checkpoint { output_filepath, checkpoints, metrics };
+
+	// Drawn up front, rand_gen isn't safe to share between the threads
+	std::vector<std::mt19937::result_type> thread_seeds(thread_count);
+	for (auto& seed : thread_seeds) {
+		seed = std::uniform_int_distribution<std::mt19937::result_type> {}(rand_gen);
+	}
 
-	bool stop_signal_recieved { false };
-
-	// Thread waits for 's' to be input in terminal, after it gets that it
-	// sets a flat to stop the train loop
-	std::thread stop_thread { [&stop_signal_recieved]() {
-		// Get terminal state to revert to after we are done
-		termios old_term {};
-		tcgetattr(STDIN_FILENO, &old_term);
-
-		// Set the terminal to not buffer when characters are enterd
-		termios new_term { old_term };
-		new_term.c_lflag &= ~(ICANON | ECHO);
-		tcsetattr(STDIN_FILENO, TCSANOW, &new_term);
-
-		// FIXME: fmt::print isn't thread safe
-		char c;
-		do {
-			fmt::print("Press 's' in terminal to stop\n");
-			c = getchar();
-		} while (c != EOF && c != 's');
-
-		fmt::print("Exiting training loop as soon as possible\n");
-		stop_signal_recieved = true;
-
-		// Revert terminal state
-		tcsetattr(STDIN_FILENO, TCSANOW, &old_term);
-	} };
+	// Every thread leaves the state its generator stopped in here
+	std::vector<std::string> thread_rand_gens(thread_count);
 
-	std::mutex best_nn_mutex {};
 	std::vector<std::thread> threads {};
 	threads.reserve(thread_count);
 
-	auto start_time { std::chrono::steady_clock::now() };
+	auto resumed_elapsed { std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+	    std::chrono::duration<double> { initial_state.elapsed_seconds }) };
+	auto start_time { std::chrono::steady_clock::now() - resumed_elapsed };
+
 	for (size_t i { 0 }; i < thread_count; ++i) {
-		threads.emplace_back([&output_network, &output_network_average_cost, &start_time, &output_filepath, &rand_gen,
-		                      &training_digits, &best_nn_mutex, &stop_signal_recieved] {
-			std::uniform_int_distribution<u64> random_int {};
-			std::mt19937 thread_rand_gen { random_int(rand_gen) };
+		threads.emplace_back([&best, &scorer, &checkpoint, &start_time, &output_filepath, &stop, &initial_state,
+		                      &counters = metrics.thread(i), &metrics, &rand_gen_slot = thread_rand_gens[i], i,
+		                      seed = thread_seeds[i]] {
+			std::mt19937 thread_rand_gen { seed };
+			if (i < initial_state.thread_rand_gens.size()) {
+				restore_rand_gen(thread_rand_gen, initial_state.thread_rand_gens[i]);
+			}
+
+			std::bernoulli_distribution rand_bool {};
 
-			network neural_net { output_network };
+			basic_network<Scalar> neural_net { best.current(i)->neural_net };
+
+			while (!stop.requested()) {
+				TRACE_ZONE("candidate");
 
-			while (!stop_signal_recieved) {
 				nudge_neural_network_values(neural_net, thread_rand_gen);
 
-				auto average_cost { average_cost_of_neural_net(neural_net, training_digits) };
+				// Reading the shared best network is wait free, it's still timed so
+				// the telemetry shows what sharing it costs
+				auto wait_start { std::chrono::steady_clock::now() };
+				auto threshold_cost { best.current(i)->average_cost };
+				counters.record_lock_wait(std::chrono::steady_clock::now() - wait_start);
 
-				if (std::lock_guard l { best_nn_mutex }; average_cost < output_network_average_cost) {
-					double cost_diff { output_network_average_cost - average_cost };
+				auto average_cost { scorer.score(neural_net, threshold_cost, counters) };
 
-					output_network_average_cost = average_cost;
-					output_network = neural_net;
+				if (auto replaced { average_cost ? best.publish(i, neural_net, *average_cost) : nullptr }) {
+					counters.record_improvement();
+					metrics.record_cost(*average_cost);
 
-					auto current_time { std::chrono::steady_clock::now() };
-					auto diff { current_time - start_time };
+					auto diff { std::chrono::steady_clock::now() - start_time };
 					fmt::print("[{:9%H:%M:%S}] new best cost network ({:.6f} | -{:.6f}) saved to \"{}\"\n", diff,
-					           output_network_average_cost, cost_diff, output_filepath);
-					save_network_to_file(output_network, output_filepath);
-				} else {
-					std::bernoulli_distribution rand_bool {};
-
-					// Give a chance that the network survives even if it's worse
-					if (rand_bool(thread_rand_gen)) {
-						neural_net = output_network;
-					}
+					           *average_cost, replaced->average_cost - *average_cost, output_filepath);
+
+					// Shares the snapshot with the writer instead of copying the network again
+					auto latest { best.current(i) };
+					checkpoint.submit({ latest, &latest->neural_net }, latest->average_cost);
+				} else if (rand_bool(thread_rand_gen)) {
+					// Half the time a worse network goes back to the best one, otherwise it survives
+					neural_net = best.current(i)->neural_net;
 				}
 			}
+
+			rand_gen_slot = rand_gen_state(thread_rand_gen);
 		});
 	}
 
@@ -92,5 +115,27 @@ auto train_nn(network& output_network, const std::string& output_filepath, const
 		th.join();
 	}
 
-	stop_thread.join();
+	auto elapsed { std::chrono::steady_clock::now() - start_time };
+	scorer.print_summary(elapsed - resumed_elapsed);
+
+	training_state state { initial_state };
+	state.elapsed_seconds = std::chrono::duration<double> { elapsed }.count();
+	state.best_cost = best.current(main_reader)->average_cost;
+	state.rand_gen = initial_rand_gen;
+	state.thread_rand_gens = std::move(thread_rand_gens);
+	state.candidates_evaluated += scorer.candidates_scored();
+
+	auto latest { best.current(main_reader) };
+	checkpoint.submit({ latest, &latest->neural_net }, latest->average_cost, std::move(state));
+
+	output_network = best.current(main_reader)->neural_net;
 }
+
+template auto train_nn(network& output_network, const std::string& output_filepath, const std::string& data_dir,
+                       std::mt19937& rand_gen, u64 thread_count, const checkpoint_options& checkpoints,
+                       const training_state& initial_state, telemetry& metrics,
+                       const std::optional<racing_options>& racing) -> void;
+template auto train_nn(network_f32& output_network, const std::string& output_filepath, const std::string& data_dir,
+                       std::mt19937& rand_gen, u64 thread_count, const checkpoint_options& checkpoints,
+                       const training_state& initial_state, telemetry& metrics,
+                       const std::optional<racing_options>& racing) -> void;
@@ -1,8 +1,90 @@
+#pragma once
+
+#include <optional>
 #include <random>
 #include <string>
+#include <string_view>
 
+#include "checkpoint_writer.hpp"
 #include "network.hpp"
+#include "racing_cost_of_neural_net.hpp"
 #include "short_types.hpp"
+#include "telemetry.hpp"
+#include "training_state.hpp"
+
+struct sgd_options {
+	u64 batch_size;
+	double learning_rate;
+	u64 epochs;
+
+	// Test accuracy in percent, the wall time it took to reach it is reported
+	double target_accuracy;
+
+	// Training digits read at a time when streaming the training set rather
+	// than mapping it, 0 maps it. Batches are shuffled within a chunk only
+	u64 stream_chunk;
+};
+
+// How parents are picked from a thread's slice of the population
+enum class selection_method {
+	tournament,  // lowest cost of tournament_size random individuals
+	truncation,  // any individual of the lower cost half
+};
+
+// How two parents are combined into a child before it gets nudged
+enum class crossover_method {
+	none,     // the child is a copy of the first parent
+	uniform,  // every parameter comes from either parent
+	layer,    // every layer comes whole from either parent
+};
+
+auto selection_method_from_name(std::string_view name) -> std::optional<selection_method>;
+auto crossover_method_from_name(std::string_view name) -> std::optional<crossover_method>;
+
+struct population_options {
+	// Split evenly between the threads, every thread gets at least 2
+	u64 population_size;
+
+	selection_method selection;
+	u64 tournament_size;
+	crossover_method crossover;
+
+	// Candidates a thread evaluates between taking in the shared best network
+	u64 migration_interval;
+};
+
+// Random nudge hill climber, every thread nudges its own copy of the network
+// and keeps it if it scores a lower cost over the whole training set. With
+// racing, candidates stop being scored once they can't beat the best network.
+//
+// Every trainer starts from initial_state, a resumed one continues its run and
+// the state the trainer stops in is saved with the network it stops with. The
+// nudging trainers restore their generators but not each thread's working
+// network or population slice, every thread restarts from the best network.
+// Their resumed runs only approximately continue the stopped one, with a
+// single thread too. What the threads spend their time on is counted in metrics
+template<typename Scalar>
+auto train_nn(basic_network<Scalar>& output_network, const std::string& output_filepath, const std::string& data_dir,
+              std::mt19937& rand_gen, u64 thread_count, const checkpoint_options& checkpoints,
+              const training_state& initial_state, telemetry& metrics, const std::optional<racing_options>& racing)
+    -> void;
+
+// Mini-batch stochastic gradient descent using backpropagation. Gradients
+// don't depend on the thread count, so a resumed run ends up with exactly the
+// network an uninterrupted one with the same seed and options would have
+template<typename Scalar>
+auto train_nn_sgd(basic_network<Scalar>& output_network, const std::string& output_filepath,
+                  const std::string& data_dir, std::mt19937& rand_gen, u64 thread_count,
+                  const checkpoint_options& checkpoints, const training_state& initial_state, telemetry& metrics,
+                  const sgd_options& options) -> void;
 
-auto train_nn(network& output_network, const std::string& output_filepath, const std::string& data_dir,
-              std::mt19937& rand_gen, u64 thread_count) -> void;
+// Steady state evolutionary search, every thread breeds candidates from its
+// own slice of the population and only touches the shared best network to
+// publish an improvement or take it in as a migrant. With racing, children
+// stop being scored once they can't beat the worst of their slice
+template<typename Scalar>
+auto train_nn_population(basic_network<Scalar>& output_network, const std::string& output_filepath,
+                         const std::string& data_dir, std::mt19937& rand_gen, u64 thread_count,
+                         const checkpoint_options& checkpoints, const training_state& initial_state,
+                         telemetry& metrics, const population_options& options,
+                         const std::optional<racing_options>& racing) -> void;
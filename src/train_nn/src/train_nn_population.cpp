@@ -0,0 +1,294 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <limits>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <fmt/chrono.h>
+#include <fmt/format.h>
+
+#include "average_cost_of_neural_net.hpp"
+#include "best_network.hpp"
+#include "candidate_scorer.hpp"
+#include "check_network_fits_dataset.hpp"
+#include "checkpoint_writer.hpp"
+#include "mnist_dataset.hpp"
+#include "stop_signal.hpp"
+#include "telemetry.hpp"
+#include "thread_pool.hpp"
+#include "trace.hpp"
+#include "train_nn.hpp"
+#include "training_state.hpp"
+
+constexpr std::array selection_method_names {
+	std::pair { selection_method::tournament, std::string_view { "tournament" } },
+	std::pair { selection_method::truncation, std::string_view { "truncation" } },
+};
+
+constexpr std::array crossover_method_names {
+	std::pair { crossover_method::none, std::string_view { "none" } },
+	std::pair { crossover_method::uniform, std::string_view { "uniform" } },
+	std::pair { crossover_method::layer, std::string_view { "layer" } },
+};
+
+auto selection_method_from_name(std::string_view name) -> std::optional<selection_method> {
+	for (const auto& [method, known_name] : selection_method_names) {
+		if (known_name == name) {
+			return method;
+		}
+	}
+
+	return std::nullopt;
+}
+
+auto crossover_method_from_name(std::string_view name) -> std::optional<crossover_method> {
+	for (const auto& [method, known_name] : crossover_method_names) {
+		if (known_name == name) {
+			return method;
+		}
+	}
+
+	return std::nullopt;
+}
+
+template<typename Scalar>
+struct individual {
+	basic_network<Scalar> neural_net;
+	double average_cost;
+};
+
+// Slices are kept sorted by cost, so a lower index is a fitter individual
+auto select_parent(size_t slice_size, const population_options& options, std::mt19937& rand_gen) -> size_t {
+	switch (options.selection) {
+		case selection_method::tournament: {
+			std::uniform_int_distribution<size_t> rand_index { 0, slice_size - 1 };
+
+			size_t winner { rand_index(rand_gen) };
+			for (u64 i { 1 }; i < options.tournament_size; ++i) {
+				winner = std::min(winner, rand_index(rand_gen));
+			}
+
+			return winner;
+		}
+		case selection_method::truncation:
+			return std::uniform_int_distribution<size_t> { 0, std::max<size_t>(slice_size / 2, 1) - 1 }(rand_gen);
+	}
+
+	return 0;
+}
+
+// Overwrites child, which already has the parents' topology, so breeding doesn't allocate
+template<typename Scalar>
+auto crossover(basic_network<Scalar>& child, const basic_network<Scalar>& first, const basic_network<Scalar>& second,
+               crossover_method method, std::mt19937& rand_gen) -> void {
+	child = first;
+
+	if (method == crossover_method::uniform) {
+		auto child_parameters { child.parameters() };
+		auto second_parameters { second.parameters() };
+
+		// One random bit per parameter decides the parent it comes from
+		u32 bits {};
+		for (size_t i { 0 }; i < child_parameters.size(); ++i) {
+			if (i % 32 == 0) {
+				bits = static_cast<u32>(rand_gen());
+			}
+
+			if ((bits >> (i % 32)) & 1) {
+				child_parameters[i] = second_parameters[i];
+			}
+		}
+	} else if (method == crossover_method::layer) {
+		std::bernoulli_distribution rand_bool {};
+
+		for (size_t i { 0 }; i < child.layer_weights.size(); ++i) {
+			if (rand_bool(rand_gen)) {
+				child.layer_weights[i] = second.layer_weights[i];
+				child.layer_bias[i] = second.layer_bias[i];
+			}
+		}
+	}
+}
+
+// Replaces the worst individual of the slice with candidate and moves it to
+// its place by cost, candidate is left holding the replaced individual
+template<typename Scalar>
+auto replace_worst(std::vector<individual<Scalar>>& slice, individual<Scalar>& candidate) -> void {
+	std::swap(slice.back(), candidate);
+
+	for (size_t i { slice.size() - 1 }; i > 0 && slice[i].average_cost < slice[i - 1].average_cost; --i) {
+		std::swap(slice[i], slice[i - 1]);
+	}
+}
+
+template<typename Scalar>
+auto train_nn_population(basic_network<Scalar>& output_network, const std::string& output_filepath,
+                         const std::string& data_dir, std::mt19937& rand_gen, u64 thread_count,
+                         const checkpoint_options& checkpoints, const training_state& initial_state,
+                         telemetry& metrics, const population_options& options,
+                         const std::optional<racing_options>& racing) -> void {
+	auto load_start { std::chrono::steady_clock::now() };
+	mnist_dataset training_digits { data_dir + "/mnist_training_images", data_dir + "/mnist_training_labels" };
+	metrics.record_dataset_load(std::chrono::steady_clock::now() - load_start);
+	check_network_fits_dataset(output_network, training_digits);
+
+	double output_network_average_cost {};
+	{
+		thread_pool pool { thread_count };
+		output_network_average_cost = average_cost_of_neural_net(output_network, training_digits, pool);
+	}
+	fmt::print("network cost: {}\n", output_network_average_cost);
+	metrics.record_cost(output_network_average_cost);
+
+	// Everything drawn from rand_gen is drawn here, a resumed run that starts
+	// from the same state draws the same racing order and thread seeds
+	auto initial_rand_gen { rand_gen_state(rand_gen) };
+
+	stop_signal stop {};
+	// The threads read the best network as readers 0 to thread_count - 1, this one as the last
+	best_network<Scalar> best { output_network, output_network_average_cost, thread_count + 1 };
+	auto main_reader { thread_count };
+	candidate_scorer scorer { training_digits, rand_gen, racing };
+	checkpoint_writer<Scalar> checkpoint { output_filepath, checkpoints, metrics };
+
+	// Drawn up front, rand_gen isn't safe to share between the threads
+	std::vector<std::mt19937::result_type> thread_seeds(thread_count);
+	for (auto& seed : thread_seeds) {
+		seed = std::uniform_int_distribution<std::mt19937::result_type> {}(rand_gen);
+	}
+
+	// Every thread leaves the state its generator stopped in here
+	std::vector<std::string> thread_rand_gens(thread_count);
+
+	std::vector<std::thread> threads {};
+	threads.reserve(thread_count);
+
+	auto resumed_elapsed { std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+	    std::chrono::duration<double> { initial_state.elapsed_seconds }) };
+	auto start_time { std::chrono::steady_clock::now() - resumed_elapsed };
+
+	for (size_t i { 0 }; i < thread_count; ++i) {
+		size_t slice_size { std::max<size_t>(options.population_size / thread_count
+			                                     + (i < options.population_size % thread_count ? 1 : 0),
+			                                 2) };
+
+		threads.emplace_back([&, i, slice_size, seed = thread_seeds[i]] {
+			auto& counters { metrics.thread(i) };
+
+			std::mt19937 thread_rand_gen { seed };
+			if (i < initial_state.thread_rand_gens.size()) {
+				restore_rand_gen(thread_rand_gen, initial_state.thread_rand_gens[i]);
+			}
+
+			// Nudges, scores and offers the candidate as the new best. Candidates
+			// racing shows won't get below threshold_cost end up with an infinite cost
+			auto evaluate = [&](individual<Scalar>& candidate, double threshold_cost) {
+				nudge_neural_network_values(candidate.neural_net, thread_rand_gen);
+				candidate.average_cost = scorer.score(candidate.neural_net, threshold_cost, counters)
+				                             .value_or(std::numeric_limits<double>::infinity());
+
+				if (auto replaced { best.publish(i, candidate.neural_net, candidate.average_cost) }) {
+					counters.record_improvement();
+					metrics.record_cost(candidate.average_cost);
+
+					auto diff { std::chrono::steady_clock::now() - start_time };
+					fmt::print("[{:9%H:%M:%S}] new best cost network ({:.6f} | -{:.6f}) saved to \"{}\"\n", diff,
+					           candidate.average_cost, replaced->average_cost - candidate.average_cost,
+					           output_filepath);
+
+					// Shares the snapshot with the writer instead of copying the network again
+					auto latest { best.current(i) };
+					checkpoint.submit({ latest, &latest->neural_net }, latest->average_cost);
+				}
+			};
+
+			// The slice starts out as the best network and nudged copies of it
+			auto founder { best.current(i) };
+			u64 migrant_epoch { founder->epoch };
+
+			std::vector<individual<Scalar>> slice {};
+			slice.reserve(slice_size);
+			slice.push_back({ founder->neural_net, founder->average_cost });
+
+			while (slice.size() < slice_size && !stop.requested()) {
+				individual<Scalar> member { founder->neural_net, 0.0 };
+				evaluate(member, std::numeric_limits<double>::infinity());
+				slice.push_back(std::move(member));
+			}
+
+			std::sort(slice.begin(), slice.end(),
+			          [](const auto& a, const auto& b) { return a.average_cost < b.average_cost; });
+
+			individual<Scalar> child { founder->neural_net, 0.0 };
+			founder.reset();
+
+			for (u64 bred { 0 }; !stop.requested(); ++bred) {
+				TRACE_ZONE("breed");
+
+				// Takes in the shared best network when another thread found a better one
+				if (options.migration_interval != 0 && bred % options.migration_interval == 0) {
+					// Reading the shared best network is wait free, it's still timed so
+					// the telemetry shows what sharing it costs
+					auto wait_start { std::chrono::steady_clock::now() };
+					auto latest { best.current(i) };
+					counters.record_lock_wait(std::chrono::steady_clock::now() - wait_start);
+
+					if (latest->epoch != migrant_epoch && latest->average_cost < slice.front().average_cost) {
+						child.neural_net = latest->neural_net;
+						child.average_cost = latest->average_cost;
+						replace_worst(slice, child);
+					}
+
+					migrant_epoch = latest->epoch;
+				}
+
+				const auto& first { slice[select_parent(slice.size(), options, thread_rand_gen)] };
+				const auto& second { slice[select_parent(slice.size(), options, thread_rand_gen)] };
+
+				crossover(child.neural_net, first.neural_net, second.neural_net, options.crossover, thread_rand_gen);
+				evaluate(child, slice.back().average_cost);
+
+				if (child.average_cost < slice.back().average_cost) {
+					replace_worst(slice, child);
+				}
+			}
+
+			thread_rand_gens[i] = rand_gen_state(thread_rand_gen);
+		});
+	}
+
+	for (auto& th : threads) {
+		th.join();
+	}
+
+	auto elapsed { std::chrono::steady_clock::now() - start_time };
+	scorer.print_summary(elapsed - resumed_elapsed);
+
+	training_state state { initial_state };
+	state.elapsed_seconds = std::chrono::duration<double> { elapsed }.count();
+	state.best_cost = best.current(main_reader)->average_cost;
+	state.rand_gen = initial_rand_gen;
+	state.thread_rand_gens = std::move(thread_rand_gens);
+	state.candidates_evaluated += scorer.candidates_scored();
+
+	auto latest { best.current(main_reader) };
+	checkpoint.submit({ latest, &latest->neural_net }, latest->average_cost, std::move(state));
+
+	output_network = best.current(main_reader)->neural_net;
+}
+
+template auto train_nn_population(network& output_network, const std::string& output_filepath,
+                                  const std::string& data_dir, std::mt19937& rand_gen, u64 thread_count,
+                                  const checkpoint_options& checkpoints, const training_state& initial_state,
+                                  telemetry& metrics, const population_options& options,
+                                  const std::optional<racing_options>& racing) -> void;
+template auto train_nn_population(network_f32& output_network, const std::string& output_filepath,
+                                  const std::string& data_dir, std::mt19937& rand_gen, u64 thread_count,
+                                  const checkpoint_options& checkpoints, const training_state& initial_state,
+                                  telemetry& metrics, const population_options& options,
+                                  const std::optional<racing_options>& racing) -> void;
@@ -0,0 +1,251 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <numeric>
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include <fmt/chrono.h>
+#include <fmt/format.h>
+
+#include "accuracy_of_neural_net.hpp"
+#include "average_cost_of_neural_net.hpp"
+#include "check_network_fits_dataset.hpp"
+#include "checkpoint_writer.hpp"
+#include "idx_stream.hpp"
+#include "mnist_dataset.hpp"
+#include "network_gradient.hpp"
+#include "stop_signal.hpp"
+#include "telemetry.hpp"
+#include "thread_pool.hpp"
+#include "trace.hpp"
+#include "train_nn.hpp"
+#include "training_state.hpp"
+
+template<typename Scalar>
+auto train_nn_sgd(basic_network<Scalar>& output_network, const std::string& output_filepath,
+                  const std::string& data_dir, std::mt19937& rand_gen, u64 thread_count,
+                  const checkpoint_options& checkpoints, const training_state& initial_state, telemetry& metrics,
+                  const sgd_options& options) -> void {
+	if (options.batch_size == 0) {
+		fmt::print("batch size has to be at least 1\n");
+		std::exit(1);
+	}
+
+	// Streaming keeps two chunks of the training set in memory, mapping leaves
+	// it to the page cache and shuffles every digit of it at once
+	std::optional<mnist_dataset> training_digits {};
+	std::optional<idx_stream> training_stream {};
+
+	auto load_start { std::chrono::steady_clock::now() };
+	if (options.stream_chunk == 0) {
+		training_digits.emplace(data_dir + "/mnist_training_images", data_dir + "/mnist_training_labels");
+		check_network_fits_dataset(output_network, *training_digits);
+	} else {
+		training_stream.emplace(data_dir + "/mnist_training_images", data_dir + "/mnist_training_labels",
+		                        options.stream_chunk);
+		check_network_fits_dataset(output_network, *training_stream);
+	}
+	mnist_dataset testing_digits { data_dir + "/mnist_testing_images", data_dir + "/mnist_testing_labels" };
+	metrics.record_dataset_load(std::chrono::steady_clock::now() - load_start);
+
+	const auto training_count { training_stream ? training_stream->size() : training_digits->size() };
+
+	thread_pool pool { thread_count };
+
+	auto test_accuracy = [&] {
+		return static_cast<double>(correct_predictions_of_neural_net(output_network, testing_digits, pool))
+		     / testing_digits.size() * 100.0;
+	};
+
+	fmt::print("network test accuracy: {:.2f}%\n", test_accuracy());
+
+	if (training_stream) {
+		fmt::print("Streaming {} training digits in chunks of {}, network train cost: {:.6f}\n", training_count,
+		           training_stream->chunk_size(), average_cost_of_neural_net(output_network, *training_stream, pool));
+	}
+
+	stop_signal stop {};
+
+	// Digits of the training set, or of the current chunk when streaming
+	std::vector<size_t> order(training_stream ? 0 : training_count);
+	std::iota(order.begin(), order.end(), 0);
+
+	// Where the run continues, a fresh one starts a shuffled first epoch
+	u64 first_epoch { 1 };
+	size_t resume_batch { 0 };
+	bool resume_shuffled { false };
+	double resume_cost { 0.0 };
+	std::chrono::steady_clock::duration resumed_elapsed {};
+
+	if (initial_state.resumed) {
+		if (initial_state.stream_chunk != options.stream_chunk) {
+			fmt::print("Training state was saved streaming chunks of {} digits, resume with --stream-chunk {}\n",
+			           initial_state.stream_chunk, initial_state.stream_chunk);
+			std::exit(1);
+		}
+
+		if (initial_state.order.size() != order.size()) {
+			fmt::print("Training state has an order of {} digits, the training set has {}\n",
+			           initial_state.order.size(), order.size());
+			std::exit(1);
+		}
+
+		for (auto index : initial_state.order) {
+			if (index >= order.size()) {
+				fmt::print("Training state orders digit {}, the training set has {}\n", index, order.size());
+				std::exit(1);
+			}
+		}
+
+		std::copy(initial_state.order.begin(), initial_state.order.end(), order.begin());
+		first_epoch = initial_state.epoch;
+		resume_batch = initial_state.next_batch;
+		resume_shuffled = initial_state.order_shuffled;
+		resume_cost = initial_state.epoch_cost;
+		resumed_elapsed = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+		    std::chrono::duration<double> { initial_state.elapsed_seconds });
+
+		fmt::print("Resuming at digit {} of epoch {}\n", resume_batch, first_epoch);
+	}
+
+	basic_network_gradient<Scalar> gradient { output_network };
+	checkpoint_writer<Scalar> checkpoint { output_filepath, checkpoints, metrics };
+
+	// Batches run one after another, the thread pool only tests accuracy
+	auto& counters { metrics.thread(0) };
+	std::optional<std::chrono::steady_clock::duration> time_to_target {};
+
+	auto start_time { std::chrono::steady_clock::now() - resumed_elapsed };
+	double last_epoch_cost { initial_state.best_cost };
+
+	// What a run stopped right here would need to continue
+	auto state_at = [&](u64 epoch, size_t next_batch, bool order_shuffled, double epoch_cost) {
+		training_state state { initial_state };
+		state.elapsed_seconds = std::chrono::duration<double> { std::chrono::steady_clock::now() - start_time }.count();
+		state.best_cost = last_epoch_cost;
+		state.rand_gen = rand_gen_state(rand_gen);
+		state.stream_chunk = options.stream_chunk;
+		state.epoch = epoch;
+		state.next_batch = next_batch;
+		state.order_shuffled = order_shuffled;
+		state.epoch_cost = epoch_cost;
+
+		if (!training_stream) {
+			state.order.assign(order.begin(), order.end());
+		}
+
+		return state;
+	};
+
+	// Trains on the digits order picks from pixels and labels a batch at a time,
+	// starting at batch_start. Returns where it stopped, which is only short of
+	// the end of order when a stop was requested. seen is the digits of the
+	// epoch trained on before order
+	auto run_batches = [&](const Eigen::Ref<const pixel_matrix>& pixels, std::span<const u8> labels,
+	                       size_t batch_start, size_t seen, double& total_cost) -> size_t {
+		// The end of one batch is the start of the next, one clock read per batch
+		auto batch_clock { std::chrono::steady_clock::now() };
+
+		for (; batch_start < order.size() && !stop.requested(); batch_start += options.batch_size) {
+			TRACE_ZONE("batch");
+
+			auto batch { std::span(order).subspan(batch_start,
+			                                      std::min<size_t>(options.batch_size, order.size() - batch_start)) };
+
+			gradient.set_zero();
+			total_cost += gradient_of_neural_net(output_network, pixels, labels, batch, gradient);
+			apply_network_gradient(output_network, gradient,
+			                       static_cast<Scalar>(options.learning_rate / batch.size()));
+
+			auto batch_end { std::chrono::steady_clock::now() };
+			counters.record_compute(batch.size(), batch_end - batch_clock);
+			batch_clock = batch_end;
+
+			metrics.record_cost(total_cost / static_cast<double>(seen + batch_start + batch.size()));
+		}
+
+		return std::min(batch_start, order.size());
+	};
+
+	for (u64 epoch { first_epoch }; epoch <= options.epochs && !stop.requested(); ++epoch) {
+		TRACE_ZONE("epoch", "epoch", static_cast<i64>(epoch));
+
+		double total_cost { resume_cost };
+		std::optional<training_state> stopped_state {};
+
+		if (!training_stream) {
+			if (!resume_shuffled) {
+				std::shuffle(order.begin(), order.end(), rand_gen);
+			}
+
+			auto batch_start { run_batches(training_digits->pixels(), training_digits->labels(), resume_batch, 0,
+			                               total_cost) };
+			if (batch_start < order.size()) {
+				stopped_state = state_at(epoch, batch_start, true, total_cost);
+			}
+		} else {
+			size_t position { resume_batch };
+			training_stream->rewind(position);
+
+			while (const auto* chunk { training_stream->next() }) {
+				// Replaying the shuffle of a stopped chunk on resume needs the
+				// generator it started with
+				auto chunk_rand_gen { rand_gen_state(rand_gen) };
+
+				order.resize(chunk->size());
+				std::iota(order.begin(), order.end(), 0);
+				std::shuffle(order.begin(), order.end(), rand_gen);
+
+				auto batch_start { run_batches(chunk->pixels, chunk->labels, position - chunk->first, chunk->first,
+				                               total_cost) };
+				position = chunk->first + batch_start;
+
+				if (batch_start < order.size()) {
+					stopped_state = state_at(epoch, position, false, total_cost);
+					stopped_state->rand_gen = chunk_rand_gen;
+					break;
+				}
+			}
+		}
+
+		resume_batch = 0;
+		resume_shuffled = false;
+		resume_cost = 0.0;
+
+		if (stopped_state) {
+			fmt::print("Stopped at digit {} of epoch {}, saved to \"{}\"\n", stopped_state->next_batch, epoch,
+			           output_filepath);
+			checkpoint.submit(output_network, std::nullopt, std::move(*stopped_state));
+			break;
+		}
+
+		auto accuracy { test_accuracy() };
+		auto diff { std::chrono::steady_clock::now() - start_time };
+		last_epoch_cost = total_cost / training_count;
+
+		fmt::print("[{:9%H:%M:%S}] epoch {} (train cost {:.6f} | test accuracy {:.2f}%) saved to \"{}\"\n", diff,
+		           epoch, last_epoch_cost, accuracy, output_filepath);
+		checkpoint.submit(output_network, last_epoch_cost, state_at(epoch + 1, 0, false, 0.0));
+
+		if (!time_to_target && accuracy >= options.target_accuracy) {
+			time_to_target = diff;
+			fmt::print("Reached target test accuracy of {:.2f}% after {:%H:%M:%S}\n", options.target_accuracy, diff);
+		}
+	}
+
+	if (!time_to_target) {
+		fmt::print("Target test accuracy of {:.2f}% was not reached\n", options.target_accuracy);
+	}
+}
+
+template auto train_nn_sgd(network& output_network, const std::string& output_filepath, const std::string& data_dir,
+                           std::mt19937& rand_gen, u64 thread_count, const checkpoint_options& checkpoints,
+                           const training_state& initial_state, telemetry& metrics, const sgd_options& options)
+    -> void;
+template auto train_nn_sgd(network_f32& output_network, const std::string& output_filepath,
+                           const std::string& data_dir, std::mt19937& rand_gen, u64 thread_count,
+                           const checkpoint_options& checkpoints, const training_state& initial_state,
+                           telemetry& metrics, const sgd_options& options) -> void;
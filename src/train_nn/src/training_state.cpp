@@ -0,0 +1,173 @@
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <fmt/format.h>
+#include <unistd.h>
+
+#include "network_file_format.hpp"
+#include "training_state.hpp"
+
+// Line based, a key and its value per line, so a state can be read and diffed by hand
+constexpr std::string_view training_state_magic { "train_nn_state 1" };
+
+auto training_state_path(const std::string& network_filepath) -> std::string {
+	return network_filepath + ".state";
+}
+
+auto rand_gen_state(const std::mt19937& rand_gen) -> std::string {
+	std::ostringstream stream {};
+	stream << rand_gen;
+
+	return stream.str();
+}
+
+auto restore_rand_gen(std::mt19937& rand_gen, const std::string& state) -> void {
+	std::istringstream stream { state };
+	stream >> rand_gen;
+
+	if (!stream) {
+		fmt::print("Corrupt random number generator state in training state\n");
+		std::exit(1);
+	}
+}
+
+template<typename Scalar>
+auto training_state_checksum(const basic_network<Scalar>& neural_net) -> u64 {
+	auto parameters { neural_net.parameters() };
+
+	return network_file_checksum({ reinterpret_cast<const u8*>(parameters.data()), parameters.size_bytes() });
+}
+
+auto save_training_state(const training_state& state, const std::string& filepath) -> void {
+	std::string temporary_filepath { filepath + ".tmp" };
+
+	std::FILE* file { std::fopen(temporary_filepath.c_str(), "w") };
+	if (file == nullptr) {
+		fmt::print("Failed to open training state at {} while saving\n", temporary_filepath);
+		std::exit(1);
+	}
+
+	fmt::print(file, "{}\n", training_state_magic);
+	fmt::print(file, "algorithm {}\n", state.algorithm);
+	fmt::print(file, "seed {}\n", state.seed);
+	fmt::print(file, "threads {}\n", state.thread_count);
+	fmt::print(file, "parameter_checksum {}\n", state.parameter_checksum);
+	fmt::print(file, "elapsed_seconds {}\n", state.elapsed_seconds);
+	fmt::print(file, "best_cost {}\n", state.best_cost);
+	fmt::print(file, "rand_gen {}\n", state.rand_gen);
+	for (const auto& thread_rand_gen : state.thread_rand_gens) {
+		fmt::print(file, "thread_rand_gen {}\n", thread_rand_gen);
+	}
+	fmt::print(file, "candidates_evaluated {}\n", state.candidates_evaluated);
+	fmt::print(file, "stream_chunk {}\n", state.stream_chunk);
+	fmt::print(file, "epoch {}\n", state.epoch);
+	fmt::print(file, "next_batch {}\n", state.next_batch);
+	fmt::print(file, "order_shuffled {}\n", state.order_shuffled ? 1 : 0);
+	fmt::print(file, "epoch_cost {}\n", state.epoch_cost);
+	fmt::print(file, "order {}\n", fmt::join(state.order, " "));
+
+	// Without this a crash of the whole machine could leave the rename on disk
+	// but not the state it points to
+	if (std::fflush(file) == 0) {
+		::fsync(::fileno(file));
+	}
+
+	if (std::ferror(file) != 0 || std::fclose(file) != 0) {
+		fmt::print("Failed to write training state at {}\n", temporary_filepath);
+		std::exit(1);
+	}
+
+	std::error_code error {};
+	std::filesystem::rename(temporary_filepath, filepath, error);
+	if (error) {
+		fmt::print("Failed to move training state {} to {}: {}\n", temporary_filepath, filepath, error.message());
+		std::exit(1);
+	}
+}
+
+auto load_training_state(const std::string& filepath) -> std::optional<training_state> {
+	std::ifstream file { filepath };
+	if (!file.is_open()) {
+		return std::nullopt;
+	}
+
+	std::string line {};
+	if (!std::getline(file, line) || line != training_state_magic) {
+		fmt::print("{} isn't a training state\n", filepath);
+		std::exit(1);
+	}
+
+	training_state state { .resumed = true };
+
+	while (std::getline(file, line)) {
+		std::istringstream fields { line };
+
+		std::string key {};
+		fields >> key;
+
+		auto read = [&](auto& value) {
+			if (!(fields >> value)) {
+				fmt::print("Corrupt {} in training state {}\n", key, filepath);
+				std::exit(1);
+			}
+		};
+
+		// Whatever follows the key, the generators have spaces in their states
+		auto rest = [&] {
+			std::string value {};
+			std::getline(fields >> std::ws, value);
+
+			return value;
+		};
+
+		if (key == "algorithm") {
+			read(state.algorithm);
+		} else if (key == "seed") {
+			read(state.seed);
+		} else if (key == "threads") {
+			read(state.thread_count);
+		} else if (key == "parameter_checksum") {
+			read(state.parameter_checksum);
+		} else if (key == "elapsed_seconds") {
+			read(state.elapsed_seconds);
+		} else if (key == "best_cost") {
+			read(state.best_cost);
+		} else if (key == "rand_gen") {
+			state.rand_gen = rest();
+		} else if (key == "thread_rand_gen") {
+			state.thread_rand_gens.push_back(rest());
+		} else if (key == "candidates_evaluated") {
+			read(state.candidates_evaluated);
+		} else if (key == "stream_chunk") {
+			read(state.stream_chunk);
+		} else if (key == "epoch") {
+			read(state.epoch);
+		} else if (key == "next_batch") {
+			read(state.next_batch);
+		} else if (key == "order_shuffled") {
+			read(state.order_shuffled);
+		} else if (key == "epoch_cost") {
+			read(state.epoch_cost);
+		} else if (key == "order") {
+			for (u32 index {}; fields >> index;) {
+				state.order.push_back(index);
+			}
+		} else {
+			fmt::print("Unknown key \"{}\" in training state {}\n", key, filepath);
+			std::exit(1);
+		}
+	}
+
+	return state;
+}
+
+template auto training_state_checksum(const network& neural_net) -> u64;
+template auto training_state_checksum(const network_f32& neural_net) -> u64;
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <optional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "network.hpp"
+#include "short_types.hpp"
+
+// Everything besides the network train_nn needs to continue a run where it
+// stopped, saved as <network file>.state whenever the trainer checkpoints it
+struct training_state {
+	std::string algorithm {};
+	u64 seed { 0 };
+	u64 thread_count { 0 };
+
+	// False for a fresh run, where only the fields above and rand_gen are set
+	bool resumed { false };
+
+	// Checksum of the parameters of the network saved alongside, a state only
+	// resumes the network it was saved with
+	u64 parameter_checksum { 0 };
+
+	double elapsed_seconds { 0.0 };
+	double best_cost { 0.0 };
+
+	// std::mt19937 states as written by its operator<<. rand_gen is the
+	// generator sgd continues with, for the nudging trainers it's the one they
+	// started with so the draws made when starting repeat on resume
+	std::string rand_gen {};
+	std::vector<std::string> thread_rand_gens {};
+
+	// Nudging trainers
+	u64 candidates_evaluated { 0 };
+
+	// sgd, the epoch and the batch in it to continue with. Reading the training
+	// set in chunks of stream_chunk digits shuffles every chunk on its own,
+	// order stays empty and rand_gen is the one the stopped chunk started with
+	u64 stream_chunk { 0 };
+	u64 epoch { 1 };
+	u64 next_batch { 0 };
+	bool order_shuffled { false };
+	double epoch_cost { 0.0 };
+	std::vector<u32> order {};
+};
+
+auto training_state_path(const std::string& network_filepath) -> std::string;
+
+auto rand_gen_state(const std::mt19937& rand_gen) -> std::string;
+auto restore_rand_gen(std::mt19937& rand_gen, const std::string& state) -> void;
+
+// Checksum of neural_net's parameters as training_state::parameter_checksum stores it
+template<typename Scalar>
+auto training_state_checksum(const basic_network<Scalar>& neural_net) -> u64;
+
+auto save_training_state(const training_state& state, const std::string& filepath) -> void;
+
+// nullopt if there's no state at filepath
+auto load_training_state(const std::string& filepath) -> std::optional<training_state>;